@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_BATCH_H_
+#define _CORVUS_BATCH_H_
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <functional>
+
+#include "cell.h"
+
+namespace corvus {
+	//! the setup needed to weave one cell of a batch (see Cell::layout)
+	struct LayoutResult {
+		bool                       done      = false; //!< was the cell processed (false if the batch was cancelled before reaching it)
+		std::exception_ptr         error            ; //!< exception thrown while laying out the cell (e.g. not enough treadles), null on success
+		uint_fast32_t              shafts    = 0    ; //!< minimum number of shafts required
+		std::vector<uint_fast32_t> threading        ; //!< shaft (0 indexed) that each warp thread goes through
+		Csr<uint_fast32_t>         tieup            ; //!< shafts (0 indexed) that each treadle lifts
+		Csr<uint_fast32_t>         treadling        ; //!< treadles (0 indexed) pressed for each weft
+	};
+
+	//! hooks for watching / stopping a long batch, either can be left empty
+	//! calls are serialized but may come from any worker thread
+	struct BatchCallbacks {
+		std::function<void(size_t, size_t)> progress; //!< called as progress(finished, total) each time a cell finishes
+		std::function<bool()>               cancel  ; //!< polled before each cell is started, return true to stop (cells already started still finish)
+	};
+
+	//! lay out many cells at once
+	//! \param cells first cell to lay out
+	//! \param count number of cells
+	//! \param opts treadle budget and tie up search for every cell, opts.threads is the number of cells laid out at once
+	//! \param callbacks optional progress / cancellation callbacks
+	//! \return result for each cell in input order
+	//! \note each cell is laid out on a single thread and idle threads take the next cell so uneven cells still balance
+	//!       every thread reuses a single LayoutWorkspace for all of its cells
+	std::vector<LayoutResult> layoutBatch(Cell const* cells, size_t count, LayoutOptions const& opts = LayoutOptions(), BatchCallbacks const& callbacks = BatchCallbacks());
+
+	//! lay out many cells at once
+	//! \param cells cells to lay out
+	//! \param opts treadle budget and tie up search for every cell, opts.threads is the number of cells laid out at once
+	//! \param callbacks optional progress / cancellation callbacks
+	//! \return result for each cell in input order
+	inline std::vector<LayoutResult> layoutBatch(std::vector<Cell> const& cells, LayoutOptions const& opts = LayoutOptions(), BatchCallbacks const& callbacks = BatchCallbacks()) {
+		return layoutBatch(cells.data(), cells.size(), opts, callbacks);
+	}
+}
+
+#endif//_CORVUS_BATCH_H_
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_BITS_H_
+#define _CORVUS_BITS_H_
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace corvus {
+	//! word parallel operations on packed rows of bits
+	//! rows are arrays of 64 bit words with bit i stored in word i/64 at position i%64
+	//! any padding bits past the end of a row are expected to be 0 so whole words can be compared / hashed
+	namespace bits {
+		//! number of 64 bit words needed to store n bits
+		inline size_t words(size_t n) {return (n + 63) / 64;}
+
+		//! mask of the valid bits in the last word of an n bit row
+		inline uint64_t tailMask(size_t n) {return 0 == n % 64 ? ~uint64_t(0) : (uint64_t(1) << (n % 64)) - 1;}
+
+		//! count the set bits in a word
+		inline size_t popcount(uint64_t w) {
+#ifdef _MSC_VER
+			return static_cast<size_t>(__popcnt64(w));
+#else
+			return static_cast<size_t>(__builtin_popcountll(w));
+#endif
+		}
+
+		//! index of the lowest set bit in a (non zero) word
+		inline size_t ctz(uint64_t w) {
+#ifdef _MSC_VER
+			unsigned long i;
+			_BitScanForward64(&i, w);
+			return static_cast<size_t>(i);
+#else
+			return static_cast<size_t>(__builtin_ctzll(w));
+#endif
+		}
+
+		//! get a single bit
+		inline bool test(uint64_t const* row, size_t i) {return 0 != ( (row[i / 64] >> (i % 64)) & 1 );}
+
+		//! set a single bit
+		inline void set(uint64_t* row, size_t i, bool v) {
+			const uint64_t b = uint64_t(1) << (i % 64);
+			if (v) row[i / 64] |= b; else row[i / 64] &= ~b;
+		}
+
+		//! check if 2 rows are identical
+		inline bool equal(uint64_t const* a, uint64_t const* b, size_t n) {
+			for (size_t i = 0; i < n; i++) if (a[i] != b[i]) return false;
+			return true;
+		}
+
+		//! hash a row a word at a time
+		inline uint64_t hash(uint64_t const* row, size_t n) {
+			uint64_t h = 0x9e3779b97f4a7c15ull ^ n;
+			for (size_t i = 0; i < n; i++) {
+				// mix in each word (splitmix64 finalizer)
+				uint64_t x = row[i] + 0x9e3779b97f4a7c15ull * (i + 1);
+				x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+				x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+				h = (h ^ x ^ (x >> 31)) * 0x100000001b3ull;
+			}
+			return h;
+		}
+
+		//! count the set bits in a row
+		inline size_t count(uint64_t const* row, size_t n) {
+			size_t c = 0;
+			for (size_t i = 0; i < n; i++) c += popcount(row[i]);
+			return c;
+		}
+
+		//! dst &= src
+		inline void andRow(uint64_t* dst, uint64_t const* src, size_t n) {for (size_t i = 0; i < n; i++) dst[i] &= src[i];}
+
+		//! dst |= src
+		inline void orRow (uint64_t* dst, uint64_t const* src, size_t n) {for (size_t i = 0; i < n; i++) dst[i] |= src[i];}
+
+		//! dst ^= src
+		inline void xorRow(uint64_t* dst, uint64_t const* src, size_t n) {for (size_t i = 0; i < n; i++) dst[i] ^= src[i];}
+
+		//! flip every bit in an nBits long row (padding bits are left 0)
+		inline void invert(uint64_t* row, size_t nBits) {
+			const size_t n = words(nBits);
+			for (size_t i = 0; i < n; i++) row[i] = ~row[i];
+			if (n > 0) row[n-1] &= tailMask(nBits);
+		}
+
+		//! read 64 bits starting at any bit of a row
+		//! \param row row to read from
+		//! \param n number of words in the row
+		//! \param off index of first bit to read
+		//! \return bits [off, off + 64) (bits past the end of the row are 0)
+		inline uint64_t window(uint64_t const* row, size_t n, size_t off) {
+			const size_t k = off / 64, b = off % 64;
+			const uint64_t lo = k < n ? row[k] : 0;
+			if (0 == b) return lo;
+			const uint64_t hi = k + 1 < n ? row[k + 1] : 0;
+			return (lo >> b) | (hi << (64 - b));
+		}
+
+		//! transpose a 64 x 64 block of bits in place (bit i of word k is swapped with bit k of word i)
+		//! \param a 64 words to transpose
+		inline void transpose(uint64_t* a) {
+			// swap the off diagonal 32 x 32 blocks, then the 16 x 16 blocks within each of those, etc
+			uint64_t m = 0x00000000FFFFFFFFull;
+			for (size_t j = 32; 0 != j; j >>= 1, m ^= (m << j)) {
+				for (size_t k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+					const uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+					a[k    ] ^= t << j;
+					a[k | j] ^= t;
+				}
+			}
+		}
+
+		//! call a function for the index of every set bit in a row (in increasing order)
+		template <typename F> void forEach(uint64_t const* row, size_t n, F f) {
+			for (size_t i = 0; i < n; i++) {
+				for (uint64_t w = row[i]; 0 != w; w &= w - 1) f(i * 64 + ctz(w));
+			}
+		}
+	}
+}
+
+#endif//_CORVUS_BITS_H_
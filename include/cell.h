@@ -9,7 +9,13 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
+#include <cstddef>
 #include <ostream>
+#include <functional>
+
+#include "bits.h"
+#include "csr.h"
 
 namespace corvus {
 	// some quick weaving vocabulary (w/ a handweaving floor loom perspective)
@@ -27,17 +33,87 @@ namespace corvus {
 	// drawdown: the image version of fabric created by threading + tie up + treadling
 	// block: a sub unit of the drawdown, typically a repeating rectangle
 
+	//! options controlling how Cell::layout builds a tie up
+	struct LayoutOptions {
+		size_t   treadles  = 0  ; //!< number of treadles available (0 for 1 per shaft), this must be at least the number of shafts
+		double   timeLimit = 0  ; //!< seconds to spend searching for a skeleton tie up when there are more sheds than treadles (0 for a straight tie up, the search is opt in)
+		unsigned threads   = 0  ; //!< number of threads to transpose the sheds and search with (0 to use every hardware thread, 1 to stay on the calling thread)
+	};
+
+	//! the smallest repeating unit of a drawdown
+	//! every repeat tiles the plane, the straight repeat is a warps x wefts rectangle
+	//! a smaller unit may exist if neighboring repeats are offset, this is described 2 equivalent ways:
+	//!  - bands: rectangles of warps x bandWefts, each band is the one below it shifted left by bandShift (a brick / shifted repeat)
+	//!  - drops: rectangles of dropWarps x wefts, each column is the one to its left shifted down by dropShift (a half drop)
+	//! both have the same area, the shifts are 0 when the straight repeat is already the smallest unit
+	struct Repeat {
+		uint_fast32_t warps    ; //!< smallest horizontal period (the width of a straight repeat)
+		uint_fast32_t wefts    ; //!< smallest vertical period (the height of a straight repeat)
+		uint_fast32_t bandWefts; //!< height of a shifted band, pixel (i, j + bandWefts) matches (i + bandShift, j)
+		uint_fast32_t bandShift; //!< horizontal shift between bands (less than warps)
+		uint_fast32_t dropWarps; //!< width of a dropped column, pixel (i + dropWarps, j) matches (i, j + dropShift)
+		uint_fast32_t dropShift; //!< vertical shift between columns (less than wefts)
+	};
+
+	//! a rectangle of a drawdown
+	struct Rect {
+		uint_fast32_t x      = 0; //!< first warp
+		uint_fast32_t y      = 0; //!< first weft
+		uint_fast32_t width  = 0; //!< number of warps
+		uint_fast32_t height = 0; //!< number of wefts
+	};
+
 	//! a binary (black/white) drawdown that is a building block for larger pattern)
 	//! thick could probably be referred to as a weave, pattern, diagram or similar
 	//! I chose Cell specifically since I'm not aware of its use in weaving
 	//! that way there is no worry about ambiguity, we can define the meaning ourselves
 	//! the intention of this class is to be the smallest repeat unit in a full drawdown
 	struct Cell {
-		uint_fast32_t             warps; //!< how many warps (image width)
-		uint_fast32_t             wefts; //!< how many wefts (image height)
-		std::vector<uint_fast8_t> mask ; //!< is the warp (1) or weft(0) on top for each pixel
-		                                 //!< this is in row major order (shed by shed) starting from the bottom left
-		                                 //!< we could have used a vector<bool> here but the specialization has some issues
+		uint_fast32_t         warps; //!< how many warps (image width)
+		uint_fast32_t         wefts; //!< how many wefts (image height)
+		std::vector<uint64_t> mask ; //!< is the warp (1) or weft(0) on top for each pixel, packed 64 pixels per word
+		                             //!< this is in row major order (shed by shed) starting from the bottom left
+		                             //!< each row is padded out to a whole number of words (see rowWords), padding bits are always 0
+		                             //!< we could have used a vector<bool> here but the specialization has some issues (and no word access)
+
+		//! construct an empty cell
+		Cell() : warps(0), wefts(0) {}
+
+		//! construct a cell with the weft on top everywhere
+		//! \param w number of warps
+		//! \param h number of wefts
+		Cell(uint_fast32_t w, uint_fast32_t h) : warps(w), wefts(h), mask(bits::words(w) * h, 0) {}
+
+		//! construct a cell from 1 byte per pixel
+		//! \param w number of warps
+		//! \param h number of wefts
+		//! \param pixels is the warp (non zero) or weft (0) on top for each pixel in row major order
+		Cell(uint_fast32_t w, uint_fast32_t h, std::vector<uint_fast8_t> const& pixels);
+
+		//! get the number of 64 bit words used to store each weft
+		size_t rowWords() const {return bits::words(warps);}
+
+		//! get a packed weft
+		//! \param j weft to get
+		//! \return pointer to the rowWords() words of weft j
+		uint64_t      * row(uint_fast32_t j)       {return mask.data() + j * rowWords();}
+		uint64_t const* row(uint_fast32_t j) const {return mask.data() + j * rowWords();}
+
+		//! check if the warp is on top at a single pixel
+		//! \param i warp index
+		//! \param j weft index
+		//! \return true if the warp is on top
+		bool get(uint_fast32_t i, uint_fast32_t j) const {return bits::test(row(j), i);}
+
+		//! set a single pixel
+		//! \param i warp index
+		//! \param j weft index
+		//! \param v true to put the warp on top
+		void set(uint_fast32_t i, uint_fast32_t j, bool v) {bits::set(row(j), i, v);}
+
+		//! expand the packed mask to 1 byte per pixel
+		//! \return is the warp (1) or weft (0) on top for each pixel in row major order
+		std::vector<uint_fast8_t> unpack() const;
 
 		//! invert from the binary drawdown to the setup needed to create it
 		//! \param threading location to write the shaft (0 indexed) that each warp thread goes through
@@ -45,8 +121,32 @@ namespace corvus {
 		//! \param treadling location to write the list of treadles (0 indexed) that is pressed for each warp
 		//! \return minimum number of shafts required (this is typically a limiting factor on looms)
 		//! \note this assumes a rising shed, maybe we should make that an argument
+		//! \note this always uses a straight tie up (1 treadle per shed), pass LayoutOptions with a timeLimit to search for a skeleton tie up
 		uint_fast32_t layout(std::vector<uint_fast32_t>& threading, std::vector< std::vector<uint_fast32_t> >& tieup, std::vector< std::vector<uint_fast32_t> >& treadling) const;
 
+		//! invert from the binary drawdown to the setup needed to create it
+		//! \param threading location to write the shaft (0 indexed) that each warp thread goes through
+		//! \param tieup location to write the list of shafts (0 indexed) that each treadle lifts
+		//! \param treadling location to write the list of treadles (0 indexed) that is pressed for each warp
+		//! \param opts treadle budget and how hard to search for a skeleton tie up
+		//! \return minimum number of shafts required (this is typically a limiting factor on looms)
+		//! \note if there are more sheds than treadles and opts.timeLimit is set a skeleton tie up that minimizes the most treadles pressed at once is searched for (up to 64 shafts)
+		uint_fast32_t layout(std::vector<uint_fast32_t>& threading, std::vector< std::vector<uint_fast32_t> >& tieup, std::vector< std::vector<uint_fast32_t> >& treadling, LayoutOptions const& opts) const;
+
+		//! copy a rectangle out of the cell
+		//! \param x first warp to copy
+		//! \param y first weft to copy
+		//! \param w number of warps to copy
+		//! \param h number of wefts to copy
+		//! \return cell with pixel (i, j) equal to pixel (x + i, y + j) of this cell
+		Cell crop(uint_fast32_t x, uint_fast32_t y, uint_fast32_t w, uint_fast32_t h) const;
+
+		//! find the smallest repeat of the drawdown, including shifted and half drop repeats
+		//! \return periods and offsets of the repeat (the full size with no shift if nothing repeats)
+		//! \note rows and columns are compared by hash and candidates are then confirmed exactly a word at a time
+		//!       a repeat only needs to match where it overlaps the cell, so the last partial repeat at the edges is allowed
+		Repeat findRepeat() const;
+
 		//! print a single weft to a text file
 		//! \param r weft row to write
 		//! \param os ostream to write to
@@ -60,6 +160,93 @@ namespace corvus {
 		//! \param weftSymb character to use to reprsent the weft on top
 		void write(std::ostream& os, char warpSymb = '#', char weftSymb = '.') const;
 	};
+
+	//! a source of packed rows for algorithms that don't need a whole drawdown in memory
+	//! called as row(j, scratch) it returns a pointer to the packed bits of weft j
+	//! rows that are generated on the fly can be written into scratch (which has room for a whole row), stored rows can be returned directly
+	//! the pointer only needs to stay valid until the next call
+	typedef std::function<uint64_t const*(uint_fast32_t, uint64_t*)> RowSource;
+
+	//! invert a drawdown given as a stream of rows to the setup needed to create it (see Cell::layout)
+	//! \param warps number of warps
+	//! \param wefts number of wefts
+	//! \param row source of packed rows, each row is visited once in order
+	//! \param threading location to write the shaft (0 indexed) that each warp thread goes through
+	//! \param tieup location to write the list of shafts (0 indexed) that each treadle lifts
+	//! \param treadling location to write the list of treadles (0 indexed) that is pressed for each warp
+	//! \param opts treadle budget and how hard to search for a skeleton tie up
+	//! \return minimum number of shafts required
+	uint_fast32_t layoutRows(uint_fast32_t warps, uint_fast32_t wefts, RowSource const& row, std::vector<uint_fast32_t>& threading, std::vector< std::vector<uint_fast32_t> >& tieup, std::vector< std::vector<uint_fast32_t> >& treadling, LayoutOptions const& opts = LayoutOptions());
+
+	//! scratch memory and output for repeated layouts (e.g. rerunning layout on every edit)
+	//! every buffer is kept between calls so once the workspace has seen a design of a given size laying it out again doesn't allocate
+	//! the exceptions are a skeleton tie up search (more sheds than treadles), which has its own allocations,
+	//! and designs over 1024 warps with opts.threads != 1, which start threads to transpose the sheds (set threads to 1 for allocation free layouts of any size)
+	class LayoutWorkspace {
+		public:
+			//! invert a drawdown to the setup needed to create it (see Cell::layout), the results are available until the next call
+			//! \param cell drawdown to lay out
+			//! \param opts treadle budget and how hard to search for a skeleton tie up
+			//! \return minimum number of shafts required
+			uint_fast32_t layout(Cell const& cell, LayoutOptions const& opts = LayoutOptions()) {
+				return layout(cell.warps, cell.wefts, [&cell](uint_fast32_t j, uint64_t*) {return cell.row(j);}, opts);
+			}
+
+			//! invert a drawdown given as a stream of rows to the setup needed to create it (see layoutRows)
+			//! \param warps number of warps
+			//! \param wefts number of wefts
+			//! \param row source of packed rows, each row is visited once in order
+			//! \param opts treadle budget and how hard to search for a skeleton tie up
+			//! \return minimum number of shafts required
+			uint_fast32_t layout(uint_fast32_t warps, uint_fast32_t wefts, RowSource const& row, LayoutOptions const& opts = LayoutOptions());
+
+			//! get the shaft (0 indexed) that each warp thread goes through from the last layout
+			std::vector<uint_fast32_t> const& threading() const {return threadingOut;}
+
+			//! get the shafts (0 indexed) that each treadle lifts from the last layout
+			Csr<uint_fast32_t> const& tieup() const {return tieupOut;}
+
+			//! get the treadles (0 indexed) pressed for each weft from the last layout
+			Csr<uint_fast32_t> const& treadling() const {return treadlingOut;}
+
+		private:
+			// unique sheds
+			std::vector<uint64_t     > shedRows  ; //!< packed copy of each unique shed (in list order once sorted)
+			std::vector<uint64_t     > sortedRows; //!< space to sort shedRows into
+			std::vector<uint64_t     > shedHash  ; //!< hash of each unique shed
+			std::vector<uint64_t     > rowBuff   ; //!< space for rows that are generated on the fly
+			std::vector<uint_fast32_t> shedTable ; //!< open addressing table of shed ids
+			std::vector<uint_fast32_t> weftSheds ; //!< unique shed used by each weft
+			std::vector<uint_fast32_t> order     ; //!< sort permutation (of sheds then shafts)
+			std::vector<uint_fast32_t> rank      ; //!< inverse of order
+
+			// shafts
+			std::vector<uint64_t     > signatures; //!< bit k of warp i's signature is set if shed k lifts warp i
+			std::vector<uint64_t     > colHash   ; //!< hash of each signature
+			std::vector<uint_fast32_t> groupTable; //!< open addressing table of signature groups
+			std::vector<uint_fast32_t> groupOf   ; //!< group of each warp
+			std::vector<uint_fast32_t> groupRep  ; //!< first warp in each group
+			std::vector<uint_fast32_t> groupSize ; //!< number of warps in each group
+			std::vector<uint_fast32_t> shaftRep  ; //!< representative warp of each shaft (in shaft order)
+			std::vector<size_t       > cursor    ; //!< fill position of each list while building a Csr
+			Csr<uint_fast32_t>         shedShafts; //!< shafts lifted by each unique shed
+			Csr<uint_fast32_t>         shedPress ; //!< treadles pressed for each unique shed with a skeleton tie up
+			std::vector<uint64_t     > shedMasks ; //!< shafts lifted by each unique shed as a bitmask
+
+			// output
+			std::vector<uint_fast32_t> threadingOut;
+			Csr<uint_fast32_t>         tieupOut    ;
+			Csr<uint_fast32_t>         treadlingOut;
+	};
+
+	struct Wif;
+
+	//! build the drawdown woven by a wif (threading x tie up x treadling or the lift plan if there is one)
+	//! \param wif weaving information to build drawdown for
+	//! \return drawdown with a warp for each warp thread and a weft for each weft thread
+	//! \note warps threaded through multiple shafts are lifted by any of them, for a falling shed the drawdown is inverted
+	//! \note this works from the dense thread arrays so the wif needs to have been checked (see Wif::sanityCheck)
+	Cell fromWif(Wif const& wif);
 }
 
 inline std::ostream& operator<<(std::ostream& os, corvus::Cell const& c) {c.write(os); return os;}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_CSR_H_
+#define _CORVUS_CSR_H_
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace corvus {
+	//! a list of lists stored in 2 flat arrays (compressed sparse row)
+	//! list k is values[offsets[k], offsets[k+1]) so there are only ever 2 allocations no matter how many lists there are
+	//! clearing keeps the capacity so refilling a list of lists of the same size doesn't allocate
+	template <typename T> struct Csr {
+		std::vector<size_t> offsets = std::vector<size_t>(1, 0); //!< start of each list in values with an extra entry for the end (always starts with 0)
+		std::vector<T     > values ;                             //!< every list back to back
+
+		//! get the number of lists
+		size_t size() const {return offsets.size() - 1;}
+
+		//! get the length of a list
+		//! \param k list index
+		//! \return number of values in list k
+		size_t count(size_t k) const {return offsets[k+1] - offsets[k];}
+
+		//! get the values of a list
+		//! \param k list index
+		//! \return pointer to the first / one past the last value in list k
+		T      * begin(size_t k)       {return values.data() + offsets[k  ];}
+		T const* begin(size_t k) const {return values.data() + offsets[k  ];}
+		T      * end  (size_t k)       {return values.data() + offsets[k+1];}
+		T const* end  (size_t k) const {return values.data() + offsets[k+1];}
+
+		//! remove every list
+		void clear() {offsets.resize(1); offsets[0] = 0; values.clear();}
+
+		//! add a list to the end
+		//! \param b first value to add
+		//! \param e one past the last value to add
+		void push(T const* b, T const* e) {values.insert(values.end(), b, e); offsets.push_back(values.size());}
+
+		//! add a single element list to the end
+		//! \param v value of the list
+		void push(T const& v) {values.push_back(v); offsets.push_back(values.size());}
+
+		//! copy a single list out
+		//! \param k list index
+		//! \return copy of list k
+		std::vector<T> list(size_t k) const {return std::vector<T>(begin(k), end(k));}
+
+		//! copy every list out to a vector of vectors
+		//! \param lists location to write lists
+		void toLists(std::vector< std::vector<T> >& lists) const {
+			lists.resize(size());
+			for (size_t k = 0; k < size(); k++) lists[k].assign(begin(k), end(k));
+		}
+	};
+}
+
+#endif//_CORVUS_CSR_H_
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_INCREMENTAL_H_
+#define _CORVUS_INCREMENTAL_H_
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+#include "cell.h"
+
+namespace corvus {
+	//! a layout (see Cell::layout) that is kept up to date as wefts are added / changed one at a time
+	//! the shaft partition, the unique shed table and the shafts in each shed persist between edits
+	//! a new shed only splits the shafts it cuts through and a shed that is no longer used only merges the shafts it separated
+	//! so the cost of an edit depends on the weft being changed and the shafts it touches rather than the size of the design
+	//!
+	//! each unique shed gets its own treadle (i.e. the trivial tie up of Cell::layout with a single press per weft)
+	//! numbers are kept stable instead of sorted like Cell::layout so an edit doesn't renumber everything:
+	//!  - shafts are numbered [0, shafts()), a split adds a new shaft at the end and a merge moves the last shaft into the gap
+	//!  - treadles are never renumbered, a treadle whose shed is no longer used is left empty (uses() == 0) until a new shed reuses it
+	class IncrementalLayout {
+		public:
+			//! start a layout with no wefts (every warp on 1 shaft)
+			//! \param warps number of warps
+			explicit IncrementalLayout(uint_fast32_t warps = 0);
+
+			//! start a layout from an existing drawdown
+			//! \param cell drawdown to add every weft of
+			explicit IncrementalLayout(Cell const& cell);
+
+			//! get the number of warps
+			uint_fast32_t warps() const {return numWarps;}
+
+			//! get the number of wefts added so far
+			uint_fast32_t wefts() const {return static_cast<uint_fast32_t>(weftShed.size());}
+
+			//! get the number of 64 bit words in each packed weft
+			size_t rowWords() const {return bits::words(numWarps);}
+
+			//! add a weft to the end of the design
+			//! \param row packed weft (rowWords() words)
+			void appendWeft(uint64_t const* row);
+
+			//! change an existing weft
+			//! \param j weft to change
+			//! \param row new packed weft (rowWords() words)
+			void setWeft(uint_fast32_t j, uint64_t const* row);
+
+			//! get the minimum number of shafts required
+			uint_fast32_t shafts() const {return static_cast<uint_fast32_t>(members.size());}
+
+			//! get the number of treadles (including unused ones)
+			size_t treadles() const {return shedShafts.size();}
+
+			//! get the shaft (0 indexed) that each warp thread goes through
+			std::vector<uint_fast32_t> const& threading() const {return shaftOf;}
+
+			//! get the shafts (0 indexed, sorted) lifted by a treadle
+			//! \param t treadle index
+			//! \return shafts tied to t
+			std::vector<uint_fast32_t> const& tieup(size_t t) const {return shedShafts[t];}
+
+			//! get the number of wefts that press a treadle
+			//! \param t treadle index
+			//! \return number of wefts pressing t (0 for an unused treadle)
+			uint_fast32_t uses(size_t t) const {return shedUses[t];}
+
+			//! get the treadle (0 indexed) pressed for each weft
+			std::vector<uint_fast32_t> const& treadling() const {return weftShed;}
+
+			//! get the warps on a shaft
+			//! \param s shaft index
+			//! \return warps threaded on s (in no particular order)
+			std::vector<uint_fast32_t> const& shaft(size_t s) const {return members[s];}
+
+		private:
+			//! find the shed for a row adding a new one (and splitting shafts) if needed
+			//! \param row packed weft with 0 padding
+			//! \return shed index (with its use count incremented)
+			uint_fast32_t useShed(uint64_t const* row);
+
+			//! remove a use of a shed, if it was the last use the shed is removed and shafts it separated are merged
+			//! \param k shed index
+			void releaseShed(uint_fast32_t k);
+
+			//! move every warp of one shaft onto another with the same signature and remove it
+			//! \param keep shaft to keep
+			//! \param drop shaft to remove
+			//! \return shaft number that was moved into drop's place (or drop if it was the last shaft)
+			uint_fast32_t mergeShafts(uint_fast32_t keep, uint_fast32_t drop);
+
+			//! get the signature of a shaft (bit k is set if shed k lifts the shaft)
+			uint64_t      * signature(size_t s)       {return signatures.data() + s * sigWords;}
+			uint64_t const* signature(size_t s) const {return signatures.data() + s * sigWords;}
+
+			uint_fast32_t                                    numWarps  ; //!< number of warps
+			std::vector<uint64_t                           > rowBuff   ; //!< copy of the incoming row with the padding cleared
+
+			// sheds
+			std::vector<uint64_t                           > shedRows  ; //!< packed warps lifted by each shed
+			std::vector<uint64_t                           > shedHash  ; //!< hash of each shed
+			std::vector<uint_fast32_t                      > shedUses  ; //!< number of wefts using each shed
+			std::vector< std::vector<uint_fast32_t>        > shedShafts; //!< sorted shafts lifted by each shed
+			std::vector<uint_fast32_t                      > freeSheds ; //!< unused shed numbers
+			std::unordered_multimap<uint64_t, uint_fast32_t> shedIndex ; //!< shed numbers by hash
+			std::vector<uint_fast32_t                      > weftShed  ; //!< shed of each weft
+
+			// shafts
+			std::vector<uint_fast32_t                      > shaftOf   ; //!< shaft of each warp
+			std::vector<uint_fast32_t                      > warpPos   ; //!< index of each warp in its shaft's member list
+			std::vector< std::vector<uint_fast32_t>        > members   ; //!< warps on each shaft
+			std::vector<uint64_t                           > signatures; //!< sheds lifting each shaft as sigWords packed words
+			size_t                                           sigWords  ; //!< words in each signature
+			std::vector<uint_fast32_t                      > cutCount  ; //!< warps of each shaft lifted by the current row (0 between calls)
+			std::vector<uint_fast32_t                      > cut       ; //!< shafts with a non zero cutCount
+			std::vector<uint_fast32_t                      > splitTo   ; //!< new shaft for the lifted warps of each shaft being split by the current row
+	};
+}
+
+#endif//_CORVUS_INCREMENTAL_H_
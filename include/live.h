@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_LIVE_H_
+#define _CORVUS_LIVE_H_
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "cell.h"
+
+namespace corvus {
+	struct Wif;
+
+	//! a draft (threading, tie up, treadling or lift plan) with a drawdown that is kept in sync as the draft is edited
+	//! each edit only rebuilds the part of the drawdown it can change and records it as a dirty rectangle:
+	//!  - a threading edit rebuilds one warp (column)
+	//!  - a treadling / lift plan edit rebuilds one weft (row)
+	//!  - a tie up edit rebuilds the wefts that press the treadle
+	//! rows are rebuilt a word at a time from the warps on each lifted shaft
+	//! columns are built a word at a time from the wefts lifting each of the warp's shafts, then scattered into the rows
+	//! all indices are 0 based (unlike a wif)
+	class LiveDraft {
+		public:
+			//! build a draft from a wif
+			//! \param wif checked weaving information to start from (the tie up / treadling are used if it has treadles, otherwise the lift plan)
+			explicit LiveDraft(Wif const& wif);
+
+			//! build an empty draft (nothing threaded, tied or pressed)
+			//! \param warps number of warps
+			//! \param wefts number of wefts
+			//! \param shafts number of shafts
+			//! \param treadles number of treadles (0 to use a lift plan)
+			//! \param risingShed do treadles lift (true) or lower (false) the tied shafts
+			LiveDraft(uint_fast32_t warps, uint_fast32_t wefts, uint_fast32_t shafts, uint_fast32_t treadles, bool risingShed = true);
+
+			//! get the current drawdown
+			Cell const& drawdown() const {return cell;}
+
+			//! get the number of warps
+			uint_fast32_t warps() const {return cell.warps;}
+
+			//! get the number of wefts
+			uint_fast32_t wefts() const {return cell.wefts;}
+
+			//! get the number of shafts
+			uint_fast32_t shafts() const {return numShafts;}
+
+			//! get the number of treadles (0 if the draft uses a lift plan)
+			uint_fast32_t treadles() const {return numTreadles;}
+
+			//! change the shafts a warp is threaded through
+			//! \param i warp index
+			//! \param shafts shafts to thread through (empty to leave unthreaded)
+			void setThreading(uint_fast32_t i, std::vector<uint_fast32_t> const& shafts);
+
+			//! change the shafts tied to a treadle
+			//! \param t treadle index
+			//! \param shafts shafts to tie to the treadle
+			void setTieup(uint_fast32_t t, std::vector<uint_fast32_t> const& shafts);
+
+			//! change the treadles pressed for a weft
+			//! \param j weft index
+			//! \param treadles treadles to press
+			void setTreadling(uint_fast32_t j, std::vector<uint_fast32_t> const& treadles);
+
+			//! change the shafts lifted for a weft (only for drafts with a lift plan)
+			//! \param j weft index
+			//! \param shafts shafts to lift
+			void setLiftPlan(uint_fast32_t j, std::vector<uint_fast32_t> const& shafts);
+
+			//! get the regions of the drawdown that changed since the last call (e.g. to repaint them)
+			//! \return changed rectangles in the order the edits were made (they may overlap)
+			std::vector<Rect> takeDirty();
+
+		private:
+			//! build a packed list of shafts / treadles
+			//! \param list indices to set
+			//! \param count number of valid indices
+			//! \param out location to write bits::words(count) words
+			//! \param name shaft or treadle (for error messages)
+			static void packList(std::vector<uint_fast32_t> const& list, size_t count, uint64_t* out, char const* name);
+
+			//! rebuild the shafts lifted for a weft from its treadles and update the weft
+			//! \param j weft index
+			void updateTreadled(uint_fast32_t j);
+
+			//! replace the shafts lifted for a weft and rebuild the weft
+			//! \param j weft index
+			//! \param lifted new packed shafts lifted
+			void updateLift(uint_fast32_t j, uint64_t const* lifted);
+
+			//! rebuild every weft and the shaft columns from scratch
+			void rebuild();
+
+			uint_fast32_t numShafts  ; //!< number of shafts
+			uint_fast32_t numTreadles; //!< number of treadles (0 for a lift plan)
+			bool          rising     ; //!< do treadles lift the tied shafts
+			size_t        liftWords  ; //!< words in a packed list of shafts
+			size_t        pressWords ; //!< words in a packed list of treadles
+			size_t        weftWords  ; //!< words in a packed list of wefts
+
+			std::vector<uint64_t     > shaftWarps; //!< warps threaded on each shaft (numShafts rows of cell.rowWords() words)
+			std::vector<uint64_t     > warpShafts; //!< shafts each warp is threaded through (liftWords per warp)
+			std::vector<uint64_t     > tieups    ; //!< shafts tied to each treadle (liftWords per treadle)
+			std::vector<uint64_t     > presses   ; //!< treadles pressed for each weft (pressWords per weft)
+			std::vector<uint64_t     > lift      ; //!< shafts lifted for each weft (liftWords per weft)
+			std::vector<uint64_t     > shaftWefts; //!< wefts lifting each shaft (weftWords per shaft), the transpose of lift
+			std::vector<uint64_t     > treadWefts; //!< wefts pressing each treadle (weftWords per treadle), the transpose of presses
+			Cell                       cell      ; //!< current drawdown
+			std::vector<Rect         > dirty     ; //!< regions changed since the last takeDirty
+	};
+}
+
+#endif//_CORVUS_LIVE_H_
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_MAPPED_FILE_H_
+#define _CORVUS_MAPPED_FILE_H_
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace corvus {
+
+	//! read only memory mapping of an entire file
+	//! the mapping lives as long as the object, anything pointing into data() is invalidated on destruction
+	class MappedFile {
+		public:
+			//! map a file into memory
+			//! \param path file to map
+			//! \note throws invalid_argument if the file can't be opened or mapped
+			explicit MappedFile(std::string const& path);
+
+			MappedFile(MappedFile const&) = delete;
+			MappedFile& operator=(MappedFile const&) = delete;
+
+			~MappedFile();
+
+			//! get the mapped bytes
+			//! \return pointer to first byte of file (nullptr for an empty file)
+			char const* data() const {return ptr;}
+
+			//! get the number of mapped bytes
+			//! \return file size in bytes
+			size_t size() const {return len;}
+
+		private:
+			char const* ptr = nullptr; //!< start of mapping
+			size_t      len = 0      ; //!< length of mapping
+#ifdef _WIN32
+			void*       hFile = nullptr; //!< file handle
+			void*       hMap  = nullptr; //!< file mapping handle
+#endif
+	};
+}
+
+#endif//_CORVUS_MAPPED_FILE_H_
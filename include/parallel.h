@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_PARALLEL_H_
+#define _CORVUS_PARALLEL_H_
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+
+namespace corvus {
+	namespace detail {
+		//! is the current thread a worker of parallelForEach (nested parallel loops run serially on workers)
+		inline thread_local bool inWorker = false;
+	}
+
+	//! get the number of threads to use for parallel work
+	//! \return number of hardware threads (at least 1)
+	inline unsigned threadCount() {
+		const unsigned n = std::thread::hardware_concurrency();
+		return 0 == n ? 1 : n;
+	}
+
+	//! split [0, n) into contiguous chunks and process them on multiple threads
+	//! \param n number of items
+	//! \param grain minimum number of items worth giving to a thread (small problems stay on the calling thread)
+	//! \param threads maximum number of threads to use (0 for every hardware thread, 1 to stay on the calling thread without starting any)
+	//! \param f function to call as f(begin, end) for each chunk, chunks never overlap
+	//! \note the calling thread processes the first chunk, exceptions are rethrown after all threads finish
+	template <typename F> void parallelFor(size_t n, size_t grain, unsigned threads, F f) {
+		if (0 == n) return;
+		const size_t chunks = std::min<size_t>(0 == threads ? threadCount() : threads, (n + std::max<size_t>(grain, 1) - 1) / std::max<size_t>(grain, 1));
+		if (chunks <= 1 || detail::inWorker) {
+			f(size_t(0), n);
+			return;
+		}
+
+		// split as evenly as possible
+		std::vector<std::exception_ptr> errors(chunks);
+		auto work = [&](size_t c) {
+			try {
+				f(n * c / chunks, n * (c + 1) / chunks);
+			} catch (...) {
+				errors[c] = std::current_exception();
+			}
+		};
+		std::vector<std::thread> workers;
+		workers.reserve(chunks - 1);
+		for (size_t c = 1; c < chunks; c++) workers.emplace_back(work, c);
+		work(0);
+		for (std::thread& t : workers) t.join();
+		for (std::exception_ptr const& e : errors) if (e) std::rethrow_exception(e);
+	}
+
+	//! split [0, n) into contiguous chunks and process them on every hardware thread (see above)
+	template <typename F> void parallelFor(size_t n, size_t grain, F f) {parallelFor(n, grain, 0, f);}
+
+	//! process independent items of uneven cost on multiple threads
+	//! items are handed out one at a time from a shared counter so a thread that finishes early just takes the next one
+	//! \param n number of items
+	//! \param threads number of threads to use (0 for every hardware thread)
+	//! \param f function to call as f(item, worker) where worker is in [0, threads) and fixed for each thread (e.g. to index per thread scratch space)
+	//!          returning false stops every thread from taking new items
+	//! \note the calling thread is worker 0, parallelFor calls made by f run serially on the worker
+	//!       exceptions stop the work and the first one (by worker) is rethrown after all threads finish
+	template <typename F> void parallelForEach(size_t n, unsigned threads, F f) {
+		if (0 == n) return;
+		const size_t count = std::max<size_t>(1, std::min<size_t>(0 == threads ? threadCount() : threads, n));
+		std::atomic<size_t> next(0);
+		std::atomic<bool> stop(false);
+		std::vector<std::exception_ptr> errors(count);
+		auto work = [&](size_t id) {
+			const bool nested = detail::inWorker;
+			detail::inWorker = true;
+			try {
+				for (size_t i = next++; i < n && !stop; i = next++) {
+					if (!f(i, id)) stop = true;
+				}
+			} catch (...) {
+				errors[id] = std::current_exception();
+				stop = true;
+			}
+			detail::inWorker = nested;
+		};
+		std::vector<std::thread> pool;
+		pool.reserve(count - 1);
+		for (size_t i = 1; i < count; i++) pool.emplace_back(work, i);
+		work(0);
+		for (std::thread& t : pool) t.join();
+		for (std::exception_ptr const& e : errors) if (e) std::rethrow_exception(e);
+	}
+}
+
+#endif//_CORVUS_PARALLEL_H_
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_RENDER_H_
+#define _CORVUS_RENDER_H_
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <ostream>
+
+#include "cell.h"
+
+namespace corvus {
+	struct Wif;
+	class RepeatView;
+
+	//! an 8 bit rgb image
+	struct Image {
+		uint_fast32_t        width ; //!< image width in pixels
+		uint_fast32_t        height; //!< image height in pixels
+		std::vector<uint8_t> rgb   ; //!< 3 bytes per pixel in row major order starting from the top left
+
+		//! construct an empty image
+		Image() : width(0), height(0) {}
+
+		//! construct a black image
+		//! \param w width in pixels
+		//! \param h height in pixels
+		Image(uint_fast32_t w, uint_fast32_t h) : width(w), height(h), rgb(size_t(w) * size_t(h) * 3, 0) {}
+
+		//! get a pixel
+		//! \param x column (from the left)
+		//! \param y row (from the top)
+		//! \return pointer to the r, g, b bytes of the pixel
+		uint8_t      * pixel(uint_fast32_t x, uint_fast32_t y)       {return rgb.data() + (size_t(y) * width + x) * 3;}
+		uint8_t const* pixel(uint_fast32_t x, uint_fast32_t y) const {return rgb.data() + (size_t(y) * width + x) * 3;}
+
+		//! write the image as a binary portable pixmap (P6)
+		//! \param os ostream to write to (should be opened in binary mode)
+		void writePpm(std::ostream& os) const;
+
+		//! write the image as a binary portable pixmap (P6)
+		//! \param path file to write to
+		void writePpm(std::string const& path) const;
+	};
+
+	//! colors for each thread in a drawdown
+	struct Palette {
+		typedef std::array<uint8_t, 3> Rgb;
+		std::vector<Rgb> warp; //!< color of each warp thread
+		std::vector<Rgb> weft; //!< color of each weft thread
+	};
+
+	//! build the color of each thread in a wif
+	//! \param wif weaving information to get colors from
+	//! \return per thread colors scaled from the wif's color range to [0, 255]
+	//! \note threads without an entry in WARP/WEFT COLORS use the default warp/weft color
+	//!       if the wif has no default the warp is black and the weft is white (like a black and white drawdown)
+	//!       colors come from the dense thread arrays so the wif needs to have been checked (see Wif::sanityCheck)
+	Palette palette(Wif const& wif);
+
+	//! render a drawdown in color
+	//! \param cell drawdown to render
+	//! \param pal color of each thread, must have an entry for every warp and weft
+	//! \return image with a pixel for each warp/weft crossing (the first weft is the bottom row)
+	//! \note the image is split into tiles that are rendered in parallel
+	Image render(Cell const& cell, Palette const& pal);
+
+	//! repaint part of a rendered drawdown (e.g. after an edit)
+	//! \param cell drawdown to render
+	//! \param pal color of each thread, must have an entry for every warp and weft
+	//! \param region warps / wefts to repaint
+	//! \param img image previously rendered from a drawdown of the same size, only the pixels of region are written
+	void render(Cell const& cell, Palette const& pal, Rect const& region, Image& img);
+
+	//! render a repeated drawdown in color without building the full drawdown
+	//! \param view repeated drawdown to render
+	//! \param pal color of each thread, must have an entry for every warp and weft
+	//! \return image with a pixel for each warp/weft crossing (the first weft is the bottom row)
+	Image render(RepeatView const& view, Palette const& pal);
+
+	//! render the drawdown of a wif in color
+	//! \param wif weaving information to render
+	//! \return image with a pixel for each warp/weft crossing (the first weft is the bottom row)
+	Image render(Wif const& wif);
+}
+
+#endif//_CORVUS_RENDER_H_
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_REPEAT_H_
+#define _CORVUS_REPEAT_H_
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+#include "cell.h"
+
+namespace corvus {
+	//! a large drawdown made by repeating one or more cells without storing every pixel
+	//! the fabric is a stack of horizontal bands, each band tiles a single cell across the full width (with an optional shift)
+	//! the sequence of bands repeats vertically so memory use is set by one repeat no matter how long the fabric is
+	class RepeatView {
+		public:
+			//! a horizontal band of a single cell tiled across the fabric
+			struct Band {
+				uint_fast32_t cell  = 0; //!< index of the cell to tile
+				uint_fast32_t wefts = 0; //!< height of the band in wefts (0 for the height of the cell), cell rows wrap around
+				uint_fast32_t shift = 0; //!< warps to shift the cell left by, e.g. half the cell width for a brick / half drop layout
+				uint_fast32_t start = 0; //!< first row of the cell to use
+			};
+
+			//! construct an empty view
+			RepeatView() : numWarps(0), numWefts(0) {}
+
+			//! repeat a single cell
+			//! \param cell cell to repeat
+			//! \param across number of repeats in the warp direction
+			//! \param down number of repeats in the weft direction
+			RepeatView(Cell const& cell, uint_fast32_t across, uint_fast32_t down);
+
+			//! build a view from bands of cells
+			//! \param cells cells to tile
+			//! \param bands bands from the first weft up
+			//! \param warps width of the fabric in warps
+			//! \param repeats number of times to repeat the band sequence in the weft direction
+			RepeatView(std::vector<Cell> cells, std::vector<Band> const& bands, uint_fast32_t warps, uint_fast32_t repeats);
+
+			//! get the width of the fabric
+			uint_fast32_t warps() const {return numWarps;}
+
+			//! get the length of the fabric
+			uint_fast32_t wefts() const {return numWefts;}
+
+			//! get the number of 64 bit words in each packed weft
+			size_t rowWords() const {return bits::words(numWarps);}
+
+			//! get the number of wefts before the band sequence repeats
+			uint_fast32_t period() const {return static_cast<uint_fast32_t>(lines.size());}
+
+			//! check if the warp is on top at a single pixel
+			//! \param i warp index
+			//! \param j weft index
+			//! \return true if the warp is on top
+			bool get(uint_fast32_t i, uint_fast32_t j) const {
+				Line const& l = lines[j % lines.size()];
+				Cell const& c = cells[l.cell];
+				return c.get(static_cast<uint_fast32_t>((i + l.shift) % c.warps), l.row);
+			}
+
+			//! build a packed weft
+			//! \param j weft index
+			//! \param out location to write rowWords() words
+			void row(uint_fast32_t j, uint64_t* out) const {rowRange(j, 0, rowWords(), out);}
+
+			//! build part of a packed weft
+			//! \param j weft index
+			//! \param wBeg first word to build
+			//! \param wEnd one past the last word to build
+			//! \param out location to write words [wBeg, wEnd) of the row
+			void rowRange(uint_fast32_t j, size_t wBeg, size_t wEnd, uint64_t* out) const;
+
+			//! build a packed warp
+			//! \param i warp index
+			//! \param out location to write bits::words(wefts()) words, bit j is set if the warp is on top at weft j
+			void column(uint_fast32_t i, uint64_t* out) const;
+
+			//! get a source of rows for streaming algorithms
+			//! \return row source that builds rows into the provided scratch space
+			RowSource rows() const {return [this](uint_fast32_t j, uint64_t* scratch) {row(j, scratch); return static_cast<uint64_t const*>(scratch);};}
+
+			//! call a function for a range of wefts with each packed row (rows are built one at a time)
+			//! \param jBeg first weft
+			//! \param jEnd one past the last weft
+			//! \param f function to call as f(j, row)
+			template <typename F> void forEachRow(uint_fast32_t jBeg, uint_fast32_t jEnd, F f) const {
+				std::vector<uint64_t> buff(rowWords());
+				for (uint_fast32_t j = jBeg; j < jEnd; j++) {
+					row(j, buff.data());
+					f(j, static_cast<uint64_t const*>(buff.data()));
+				}
+			}
+
+			//! copy the full drawdown into a cell (only sensible for small views)
+			//! \return cell with every pixel of the view
+			Cell materialize() const;
+
+			//! invert the full drawdown to the setup needed to create it (see Cell::layout), rows are streamed instead of stored
+			//! \param threading location to write the shaft (0 indexed) that each warp thread goes through
+			//! \param tieup location to write the list of shafts (0 indexed) that each treadle lifts
+			//! \param treadling location to write the list of treadles (0 indexed) that is pressed for each warp
+			//! \param opts treadle budget and how hard to search for a skeleton tie up
+			//! \return minimum number of shafts required
+			uint_fast32_t layout(std::vector<uint_fast32_t>& threading, std::vector< std::vector<uint_fast32_t> >& tieup, std::vector< std::vector<uint_fast32_t> >& treadling, LayoutOptions const& opts = LayoutOptions()) const {
+				return layoutRows(numWarps, numWefts, rows(), threading, tieup, treadling, opts);
+			}
+
+			//! print the view to a text file a weft at a time
+			//! \param os ostream to write to
+			//! \param warpSymb character to use to represent the warp on top
+			//! \param weftSymb character to use to reprsent the weft on top
+			void write(std::ostream& os, char warpSymb = '#', char weftSymb = '.') const;
+
+		private:
+			//! where a weft comes from
+			struct Line {
+				uint_fast32_t cell ; //!< cell index
+				uint_fast32_t row  ; //!< row in cell
+				uint_fast32_t shift; //!< horizontal shift (less than the cell width)
+			};
+
+			std::vector<Cell                 > cells   ; //!< cells being repeated
+			std::vector< std::vector<uint64_t> > expanded; //!< rows of each cell repeated out to at least cell width + 64 bits so any 64 bit window can be read without wrapping
+			std::vector<size_t               > expWords; //!< words in each expanded row
+			std::vector<Line                 > lines   ; //!< source of each weft in one period of the band sequence
+			uint_fast32_t                      numWarps; //!< width of the fabric
+			uint_fast32_t                      numWefts; //!< length of the fabric
+	};
+}
+
+#endif//_CORVUS_REPEAT_H_
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_SIMULATE_H_
+#define _CORVUS_SIMULATE_H_
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "cell.h"
+#include "render.h"
+
+namespace corvus {
+	struct Wif;
+	class RepeatView;
+
+	//! physical layout of the threads in one direction
+	//! each thread is centered in its own space, threads thinner than their spacing leave a gap and thicker ones overlap their neighbors
+	struct ThreadLayout {
+		std::vector<double> start    ; //!< where each thread's space starts in inches (prefix sum of spacing), has an extra entry for the total width
+		std::vector<double> thickness; //!< thickness of each thread in inches
+
+		//! get the number of threads
+		size_t size() const {return thickness.size();}
+
+		//! get the total width of all threads in inches
+		double extent() const {return start.empty() ? 0.0 : start.back();}
+
+		//! get the center of a thread
+		//! \param i thread index
+		//! \return center in inches
+		double center(size_t i) const {return (start[i] + start[i+1]) / 2;}
+	};
+
+	//! lay out the warp threads of a wif
+	//! \param wif weaving information with spacing / thickness
+	//! \param pitch spacing / thickness in inches to use if the wif doesn't give one
+	//! \return layout of the warps
+	//! \note a thread's size is its listed value (or the base value) times its listed zoom (or the base zoom)
+	//! \note this works from the dense thread arrays so the wif needs to have been checked (see Wif::sanityCheck)
+	ThreadLayout warpLayout(Wif const& wif, double pitch = 0.05);
+
+	//! lay out the weft threads of a wif
+	//! \param wif weaving information with spacing / thickness
+	//! \param pitch spacing / thickness in inches to use if the wif doesn't give one
+	//! \return layout of the wefts
+	ThreadLayout weftLayout(Wif const& wif, double pitch = 0.05);
+
+	//! options for simulated fabric images
+	struct SimulateOptions {
+		double        dpi        = 100.0          ; //!< output pixels per inch
+		double        pitch      = 0.05           ; //!< thread spacing / thickness (inches) if the wif doesn't specify them
+		Palette::Rgb  background = {255, 255, 255}; //!< color showing through gaps between threads
+		uint_fast32_t x          = 0              ; //!< left edge of the region to render (pixels)
+		uint_fast32_t y          = 0              ; //!< top edge of the region to render (pixels)
+		uint_fast32_t width      = 0              ; //!< width of the region to render (pixels, 0 to render to the right edge)
+		uint_fast32_t height     = 0              ; //!< height of the region to render (pixels, 0 to render to the bottom edge)
+	};
+
+	//! get the size of a full simulated image
+	//! \param warps warp layout
+	//! \param wefts weft layout
+	//! \param dpi output pixels per inch
+	//! \return {width, height} in pixels
+	std::pair<uint_fast32_t, uint_fast32_t> simulatedSize(ThreadLayout const& warps, ThreadLayout const& wefts, double dpi);
+
+	//! simulate the appearance of woven fabric
+	//! \param cell drawdown (which thread is on top at each crossing)
+	//! \param pal color of each thread
+	//! \param warps physical layout of the warps
+	//! \param wefts physical layout of the wefts
+	//! \param opts resolution, background, and region to render
+	//! \return image of the requested region (the first weft is at the bottom of the full image)
+	//! \note edges are anti-aliased by pixel coverage and bands of rows are rendered in parallel
+	Image simulate(Cell const& cell, Palette const& pal, ThreadLayout const& warps, ThreadLayout const& wefts, SimulateOptions const& opts = SimulateOptions());
+
+	//! simulate the appearance of a repeated drawdown without building the full drawdown
+	//! \param view repeated drawdown
+	//! \param pal color of each thread
+	//! \param warps physical layout of the warps
+	//! \param wefts physical layout of the wefts
+	//! \param opts resolution, background, and region to render
+	//! \return image of the requested region
+	Image simulate(RepeatView const& view, Palette const& pal, ThreadLayout const& warps, ThreadLayout const& wefts, SimulateOptions const& opts = SimulateOptions());
+
+	//! simulate the appearance of the fabric woven by a wif
+	//! \param wif weaving information to simulate
+	//! \param opts resolution, background, and region to render
+	//! \return image of the requested region
+	Image simulate(Wif const& wif, SimulateOptions const& opts = SimulateOptions());
+}
+
+#endif//_CORVUS_SIMULATE_H_
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_STATS_H_
+#define _CORVUS_STATS_H_
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+#ifdef CORVUS_STATS
+#include <chrono>
+#include <memory_resource>
+#endif
+
+namespace corvus {
+	//! opt in timing and counters for the expensive steps of reading and laying out drafts
+	//! the hooks are only compiled in when CORVUS_STATS is defined (cmake -DCORVUS_STATS=ON), otherwise they compile to nothing and a Stats just stays zeroed
+	//! stats are collected on the calling thread while a StatsScope is alive, work handed to other threads is timed as a whole by the thread waiting on it
+	struct Stats {
+		//! timed steps
+		enum Phase {
+			Tokenize       , //!< splitting wif text into sections and keys (Wif::read)
+			DecodeSections , //!< checking [CONTENTS] and parsing the values of every section (Wif::read)
+			SortAndDupCheck, //!< sorting the n=value lists and checking for duplicate keys (Wif::sanityCheck)
+			RangeChecks    , //!< checking the lists against thread counts and tables (Wif::sanityCheck)
+			Densify        , //!< building the dense threading / treadling and packing the tie up (Wif::sanityCheck)
+			LiftPlan       , //!< reconstructing and checking the lift plan (Wif::sanityCheck)
+			DenseValues    , //!< filling in the per thread colors / symbols / sizes (Wif::sanityCheck)
+			ShedDedup      , //!< finding and ordering the unique sheds (LayoutWorkspace::layout)
+			Partition      , //!< grouping warps with identical columns into shafts (LayoutWorkspace::layout)
+			TieUp          , //!< building the tie up and treadling (LayoutWorkspace::layout)
+			PhaseCount
+		};
+
+		//! counted things
+		enum Counter {
+			Lines             , //!< lines of wif text tokenized
+			Sections          , //!< sections read
+			Keys              , //!< key=value pairs read
+			ScratchAllocations, //!< allocations from the parse's scratch arena
+			UniqueSheds       , //!< unique sheds found by layout
+			PartitionGroups   , //!< groups of identical warps found by layout (i.e. shafts)
+			CounterCount
+		};
+
+#ifdef CORVUS_STATS
+		static constexpr bool enabled = true ; //!< are the hooks compiled in
+#else
+		static constexpr bool enabled = false; //!< are the hooks compiled in
+#endif
+
+		uint64_t nanoseconds[PhaseCount  ] = {}; //!< time spent in each phase
+		uint64_t calls      [PhaseCount  ] = {}; //!< number of times each phase ran
+		uint64_t counters   [CounterCount] = {}; //!< value of each counter
+
+		//! get the name of a phase
+		//! \param p phase
+		//! \return snake case name (as used in json)
+		static char const* name(Phase p);
+
+		//! get the name of a counter
+		//! \param c counter
+		//! \return snake case name (as used in json)
+		static char const* name(Counter c);
+
+		//! reset everything to 0
+		void clear() {*this = Stats();}
+
+		//! add stats from somewhere else (e.g. one worker of a batch)
+		//! \param other stats to add
+		//! \return this
+		Stats& operator+=(Stats const& other);
+
+		//! write the stats as a single json object
+		//! \param os stream to write to
+		//! \note the layout is {"enabled": bool, "phases": {name: {"ns": n, "calls": n}, ...}, "counters": {name: n, ...}}
+		void writeJson(std::ostream& os) const;
+
+		//! get the stats as json
+		//! \return json text (see writeJson)
+		std::string json() const;
+	};
+
+#ifdef CORVUS_STATS
+	namespace detail {
+		//! stats being collected on this thread (null if nobody is collecting)
+		inline thread_local Stats* currentStats = nullptr;
+
+		//! times a sequence of phases, each phase runs until the next one starts or the timer is stopped / destroyed
+		class PhaseTimer {
+			public:
+				//! start timing a phase
+				//! \param p first phase
+				explicit PhaseTimer(Stats::Phase p) : stats(currentStats), phase(p), start(std::chrono::steady_clock::now()) {}
+
+				~PhaseTimer() {stop();}
+
+				//! end the current phase and start another
+				//! \param p next phase
+				void next(Stats::Phase p) {
+					stop();
+					phase = p;
+					start = std::chrono::steady_clock::now();
+				}
+
+				//! end the current phase
+				void stop() {
+					if (nullptr == stats || Stats::PhaseCount == phase) return;
+					stats->nanoseconds[phase] += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+					++stats->calls[phase];
+					phase = Stats::PhaseCount;
+				}
+
+			private:
+				Stats*                                stats;
+				Stats::Phase                          phase;
+				std::chrono::steady_clock::time_point start;
+		};
+
+		//! add to a counter
+		//! \param c counter to add to
+		//! \param n amount to add
+		inline void count(Stats::Counter c, uint64_t n) {if (nullptr != currentStats) currentStats->counters[c] += n;}
+
+		//! memory resource that counts allocations before passing them along
+		class CountingResource : public std::pmr::memory_resource {
+			public:
+				//! \param up resource to allocate from
+				explicit CountingResource(std::pmr::memory_resource* up) : upstream(up) {}
+
+				uint64_t allocations = 0; //!< number of allocations made
+
+			private:
+				void* do_allocate(size_t bytes, size_t align) override {++allocations; return upstream->allocate(bytes, align);}
+				void do_deallocate(void* p, size_t bytes, size_t align) override {upstream->deallocate(p, bytes, align);}
+				bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override {return this == &other;}
+
+				std::pmr::memory_resource* upstream;
+		};
+	}
+
+	//! collect stats for everything done on the calling thread while this is alive
+	class StatsScope {
+		public:
+			//! start collecting
+			//! \param s stats to add to
+			explicit StatsScope(Stats& s) : prev(detail::currentStats) {detail::currentStats = &s;}
+
+			~StatsScope() {detail::currentStats = prev;}
+
+			StatsScope(StatsScope const&) = delete;
+			StatsScope& operator=(StatsScope const&) = delete;
+
+		private:
+			Stats* prev; //!< stats that were being collected before (scopes can nest)
+	};
+
+	//! start timing a sequence of phases in the current block, e.g. CORVUS_STATS_PHASES(timer, Tokenize)
+	#define CORVUS_STATS_PHASES(timer, phase) ::corvus::detail::PhaseTimer timer(::corvus::Stats::phase)
+
+	//! end the current phase of a timer and start another
+	#define CORVUS_STATS_NEXT(timer, phase) timer.next(::corvus::Stats::phase)
+
+	//! end the current phase of a timer (e.g. before calling something that times itself)
+	#define CORVUS_STATS_STOP(timer) timer.stop()
+
+	//! add to a counter
+	#define CORVUS_STATS_COUNT(counter, n) ::corvus::detail::count(::corvus::Stats::counter, (n))
+#else
+	//! collect stats for everything done on the calling thread while this is alive (does nothing without CORVUS_STATS)
+	class StatsScope {
+		public:
+			explicit StatsScope(Stats&) {}
+			StatsScope(StatsScope const&) = delete;
+			StatsScope& operator=(StatsScope const&) = delete;
+	};
+
+	#define CORVUS_STATS_PHASES(timer, phase)
+	#define CORVUS_STATS_NEXT(timer, phase)
+	#define CORVUS_STATS_STOP(timer)
+	#define CORVUS_STATS_COUNT(counter, n)
+#endif
+}
+
+#endif//_CORVUS_STATS_H_
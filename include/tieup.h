@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_TIEUP_H_
+#define _CORVUS_TIEUP_H_
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace corvus {
+	// a skeleton tie up ties each treadle to a (usually small) group of shafts so that sheds are built by pressing several treadles at once
+	// with enough treadles every shed gets its own treadle, with as many treadles as shafts a straight tie up always works
+	// in between we want a tie up that keeps the number of treadles pressed together small
+	// shafts and sheds are passed around as bitmasks here (bit i set if shaft i is lifted) so at most 64 shafts are supported
+
+	//! search for a skeleton tie up that minimizes the maximum number of treadles pressed at once
+	//! \param sheds shafts lifted by each shed (empty / duplicate sheds are ignored)
+	//! \param treadles number of treadles available
+	//! \param maxPress only tie ups that need fewer than this many simultaneous presses are interesting (e.g. the straight tie up's worst shed)
+	//! \param seconds how long to search before giving up and returning the best tie up so far
+	//! \param threads number of threads to search with (0 to use every hardware thread)
+	//! \return shafts lifted by each treadle (at most treadles, sorted as lists of shafts) or an empty vector if nothing better than maxPress was found
+	//! \note the search is deterministic unless it runs out of time
+	std::vector<uint64_t> skeletonTieup(std::vector<uint64_t> const& sheds, size_t treadles, size_t maxPress, double seconds, unsigned threads = 0);
+
+	//! find the fewest treadles that lift exactly the shafts in a shed
+	//! \param shed shafts to lift
+	//! \param tieup shafts lifted by each treadle
+	//! \return treadles to press (ascending)
+	//! \note only treadles that lift a subset of the shed can be pressed, throws if the shed can't be built
+	std::vector<uint_fast32_t> pressTreadles(uint64_t shed, std::vector<uint64_t> const& tieup);
+}
+
+#endif//_CORVUS_TIEUP_H_
@@ -3,12 +3,19 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <istream>
 #include <ostream>
 #include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory_resource>
+
+#include "csr.h"
 
 namespace corvus {
+	namespace wif_io {struct LayoutLists;} // the lists of lists while they are being checked (see wif.cpp)
 
 	//! interface for reading an writing 'weaving information files'
 	//! \note everything in a wif is 1 indexed instead of 0 indexed
@@ -24,7 +31,10 @@ namespace corvus {
 		typedef std::pair<Integer,Integer> Range  ;
 
 		//! check if the current values are resonable and cleans things up a bit, throws invalid_argument if not
-		void sanityCheck();
+		//! \param threads number of threads to sort / check the independent lists with (0 for every hardware thread, 1 to check everything on the calling thread)
+		//! \note this also builds the dense thread arrays (warp, weft, tieUpMasks, and liftMasks), calling it again keeps the existing arrays if the lists of lists are empty
+		//! \note the same error is thrown no matter how many threads are used
+		void sanityCheck(unsigned threads = 1);
 
 		enum class Unit {
 			None       ,
@@ -162,11 +172,11 @@ namespace corvus {
 		//     n=value sections       //
 		////////////////////////////////
 		std::vector< std::pair< Integer, String  > > notes                ; //!< NOTES: list of notes for humans
-		std::vector< std::pair< Integer, VecInt  > > tieUp                ; //!< TIEUP: a list of shafts/harnesses connected for each treadle
+		std::vector< std::pair< Integer, VecInt  > > tieUp                ; //!< TIEUP: a list of shafts/harnesses connected for each treadle (packed into tieUpMasks by sanityCheck)
 		std::vector< std::pair< Integer, Color   > > colorTable           ; //!< COLOR TABLE: rgb triples in [range.first, range.second]
 		std::vector< std::pair< Integer, Symbol  > > warpSymbolTable      ; //!< WARP SYMBOL TABLE: a glyph character to represent each warp instead of a number (not sure how this is used in practice)
 		std::vector< std::pair< Integer, Symbol  > > weftSymbolTable      ; //!< WEFT SYMBOL TABLE: a glyph character to represent each weft instead of a number (not sure how this is used in practice)
-		std::vector< std::pair< Integer, VecInt  > > threading            ; //!< THREADING: for each warp a list of the shafts that it goes through
+		std::vector< std::pair< Integer, VecInt  > > threading            ; //!< THREADING: for each warp a list of the shafts that it goes through (moved to warp.shafts by sanityCheck)
 		
 		std::vector< std::pair< Integer, Real    > > warpThicknessList    ; //!< WARP THICKNESS: thickness of individual warps
 		std::vector< std::pair< Integer, Integer > > warpThicknessZoomList; //!< WARP THICKNESS ZOOM: zoom factor for individual warps
@@ -175,8 +185,8 @@ namespace corvus {
 		std::vector< std::pair< Integer, Integer > > warpColorList        ; //!< WARP COLORS: index into colorTable for each warp
 		std::vector< std::pair< Integer, Integer > > warpSymbolList       ; //!< WARP SYMBOLS: index into warpSymbolTable for each warp
 
-		std::vector< std::pair< Integer, VecInt  > > treadling            ; //!< TREADLING: for each weft row a list of treadles pressed
-		std::vector< std::pair< Integer, VecInt  > > liftPlan             ; //!< LIFTPLAN: for weft row a list of shafts/harnesses lifted
+		std::vector< std::pair< Integer, VecInt  > > treadling            ; //!< TREADLING: for each weft row a list of treadles pressed (moved to weft.treadles by sanityCheck)
+		std::vector< std::pair< Integer, VecInt  > > liftPlan             ; //!< LIFTPLAN: for weft row a list of shafts/harnesses lifted (packed into liftMasks by sanityCheck)
 
 		std::vector< std::pair< Integer, Real    > > weftThicknessList    ; //!< WEFT THICKNESS: thickness of individual werfs
 		std::vector< std::pair< Integer, Integer > > weftThicknessZoomList; //!< WEFT THICKNESS ZOOM: zoom factor for individual werfs
@@ -185,12 +195,117 @@ namespace corvus {
 		std::vector< std::pair< Integer, Integer > > weftColorList        ; //!< WEFT COLORS: index into colorTable for each weft
 		std::vector< std::pair< Integer, Integer > > weftSymbolList       ; //!< WEFT SYMBOLS: index into weftSymbolTable for each weft
 
+		////////////////////////////////
+		//    dense thread arrays     //
+		////////////////////////////////
+		// the n=value lists above are sparse and 1 indexed which is how they are read and written
+		// sanityCheck fills in dense 0 indexed arrays (entry i is thread i+1) with the defaults applied, everything else in the library works from these
+		// the lists of lists (threading and treadling) are dense once checked so they are moved instead of copied
+		// the tie up and lift plan are stored as packed shaft masks (shaftWords() 64 bit words per entry with bit s-1 set for shaft s)
+		// so the lift plan is just ORs of the tie up and practically every loom (<= 64 shafts) only needs a single word
+
+		//! per thread values in one direction
+		struct Threads {
+			Csr<Integer>         shafts       ; //!< shafts each warp is threaded through, THREADING (sorted, {0} for none), empty for wefts (see liftMasks)
+			Csr<Integer>         treadles     ; //!< treadles pressed for each weft, TREADLING (sorted, {0} for none), empty for warps
+			std::vector<Integer> colors       ; //!< index into colorTable for each thread (the default color index if not listed)
+			std::vector<Integer> symbols      ; //!< index into the symbol table for each thread (the default symbol number if not listed)
+			std::vector<Real   > thickness    ; //!< thickness of each thread (the base thickness if not listed, may be NAN)
+			std::vector<Integer> thicknessZoom; //!< thickness zoom of each thread (the base zoom if not listed)
+			std::vector<Real   > spacing      ; //!< spacing around each thread (the base spacing if not listed, may be NAN)
+			std::vector<Integer> spacingZoom  ; //!< spacing zoom of each thread (the base zoom if not listed)
+		};
+
+		Threads               warp      ; //!< dense per warp values
+		Threads               weft      ; //!< dense per weft values
+		std::vector<uint64_t> tieUpMasks; //!< shafts tied to each treadle, TIEUP (shaftWords() words per treadle)
+		std::vector<uint64_t> liftMasks ; //!< shafts lifted for each weft, LIFTPLAN (shaftWords() words per weft)
+
+		//! get the number of 64 bit words in each shaft mask
+		//! \return words per tie up / lift plan entry (at least 1 so entries are still counted without any shafts)
+		size_t shaftWords() const {return 0 == shafts ? 1 : (size_t(shafts) + 63) / 64;}
+
+		//! parse a wif from a stream
+		//! \param is stream to read from (read to the end)
 		void read(std::istream& is);
 
+		//! parse a wif from an in memory buffer
+		//! \param buf start of wif text (doesn't need to be null terminated)
+		//! \param len number of bytes in buf
+		//! \param threads number of threads to decode sections and check lists with (0 for every hardware thread, 1 to do everything on the calling thread)
+		//! \note the text is tokenized in place, nothing is copied until the values are decoded
+		//! \param scratch upstream for the parse's scratch arena (nullptr for the default resource), e.g. a pool shared by a long running batch import
+		//! \note with multiple threads the big sections (threading, treadling, lift plan, colors, ...) are decoded at the same time, the result and any error are the same either way
+		//! \note everything that is only needed during the parse comes from a monotonic arena that is released in one go when the parse ends
+		void read(char const* buf, size_t len, unsigned threads = 1, std::pmr::memory_resource* scratch = nullptr);
+
+		//! parse a wif file through a memory mapping
+		//! \param path file to read
+		//! \param threads number of threads to decode with (see read)
+		//! \param scratch upstream for the parse's scratch arena (see read)
+		void readFile(std::string const& path, unsigned threads = 1, std::pmr::memory_resource* scratch = nullptr);
+
+		//! decode only some sections of a wif (e.g. [TEXT] and [COLOR TABLE] for a catalog)
+		//! \param buf start of wif text (doesn't need to be null terminated)
+		//! \param len number of bytes in buf
+		//! \param sections names of sections to decode (case insensitive), all other sections are skipped without being tokenized
+		//! \note since the result is incomplete [CONTENTS] isn't checked and sanityCheck isn't called
+		void readSections(char const* buf, size_t len, std::vector<std::string> const& sections);
+
+		//! decode only some sections of a wif file through a memory mapping
+		//! \param path file to read
+		//! \param sections names of sections to decode (case insensitive)
+		void readFile(std::string const& path, std::vector<std::string> const& sections);
+
+		//! write the wif as text
+		//! \param os stream to write to
 		void write(std::ostream& os) const;
 
+		//! write the wif as text into a buffer (formatted with to_chars, much faster than an ostream for big drafts)
+		//! \param buf buffer to append text to, the text is identical to write(std::ostream&)
+		void write(std::string& buf) const;
+
+		//! write the wif as text to a file, the text is formatted in 1 MB blocks (like write(std::string&)) and each block is written as it fills
+		//! \param path file to write to
+		void writeFile(std::string const& path) const;
+
+		//! hash wif text so a cache built from it can be recognized
+		//! \param buf start of wif text
+		//! \param len number of bytes in buf
+		//! \return 64 bit hash of the text
+		static uint64_t hashSource(char const* buf, size_t len);
+
+		//! write a versioned binary copy of a (validated) wif that can be loaded without parsing
+		//! \param os stream to write to (should be opened in binary mode)
+		//! \param sourceHash hash of the text the wif was read from (see hashSource)
+		//! \note the layout is fixed width headers followed by flat arrays (n=value lists as key / value arrays and lists of lists as offsets + values)
+		void writeCache(std::ostream& os, uint64_t sourceHash) const;
+
+		//! load a binary copy written by writeCache (e.g. from a memory mapping)
+		//! \param buf start of cache
+		//! \param len number of bytes in buf
+		//! \param sourceHash hash of the text the cache should have been built from
+		//! \return true if the cache was loaded, false (with the wif cleared) if it is stale, from another format version / byte order, or corrupt
+		bool readCache(char const* buf, size_t len, uint64_t sourceHash);
+
+		//! read a wif file through a binary cache stored next to it (path + ".cache")
+		//! the text is hashed and the cache is loaded if it matches, otherwise the text is parsed and the cache is rewritten
+		//! \param path wif file to read
+		//! \note failing to write the cache isn't an error, the text is just parsed again next time
+		void loadCached(std::string const& path);
+
 		void clear() {*this = Wif();}
 
+	private:
+		//! format the wif as text, shared by the ostream and buffered writers so they always match
+		//! \param os std::ostream or text buffer to write to
+		template <typename Os> void writeText(Os& os) const;
+
+		//! sanityCheck with the tie up, threading, treadling, and lift plan taken from flat lists instead of the members (read parses them straight into this form)
+		//! \param threads number of threads to sort / check the independent lists with
+		//! \param lists lists of lists to check (emptied as they are moved into the dense arrays)
+		void sanityCheck(unsigned threads, wif_io::LayoutLists& lists);
+
 	};
 }
 
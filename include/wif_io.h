@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_WIF_IO_H_
+#define _CORVUS_WIF_IO_H_
+#pragma once
+
+#include "wif.h"
+
+#include <string_view>
+
+namespace corvus {
+	//! low level value parsing for wif text (exposed for benchmarking and custom WifParser handlers)
+	namespace wif_io {
+		//! parse a single wif integer (surrounding whitespace is allowed)
+		//! \param str text to parse
+		//! \return parsed value
+		//! \note throws invalid_argument for empty strings, trailing garbage (e.g. "12abc"), negative values, or overflow
+		Wif::Integer parse_int (std::string_view str);
+
+		//! parse a comma separated list of wif integers
+		//! \param str text to parse
+		//! \return parsed values
+		//! \note throws invalid_argument if any value can't be parsed by parse_int
+		Wif::VecInt  parse_vint(std::string_view str);
+	}
+}
+
+#endif//_CORVUS_WIF_IO_H_
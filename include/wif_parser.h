@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_WIF_PARSER_H_
+#define _CORVUS_WIF_PARSER_H_
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <stdexcept>
+#include <vector>
+#include <functional>
+#include <unordered_set>
+#include <memory_resource>
+#include <cctype>
+#include <cstdint>
+
+namespace corvus {
+
+	//! case insensitive comparison of raw bytes (section and key names in a wif are case insensitive)
+	//! \param a first string to compare
+	//! \param b second string to compare
+	//! \return true if a and b only differ in case
+	inline bool iequals(std::string_view a, std::string_view b) {
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0; i < a.size(); i++) {
+			if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) return false;
+		}
+		return true;
+	}
+
+	//! case insensitive hash of raw bytes (FNV-1a on lower case characters)
+	struct CaseHash {
+		size_t operator()(std::string_view str) const {
+			uint64_t h = 0xcbf29ce484222325ull;
+			for (char const& c : str) {
+				h ^= static_cast<uint64_t>(tolower(static_cast<unsigned char>(c)));
+				h *= 0x100000001b3ull;
+			}
+			return static_cast<size_t>(h);
+		}
+	};
+
+	//! case insensitive equality for hashed containers
+	struct CaseEqual {
+		bool operator()(std::string_view a, std::string_view b) const {return iequals(a, b);}
+	};
+
+	//! compile time perfect hash from a fixed set of (case insensitive) names to an enum
+	//! \tparam E enum listing the names in order followed by Unknown, e.g. enum class Key {Title, Author, Unknown}
+	//! \note the seed is searched for when the table is constructed so tables should be constexpr, a set of names without a perfect hash fails to compile
+	//! \note lookups hash the raw bytes in place then compare against at most one name, nothing is copied or case folded
+	template <typename E>
+	class NameTable {
+		public:
+			static constexpr size_t Count = static_cast<size_t>(E::Unknown); //!< number of names
+
+			//! build the table
+			//! \param n name of each enum value (in enum order)
+			template <typename... S>
+			constexpr explicit NameTable(S const&... n) : names{std::string_view(n)...}, slots{}, seed(0) {
+				static_assert(sizeof...(S) == Count, "need a name for every value");
+				for (seed = 1; seed < 0x10000; seed++) {
+					for (uint8_t& s : slots) s = Empty;
+					bool ok = true;
+					for (size_t i = 0; i < Count && ok; i++) {
+						uint8_t& s = slots[slot(names[i], seed)];
+						if (Empty != s) ok = false;
+						s = static_cast<uint8_t>(i);
+					}
+					if (ok) return;
+				}
+				throw std::logic_error("no perfect hash for names (are there duplicates?)");
+			}
+
+			//! look up a name
+			//! \param name name to find (case insensitive)
+			//! \return matching enum value or E::Unknown
+			constexpr E find(std::string_view name) const {
+				const uint8_t i = slots[slot(name, seed)];
+				if (Empty == i || name.size() != names[i].size()) return E::Unknown;
+				for (size_t j = 0; j < name.size(); j++) {
+					if (lower(name[j]) != lower(names[i][j])) return E::Unknown;
+				}
+				return static_cast<E>(i);
+			}
+
+			//! get the name of a value
+			//! \param e value to get name of (not Unknown)
+			//! \return name as passed to the constructor
+			constexpr std::string_view name(E e) const {return names[static_cast<size_t>(e)];}
+
+		private:
+			static_assert(Count < 0xFF, "NameTable indices are stored in bytes");
+
+			//! ascii lower case (the same as tolower in the "C" locale, which is all wif names use)
+			static constexpr uint8_t lower(char c) {return static_cast<uint8_t>(('A' <= c && c <= 'Z') ? c - 'A' + 'a' : c);}
+
+			//! number of bits to address a table with at least 8 slots per name (so a seed is found quickly)
+			static constexpr size_t bits() {
+				size_t b = 3;
+				while ((size_t(1) << b) < 8 * Count) b++;
+				return b;
+			}
+
+			static constexpr size_t  Bits  = bits(); //!< log2 of table size
+			static constexpr uint8_t Empty = 0xFF  ; //!< marker for unused slots
+
+			//! hash a name into a slot (FNV-1a on lower case bytes mixed with a seed)
+			//! \param str name to hash
+			//! \param s seed
+			//! \return slot index
+			static constexpr size_t slot(std::string_view str, uint64_t s) {
+				uint64_t h = 0xcbf29ce484222325ull ^ (s * 0x9e3779b97f4a7c15ull);
+				for (char const& c : str) {
+					h ^= lower(c);
+					h *= 0x100000001b3ull;
+				}
+				h ^= h >> 32;
+				h *= 0x9e3779b97f4a7c15ull;
+				return static_cast<size_t>(h >> (64 - Bits));
+			}
+
+			std::array<std::string_view, Count      > names; //!< name of each value
+			std::array<uint8_t         , 1ull << Bits> slots; //!< value in each slot (or Empty)
+			uint64_t                                    seed ; //!< seed that gives a perfect hash
+	};
+
+	//! event driven (SAX style) tokenizer for wif text
+	//! callers register handlers for the sections they care about and everything else is skipped
+	//! skipped sections are only scanned for the next section header, their lines are never split into keys and values
+	//! all names and values passed to handlers are slices of the original text (no case folding or trimming)
+	class WifParser {
+		public:
+			//! construct a parser
+			//! \param mr upstream for the parser's scratch memory (the names used to detect duplicates), it is all released when the parser is destroyed
+			//! \note the scratch memory is pooled so parsing more text with the same parser reuses it instead of going back to mr
+			explicit WifParser(std::pmr::memory_resource* mr = std::pmr::get_default_resource()) : pool(mr), sectionNames(0, CaseHash(), CaseEqual(), &pool), keyNames(0, CaseHash(), CaseEqual(), &pool) {}
+
+			//! callbacks for a single section, any of them may be empty
+			struct Handler {
+				std::function<void(std::string_view name)>                         begin; //!< called with the section name when the header is found
+				std::function<void(std::string_view key, std::string_view value)> key  ; //!< called for each key=value line
+				std::function<void(std::string_view name)>                         end  ; //!< called when the next section starts or the text ends
+			};
+
+			//! register a handler for a section
+			//! \param section name of section to handle (case insensitive)
+			//! \param h callbacks for the section
+			void on(std::string_view section, Handler h);
+
+			//! register a handler for a section that only needs the key=value pairs
+			//! \param section name of section to handle (case insensitive)
+			//! \param key callback for each key=value line
+			void on(std::string_view section, std::function<void(std::string_view key, std::string_view value)> key) {on(section, Handler{nullptr, key, nullptr});}
+
+			//! register a handler for every section without a specific handler
+			//! \param h callbacks for the sections
+			void onOther(Handler h) {other = h;}
+
+			//! tokenize wif text calling the registered handlers
+			//! \param buf start of wif text (doesn't need to be null terminated)
+			//! \param len number of bytes in buf
+			//! \note throws invalid_argument on malformed lines in handled sections, section headers are always checked
+			void parse(char const* buf, size_t len);
+
+			//! describe the current location in the text (for error messages thrown from inside a handler)
+			//! \return description of the current line
+			std::string lineDescr() const;
+
+			//! get the number of lines scanned by the last parse
+			//! \return line count
+			size_t lines() const {return lineNum;}
+
+		private:
+			//! find the handler for a section
+			//! \param name section name
+			//! \return handler for section or nullptr if it should be skipped
+			Handler const* find(std::string_view name) const;
+
+			std::vector< std::pair<std::string, Handler> > handlers   ; //!< section specific handlers
+			Handler                                        other      ; //!< handler for all other sections
+
+			// state during parsing (for error generation)
+			size_t                                         lineNum    ; //!< current line in text
+			std::string_view                               line       ; //!< contents of current line
+			size_t                                         sectLineNum; //!< line that has the header of the current section
+			std::string_view                               curSection ; //!< name of current section
+
+			std::pmr::unsynchronized_pool_resource                          pool                  ; //!< scratch memory for the name sets (keyNames is cleared for every section so its nodes are recycled)
+			std::pmr::unordered_set<std::string_view, CaseHash, CaseEqual> sectionNames, keyNames; //!< for duplicate detection
+	};
+}
+
+#endif//_CORVUS_WIF_PARSER_H_
@@ -0,0 +1,43 @@
+#include "batch.h"
+#include "parallel.h"
+
+#include <mutex>
+#include <algorithm>
+
+using namespace corvus;
+
+std::vector<LayoutResult> corvus::layoutBatch(Cell const* cells, size_t count, LayoutOptions const& opts, BatchCallbacks const& callbacks) {
+	// parallelism comes from running many cells at once, each cell's own tie up search stays on its worker
+	LayoutOptions cellOpts = opts;
+	cellOpts.threads = 1;
+
+	std::vector<LayoutResult> results(count);
+	std::vector<LayoutWorkspace> scratch(std::max<size_t>(1, std::min<size_t>(0 == opts.threads ? threadCount() : opts.threads, count)));
+	std::mutex lock; // serializes the callbacks
+	size_t finished = 0;
+	parallelForEach(count, opts.threads, [&](size_t i, size_t worker) {
+		if (callbacks.cancel) {
+			std::lock_guard<std::mutex> guard(lock);
+			if (callbacks.cancel()) return false;
+		}
+
+		// a bad cell shouldn't take down the rest of the batch so errors are kept with the result
+		LayoutResult& r = results[i];
+		try {
+			LayoutWorkspace& ws = scratch[worker];
+			r.shafts    = ws.layout(cells[i], cellOpts);
+			r.threading = ws.threading();
+			r.tieup     = ws.tieup    ();
+			r.treadling = ws.treadling();
+		} catch (...) {
+			r.error = std::current_exception();
+		}
+		r.done = true;
+
+		std::lock_guard<std::mutex> guard(lock);
+		++finished;
+		if (callbacks.progress) callbacks.progress(finished, count);
+		return true;
+	});
+	return results;
+}
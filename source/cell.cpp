@@ -1,14 +1,50 @@
 #include "cell.h"
+#include "parallel.h"
+#include "stats.h"
+#include "tieup.h"
+#include "wif.h"
 
-#include <set>
-#include <unordered_map>
 #include <algorithm>
-#include <iterator>
 #include <stdexcept>
 
 using namespace corvus;
 
+Cell::Cell(uint_fast32_t w, uint_fast32_t h, std::vector<uint_fast8_t> const& pixels) : Cell(w, h) {
+	if (pixels.size() != size_t(w) * size_t(h)) throw std::invalid_argument("pixel count doesn't match cell size");
+	for (uint_fast32_t j = 0; j < wefts; j++) {
+		const size_t offset = size_t(j) * size_t(warps); // get offset to start of the current weft
+		uint64_t* r = row(j);
+		for (uint_fast32_t i = 0; i < warps; i++) if (pixels[offset + i]) r[i / 64] |= uint64_t(1) << (i % 64);
+	}
+}
+
+std::vector<uint_fast8_t> Cell::unpack() const {
+	std::vector<uint_fast8_t> pixels(size_t(warps) * size_t(wefts), 0);
+	for (uint_fast32_t j = 0; j < wefts; j++) {
+		const size_t offset = size_t(j) * size_t(warps);
+		bits::forEach(row(j), rowWords(), [&](size_t i) {pixels[offset + i] = 1;});
+	}
+	return pixels;
+}
+
 uint_fast32_t Cell::layout(std::vector<uint_fast32_t>& threading, std::vector< std::vector<uint_fast32_t> >& tieup, std::vector< std::vector<uint_fast32_t> >& treadling) const {
+	return layout(threading, tieup, treadling, LayoutOptions());
+}
+
+uint_fast32_t Cell::layout(std::vector<uint_fast32_t>& threading, std::vector< std::vector<uint_fast32_t> >& tieup, std::vector< std::vector<uint_fast32_t> >& treadling, LayoutOptions const& opts) const {
+	return layoutRows(warps, wefts, [this](uint_fast32_t j, uint64_t*) {return row(j);}, threading, tieup, treadling, opts);
+}
+
+uint_fast32_t corvus::layoutRows(uint_fast32_t warps, uint_fast32_t wefts, RowSource const& row, std::vector<uint_fast32_t>& threading, std::vector< std::vector<uint_fast32_t> >& tieup, std::vector< std::vector<uint_fast32_t> >& treadling, LayoutOptions const& opts) {
+	LayoutWorkspace ws;
+	const uint_fast32_t shafts = ws.layout(warps, wefts, row, opts);
+	threading = ws.threading();
+	ws.tieup    ().toLists(tieup    );
+	ws.treadling().toLists(treadling);
+	return shafts;
+}
+
+uint_fast32_t LayoutWorkspace::layout(uint_fast32_t warps, uint_fast32_t wefts, RowSource const& row, LayoutOptions const& opts) {
 	// the algorithm we need to use here is called 'partition refinement'
 	// it is essentially dual to the more common disjoint set / union find structure
 	// the idea is that in the beginning all of our warps are in a single harness (set)
@@ -17,113 +53,178 @@ uint_fast32_t Cell::layout(std::vector<uint_fast32_t>& threading, std::vector< s
 	// for each shed:
 	//   loop over all the sets we have so far
 	//     split set into the union and the intersection with the shed (new set)
+	// the final partition can be built directly by grouping identical columns (see below)
 
 	// it is probably worth reducing down to unique shed types instead of doing every single weft in the entire design
-	// we'll nered to use a set/map of some type to achieve it
-	// ultimately (when building the tie up / treadling) it will be helpful to have a vectorized version
-	std::vector< std::vector<uint_fast32_t> > sheds; // every shed in the cell (list of lifted warps for each)
-	std::vector<uint_fast32_t> weftSheds; // index into sheds for every weft
-
-	{
-		// start by building up a list of all the sheds in our cell
-		std::set< std::vector<uint_fast32_t> > uniqueSheds; // unique sheds
-		std::vector< std::set< std::vector<uint_fast32_t> >::iterator > weftTypes; // the shed type for each weft
-		weftTypes.reserve(wefts);
-		for (uint_fast32_t j = 0; j < wefts; j++) { // loop over warps
-			std::vector<uint_fast32_t> s;
-			const size_t offset = size_t(j) * size_t(warps); // get offset to start of the current warp
-			for (uint_fast32_t i = 0; i < warps; i++) if (mask[offset + i]) s.push_back(i); // loop over threads building up those included in the shed (we end up with a sorted list)
-			weftTypes.push_back( uniqueSheds.insert(s).first ); // first is iterator to new or existing element
-		}
-
-		// now do the conversion to vectorized
-		sheds.assign(uniqueSheds.cbegin(), uniqueSheds.cend());
-		std::unordered_map<std::vector<uint_fast32_t>const*, uint_fast32_t> shedMap; // we really want std::set< std::vector<uint_fast32_t> >::iterator but that doesn't work without defining a hash
-		uint_fast32_t n = 0;
-		for (std::set< std::vector<uint_fast32_t> >::iterator iter = uniqueSheds.cbegin(); iter != uniqueSheds.cend(); ++iter) shedMap[&(*iter)] = n++;
-		weftSheds.resize(wefts);
-		for (uint_fast32_t j = 0; j < wefts; j++) weftSheds[j] = shedMap[&(*weftTypes[j])];
-	}
-	// now sheds contains a list of unique shed configurations
-	// weftSheds contains which shed is used for each weft
-	// the next step is to get a list of shafts
-	std::vector< std::vector<uint_fast32_t> > shafts; // for each shaft a list of warp threads that are lifted by it
-
-	{
-		// we could use std::vector<std::set> but why bother, we are going over everything in a pre-sorted order
-		// instead we can just store our sets vecotrized
-		// at each step we are essentially un-doing an std::inplace_merge (i.e. a std::partition)
-		             std::vector< std::pair<uint_fast32_t, bool> >             shaftSets(warps); // storage for our sets (we know the total number of elements never changed), bool is flag to help with std::partition 
-		std::vector< std::vector< std::pair<uint_fast32_t, bool> >::iterator > bounds = {shaftSets.begin(), shaftSets.end()}; // the index of the first element of each set in shafts, keep an end / +1 value for convenience
-		for (uint_fast32_t i = 0; i < warps; i++) shaftSets[i] = std::pair<uint_fast32_t, bool>(i, false); // we start with 1 set containing every warp
-
-		// loop over all of our sheds
-		std::vector< std::pair<uint_fast32_t, bool > > setI, setD, curShed;
-		setI.reserve(warps); setD.reserve(warps); curShed.reserve(warps);
-		for (std::vector<uint_fast32_t> const& x : sheds) { // loop over unique sheds
-			// build into pair<uint_fast32_t, bool> once
-			curShed.clear();
-			for (uint_fast32_t const& i : x) curShed.emplace_back(i, false);
-			for (size_t i = 1; i < bounds.size(); i++) { // loop over our sets doing the partition
-				// get our set bounds
-				std::vector< std::pair<uint_fast32_t, bool> >::iterator start = bounds[i-1]; // iterator to first element in current set
-				std::vector< std::pair<uint_fast32_t, bool> >::iterator end   = bounds[i  ]; // iterator past last element in current set
-
-				// construct intersection/difference
-				setI.clear(); std::set_intersection(start, end, curShed.begin(), curShed.end(), std::back_inserter(setI));
-				setD.clear(); std::set_difference  (start, end, curShed.begin(), curShed.end(), std::back_inserter(setD));
-				if (setI.empty() || setD.empty()) continue; // nothing to be done
-
-				// do the partitioning
-				for (auto iter = start; iter != end; ++iter) {
-					if (std::binary_search(setI.begin(), setI.end(), *iter)) iter->second = true; // flag intersection for partitioning
-				}
-				std::vector< std::pair<uint_fast32_t, bool> >::iterator mid = std::partition(start, end, [](std::pair<uint_fast32_t, bool> const& p){return p.second;});
-				
-				// update our list of sets
-				// note that std::partition doesn't preserve the relative order so the sets in 'shafts' are now unsorted
-				// we need to resort so that set_intersection/set_difference work on the next pass
-				std::sort(start, mid);
-				std::sort(mid  , end);
-				for (auto iter = start; iter != mid; ++iter) iter->second = false; // clear all the flags we just set
-
-				// now save the new set
-				bounds.insert(bounds.begin() + i, mid);
-				i++; // we don't have to check against the new set we just made
+	// each weft is already a packed bitmap so we can hash whole rows into an open addressing table
+	// nothing needs the sparse list of lifted warps for a shed, a packed copy of each unique weft is enough
+	// the rows may be generated on the fly (e.g. by a RepeatView) so only the copies are kept around
+	// every buffer is resized / cleared rather than reconstructed so repeated calls reuse their capacity
+	CORVUS_STATS_PHASES(timer, ShedDedup);
+	constexpr uint_fast32_t none = ~uint_fast32_t(0);
+	const size_t n = bits::words(warps); // words per row
+	shedRows.clear();
+	shedHash.clear();
+	weftSheds.resize(wefts);
+	rowBuff.resize(n);
+	shedTable.assign(16, none); // linear probing, power of 2 size
+	for (uint_fast32_t j = 0; j < wefts; j++) {
+		// start by finding all the unique sheds in our cell (numbered in order of first appearance)
+		uint64_t const* r = row(j, rowBuff.data());
+		const uint64_t h = bits::hash(r, n);
+		size_t slot = h & (shedTable.size() - 1);
+		while (true) {
+			const uint_fast32_t id = shedTable[slot];
+			if (none == id) { // this is a new shed
+				shedTable[slot] = weftSheds[j] = static_cast<uint_fast32_t>(shedHash.size());
+				shedRows.insert(shedRows.end(), r, r + n);
+				shedHash.push_back(h);
+				break;
+			} else if (h == shedHash[id] && bits::equal(shedRows.data() + id * n, r, n)) { // we've seen this shed before
+				weftSheds[j] = id;
+				break;
 			}
+			slot = (slot + 1) & (shedTable.size() - 1);
 		}
 
-		// save a softed copy of the shafts we have
-		// there isn't any 1 particular rule that makes the most sense for numbering shafts
-		// I'll sort so that the most populated harnesses come first with lexicographic compare as a tie break
-		auto shaftSort = [](std::vector<uint_fast32_t>const& lhs, std::vector<uint_fast32_t>const& rhs) {
-			return lhs.size() == rhs.size() ? std::lexicographical_compare(lhs.cbegin(), lhs.cend(), rhs.cbegin(), rhs.cend()) : lhs.size() > rhs.size();
-		};
-		shafts.resize(bounds.size() - 1);
-		for (size_t i = 1; i < bounds.size(); i++) {
-			for (auto iter = bounds[i-1]; iter != bounds[i]; ++iter) shafts[i-1].push_back(iter->first); // discard the bools that were used for partitioning
+		// keep the table at most half full
+		if (2 * shedHash.size() > shedTable.size()) {
+			shedTable.assign(shedTable.size() * 2, none);
+			for (uint_fast32_t id = 0; id < shedHash.size(); id++) {
+				size_t k = shedHash[id] & (shedTable.size() - 1);
+				while (none != shedTable[k]) k = (k + 1) & (shedTable.size() - 1);
+				shedTable[k] = id;
+			}
 		}
-		std::sort(shafts.begin(), shafts.end(), shaftSort);
 	}
 
-	// now that we have partitioned the warps into shafts we can build up the threading
-	threading.resize(warps);
-	for (size_t i = 1; i < shafts.size(); i++) {
-		for (uint_fast32_t const& w : shafts[i]) {
-			threading[w] = static_cast<uint_fast32_t>(i); // should be safe unless we have 2^32 warps...
+	// the tie up / treadling number sheds in lexicographic order of their lifted warp lists (historically the order of a std::set)
+	// sorting just the unique sheds keeps that numbering and is cheap since there are typically few of them
+	auto listLess = [n](uint64_t const* a, uint64_t const* b) {
+		// compare 2 packed sheds as if they were sorted lists of warp indices
+		for (size_t w = 0; w < n; w++) {
+			const uint64_t d = a[w] ^ b[w];
+			if (0 == d) continue;
+
+			// the lists match up to the first differing warp k, exactly one of them has k
+			// the one with k is smaller if the other list continues past k (with something > k) and larger if the other list ends
+			const size_t k = bits::ctz(d);
+			const bool aHas = 0 != ( (a[w] >> k) & 1 );
+			uint64_t const* other = aHas ? b : a;
+			bool more = 63 != k && 0 != (other[w] >> (k + 1));
+			for (size_t v = w + 1; v < n && !more; v++) more = 0 != other[v];
+			return aHas == more;
 		}
+		return false; // identical
+	};
+	const size_t numSheds = shedHash.size();
+	order.resize(numSheds);
+	for (uint_fast32_t id = 0; id < order.size(); id++) order[id] = id;
+	std::sort(order.begin(), order.end(), [&](uint_fast32_t lhs, uint_fast32_t rhs) {return listLess(shedRows.data() + lhs * n, shedRows.data() + rhs * n);});
+	rank.resize(numSheds);
+	sortedRows.resize(shedRows.size());
+	for (uint_fast32_t k = 0; k < order.size(); k++) {
+		rank[order[k]] = k;
+		std::copy(shedRows.cbegin() + order[k] * n, shedRows.cbegin() + (order[k] + 1) * n, sortedRows.begin() + k * n);
 	}
+	shedRows.swap(sortedRows);
+	for (uint_fast32_t& s : weftSheds) s = rank[s];
+	CORVUS_STATS_COUNT(UniqueSheds, numSheds);
+	CORVUS_STATS_NEXT(timer, Partition);
 
-	// next determine which shafts are needed for each shed
-	std::vector< std::vector<uint_fast32_t> > shedShafts(sheds.size());
-	for (size_t j = 0; j < sheds.size(); j++) { // loop over the shed configurations
-		for (size_t i = 0; i < shafts.size(); i++) { // loop over shafts
-			if (std::includes(sheds[j].cbegin(), sheds[j].cend(), shafts[i].cbegin(), shafts[i].cend())) {
-				shedShafts[j].push_back(static_cast<uint_fast32_t>(i)); // if we have more than 2^32 shafts we have bigger problems
+	// now shedRows contains each of the unique shed configurations
+	// weftSheds contains which shed is used for each weft
+	// the next step is to get a list of shafts
+	// in the final partition two warps share a set exactly when every shed either lifts both or neither
+	// i.e. when their columns (restricted to the unique sheds) are identical
+	// so instead of refining the partition one shed at a time we can build a signature for each column and group identical ones by hash
+	const size_t sigWords = bits::words(numSheds); // words in each column signature
+	signatures.assign(sigWords * warps, 0);
+	colHash.resize(warps);
+
+	// transpose the representative wefts into column signatures and hash them
+	// each thread gets a block of words from every row (i.e. a contiguous block of warps) so no signature is written by 2 threads
+	parallelFor(n, 16, opts.threads, [&](size_t wBeg, size_t wEnd) {
+		for (size_t k = 0; k < numSheds; k++) {
+			uint64_t const* r = shedRows.data() + k * n;
+			const uint64_t bit = uint64_t(1) << (k % 64);
+			for (size_t w = wBeg; w < wEnd; w++) {
+				for (uint64_t x = r[w]; 0 != x; x &= x - 1) signatures[(w * 64 + bits::ctz(x)) * sigWords + k / 64] |= bit;
+			}
+		}
+		const size_t iEnd = std::min<size_t>(wEnd * 64, warps);
+		for (size_t i = wBeg * 64; i < iEnd; i++) colHash[i] = bits::hash(signatures.data() + i * sigWords, sigWords);
+	});
+
+	// now group identical columns in a single pass over the warps with another open addressing table
+	// different columns can (rarely) share a hash so matching hashes are checked word by word
+	// groups are numbered in order of their first warp
+	size_t tableSize = 16;
+	while (tableSize < 2 * size_t(warps)) tableSize *= 2; // at most half full
+	groupTable.assign(tableSize, none);
+	groupOf.resize(warps);
+	groupRep.clear();
+	groupSize.clear();
+	for (uint_fast32_t i = 0; i < warps; i++) {
+		uint64_t const* sig = signatures.data() + size_t(i) * sigWords;
+		size_t slot = colHash[i] & (tableSize - 1);
+		while (true) {
+			const uint_fast32_t g = groupTable[slot];
+			if (none == g) { // this is a new group
+				groupTable[slot] = groupOf[i] = static_cast<uint_fast32_t>(groupRep.size());
+				groupRep.push_back(i);
+				groupSize.push_back(1);
+				break;
+			} else if (colHash[i] == colHash[groupRep[g]] && bits::equal(sig, signatures.data() + size_t(groupRep[g]) * sigWords, sigWords)) {
+				groupOf[i] = g;
+				++groupSize[g];
+				break;
 			}
+			slot = (slot + 1) & (tableSize - 1);
 		}
 	}
 
+	// number the shafts
+	// there isn't any 1 particular rule that makes the most sense for numbering shafts
+	// I'll sort so that the most populated harnesses come first with lexicographic compare as a tie break
+	// the shafts are disjoint and sorted so the lexicographic compare only needs the first warp (i.e. the group number)
+	// partition refinement of an empty set still gives a single (empty) shaft
+	const size_t numShafts = 0 == warps ? 1 : groupRep.size();
+	order.resize(groupRep.size());
+	for (uint_fast32_t g = 0; g < order.size(); g++) order[g] = g;
+	std::sort(order.begin(), order.end(), [&](uint_fast32_t lhs, uint_fast32_t rhs) {
+		return groupSize[lhs] == groupSize[rhs] ? lhs < rhs : groupSize[lhs] > groupSize[rhs];
+	});
+	rank.resize(groupRep.size());
+	shaftRep.resize(groupRep.size());
+	for (uint_fast32_t k = 0; k < order.size(); k++) {
+		rank[order[k]] = k;
+		shaftRep[k] = groupRep[order[k]];
+	}
+
+	// now that we have partitioned the warps into shafts we can build up the threading
+	threadingOut.resize(warps);
+	for (uint_fast32_t i = 0; i < warps; i++) threadingOut[i] = rank[groupOf[i]];
+	CORVUS_STATS_COUNT(PartitionGroups, groupRep.size());
+	CORVUS_STATS_NEXT(timer, TieUp);
+
+	// next determine which shafts are needed for each shed
+	// every warp on a shaft has the same signature so a shaft is part of a shed exactly when its representative is
+	// count the shafts in each shed first so the lists can be filled in place (in shaft order)
+	auto forEachShed = [&](size_t s, auto f) {
+		if (0 == warps) { // only possible without any warps, an empty set is part of every shed
+			for (size_t k = 0; k < numSheds; k++) f(k);
+		} else {
+			bits::forEach(signatures.data() + size_t(shaftRep[s]) * sigWords, sigWords, f);
+		}
+	};
+	shedShafts.offsets.assign(numSheds + 1, 0);
+	for (size_t s = 0; s < numShafts; s++) forEachShed(s, [&](size_t k) {++shedShafts.offsets[k+1];});
+	for (size_t k = 0; k < numSheds; k++) shedShafts.offsets[k+1] += shedShafts.offsets[k];
+	shedShafts.values.resize(shedShafts.offsets.back());
+	cursor.assign(shedShafts.offsets.cbegin(), shedShafts.offsets.cend() - 1);
+	for (size_t s = 0; s < numShafts; s++) forEachShed(s, [&](size_t k) {shedShafts.values[cursor[k]++] = static_cast<uint_fast32_t>(s);}); // if we have more than 2^32 shafts we have bigger problems
+
 	// next determine the tie up, this is the hardest part if we have a finite number of treadles
 	// what we want is to optimize the tie up (minimize total treadle presses)
 	// the objective function we would like minimize is the maximum number of simultaneous treadle presses
@@ -137,42 +238,278 @@ uint_fast32_t Cell::layout(std::vector<uint_fast32_t>& threading, std::vector< s
 	// there is a nice brute force approach implemeted by "tim's treadle reducer"
 	// https://cs.earlham.edu/~timm/treadle/index.php
 
-	// we may want an optional user parameter for how many treadles are available
-	size_t availableTreadles = shafts.size(); // we could allow a user to say that have e.g. 6 treadles for a 4 shaft design
-	if (availableTreadles < shafts.size()) throw std::invalid_argument("not enough treadles for design"); // since we have the optimum threading we need at least that many treadles
+	// a user can say they have e.g. 6 treadles for a 4 shaft design
+	const size_t availableTreadles = 0 == opts.treadles ? numShafts : opts.treadles;
+	if (availableTreadles < numShafts) throw std::invalid_argument("not enough treadles for design"); // since we have the optimum threading we need at least that many treadles
 
 	// now that we have our set covering weights, do the greedy set cover
-	if (sheds.size() <= availableTreadles) { // trivial case
+	tieupOut.clear();
+	treadlingOut.clear();
+	if (numSheds <= availableTreadles) { // trivial case
 		// we just assign a shed to each treadle
-		tieup.resize(shedShafts.size());
-		for (size_t i = 0; i < shedShafts.size(); i++) tieup[i] = shedShafts[i];
+		tieupOut.offsets = shedShafts.offsets;
+		tieupOut.values  = shedShafts.values ;
 
 		// treadling is trivial as well
-		treadling.resize(wefts);
-		for (uint_fast32_t j = 0; j < wefts; j++) treadling[j] = std::vector<uint_fast32_t>(1, weftSheds[j]);
-	} else {
-		// TODO try building a reduced treadling using tim's algorithm
+		for (uint_fast32_t j = 0; j < wefts; j++) treadlingOut.push(weftSheds[j]);
+	} else if (numShafts <= 64) {
+		// search for a skeleton tie up that needs fewer simultaneous presses than a straight tie up
+		// the search works on shafts as bitmasks, beyond 64 shafts we just use the straight tie up below
+		shedMasks.assign(numSheds, 0);
+		size_t straightPresses = 0; // most treadles pressed at once with a straight tie up
+		for (size_t k = 0; k < numSheds; k++) {
+			for (uint_fast32_t const* s = shedShafts.begin(k); s != shedShafts.end(k); ++s) shedMasks[k] |= uint64_t(1) << *s;
+			straightPresses = std::max(straightPresses, shedShafts.count(k));
+		}
+		const std::vector<uint64_t> treadles = skeletonTieup(shedMasks, availableTreadles, straightPresses, opts.timeLimit, opts.threads);
+
+		if (!treadles.empty()) {
+			for (uint64_t const& t : treadles) {
+				bits::forEach(&t, 1, [&](size_t s) {tieupOut.values.push_back(static_cast<uint_fast32_t>(s));});
+				tieupOut.offsets.push_back(tieupOut.values.size());
+			}
+
+			// find the presses for each unique shed once and copy them out to the wefts
+			shedPress.clear();
+			for (size_t k = 0; k < numSheds; k++) {
+				const std::vector<uint_fast32_t> p = pressTreadles(shedMasks[k], treadles);
+				shedPress.push(p.data(), p.data() + p.size());
+			}
+			for (uint_fast32_t j = 0; j < wefts; j++) treadlingOut.push(shedPress.begin(weftSheds[j]), shedPress.end(weftSheds[j]));
+		}
 	}
 
-	if (tieup.empty()) { // we don't have enough treadles to 
+	if (0 == tieupOut.size()) { // we don't have enough treadles to 
 		// build straight tieup, this always works but it may not be pretty (e.g. on an n shaft loom you may need to press n-1 treadles at once)
-		tieup.resize(shafts.size());
-		for (size_t i = 0; i < shafts.size(); i++) tieup[i] = std::vector<uint_fast32_t>(1, static_cast<uint_fast32_t>(i)); // if we have more than 2^32 shafts we have bigger problems
+		for (size_t i = 0; i < numShafts; i++) tieupOut.push(static_cast<uint_fast32_t>(i)); // if we have more than 2^32 shafts we have bigger problems
 
 		// finally build treadling
 		// for a straight tie up this is easy
-		treadling.resize(wefts);
-		for (uint_fast32_t j = 0; j < wefts; j++) treadling[j] = shedShafts[weftSheds[j]];
+		treadlingOut.clear();
+		for (uint_fast32_t j = 0; j < wefts; j++) treadlingOut.push(shedShafts.begin(weftSheds[j]), shedShafts.end(weftSheds[j]));
 	}
 
 	// not helpful for a straight tieup but could be useful otherwise
 	// we could also pass in an allowable number of shafts to make less minimal shaft but more user friendly tieups
-	return static_cast<uint_fast32_t>(shafts.size()); // we have bigger issues if there are more than 2^32 shafts...
+	return static_cast<uint_fast32_t>(numShafts); // we have bigger issues if there are more than 2^32 shafts...
+}
+
+
+Cell corvus::fromWif(Wif const& wif) {
+	// the drawdown is a boolean matrix product of the lift plan (weft x shaft) and the threading (shaft x warp)
+	// both are stored as packed bits so each weft is the OR of the threading rows of its lifted shafts, 64 warps at a time
+	Cell cell(wif.warpThreads, wif.weftThreads);
+	const size_t n = cell.rowWords();
+	const size_t shafts = wif.shafts;
+	const size_t liftWords = wif.shaftWords();
+
+	// build the warps on each shaft (shaft 0 means unthreaded), a warp on multiple shafts is just in multiple rows
+	std::vector<uint64_t> threading(shafts * n, 0);
+	Wif::Threads const& warp = wif.warp;
+	if (warp.shafts.size() > wif.warpThreads) throw std::invalid_argument("threading is longer than warp threads");
+	for (size_t i = 0; i < warp.shafts.size(); i++) {
+		for (Wif::Integer const* s = warp.shafts.begin(i); s != warp.shafts.end(i); ++s) {
+			if (*s > shafts) throw std::invalid_argument("threading uses shaft number greater than shaft count");
+			if (0 != *s) bits::set(threading.data() + (*s - 1) * n, i, true);
+		}
+	}
+
+	// the shafts lifted for each weft are already packed (sanityCheck always builds the lift plan)
+	std::vector<uint64_t> const& lift = wif.liftMasks;
+	if (lift.size() != size_t(wif.weftThreads) * liftWords) throw std::invalid_argument("lift plan doesn't match weft thread count");
+
+	// finally do the product, each thread gets a band of wefts
+	// on a falling shed the treadles lower the tied shafts so everything else shows warp
+	parallelFor(wif.weftThreads, 64, [&](size_t jBeg, size_t jEnd) {
+		for (size_t j = jBeg; j < jEnd; j++) {
+			uint64_t* r = cell.row(static_cast<uint_fast32_t>(j));
+			bits::forEach(lift.data() + j * liftWords, liftWords, [&](size_t s) {bits::orRow(r, threading.data() + s * n, n);});
+			if (!wif.risingShed) bits::invert(r, cell.warps);
+		}
+	});
+	return cell;
+}
+
+namespace {
+	//! find the smallest period of a sequence from item hashes, confirming each candidate exactly
+	//! \param h hash of each item
+	//! \param same exact check that p is a period, called as same(p)
+	//! \return smallest confirmed period (h.size() if nothing smaller works)
+	template <typename F> size_t smallestPeriod(std::vector<uint64_t> const& h, F same) {
+		// the prefix function gives every border of the sequence and each border b makes n - b a candidate period
+		// the border chain is visited from longest to shortest so candidates come out smallest first
+		const size_t n = h.size();
+		if (0 == n) return 0;
+		std::vector<size_t> pi(n, 0);
+		for (size_t i = 1; i < n; i++) {
+			size_t k = pi[i-1];
+			while (k > 0 && h[i] != h[k]) k = pi[k-1];
+			if (h[i] == h[k]) ++k;
+			pi[i] = k;
+		}
+		for (size_t b = pi[n-1]; b > 0; b = pi[b-1]) if (same(n - b)) return n - b; // only a hash collision can fail here
+		return n;
+	}
+
+	//! check if a row matches another row shifted left
+	//! \param lo row to shift
+	//! \param hi row to compare against
+	//! \param words number of words in lo
+	//! \param a bits to shift lo by
+	//! \param n number of bits to compare
+	//! \return true if hi[i] == lo[i + a] for all i < n
+	bool shiftedEqual(uint64_t const* lo, uint64_t const* hi, size_t words, size_t a, size_t n) {
+		const size_t full = n / 64;
+		for (size_t w = 0; w < full; w++) if (bits::window(lo, words, 64 * w + a) != hi[w]) return false;
+		if (0 == n % 64) return true;
+		return 0 == ((bits::window(lo, words, 64 * full + a) ^ hi[full]) & bits::tailMask(n));
+	}
+
+	//! count the set bits at the start of a row
+	//! \param row row to count
+	//! \param p number of bits to count
+	//! \return number of the first p bits that are set
+	size_t countPrefix(uint64_t const* row, size_t p) {
+		size_t c = bits::count(row, p / 64);
+		if (0 != p % 64) c += bits::popcount(row[p / 64] & bits::tailMask(p));
+		return c;
+	}
+
+	//! check if p is a period of a sequence
+	//! \param v sequence to check
+	//! \param p candidate period
+	//! \return true if v[k] == v[k + p] everywhere both exist
+	bool isPeriod(std::vector<size_t> const& v, size_t p) {
+		for (size_t k = 0; k + p < v.size(); k++) if (v[k] != v[k + p]) return false;
+		return true;
+	}
+
+	//! repeat the first p bits of a row out to p + 64 bits so a 64 bit window can start anywhere in the period
+	//! \param row row to repeat
+	//! \param p period in bits
+	//! \return expanded row
+	std::vector<uint64_t> expandPeriod(uint64_t const* row, size_t p) {
+		std::vector<uint64_t> e(bits::words(p + 64), 0);
+		for (size_t k = 0; k < p + 64; k++) if (bits::test(row, k % p)) bits::set(e.data(), k, true);
+		return e;
+	}
+}
+
+Cell Cell::crop(uint_fast32_t x, uint_fast32_t y, uint_fast32_t w, uint_fast32_t h) const {
+	if (uint64_t(x) + w > warps || uint64_t(y) + h > wefts) throw std::invalid_argument("crop extends past edge of cell");
+	Cell c(w, h);
+	const size_t n = rowWords(), cw = c.rowWords();
+	for (uint_fast32_t j = 0; j < h; j++) {
+		uint64_t* r = c.row(j);
+		for (size_t k = 0; k < cw; k++) r[k] = bits::window(row(y + j), n, x + 64 * k);
+		if (0 != cw) r[cw - 1] &= bits::tailMask(w);
+	}
+	return c;
 }
 
+Repeat Cell::findRepeat() const {
+	Repeat rep = {warps, wefts, wefts, 0, warps, 0};
+	if (0 == warps || 0 == wefts) return rep;
+	const size_t n = rowWords();
+	const size_t W = warps, H = wefts;
+
+	// transpose 64 x 64 blocks to get packed columns so warps can be hashed / compared as cheaply as wefts
+	const size_t hw = bits::words(H);
+	std::vector<uint64_t> cols(W * hw);
+	parallelFor(n, 4, [&](size_t wBeg, size_t wEnd) {
+		uint64_t blk[64];
+		for (size_t w = wBeg; w < wEnd; w++) {
+			for (size_t b = 0; b < hw; b++) {
+				for (size_t k = 0; k < 64; k++) blk[k] = 64 * b + k < H ? row(static_cast<uint_fast32_t>(64 * b + k))[w] : 0;
+				bits::transpose(blk);
+				for (size_t k = 0; k < 64 && 64 * w + k < W; k++) cols[(64 * w + k) * hw + b] = blk[k];
+			}
+		}
+	});
+	auto col = [&](size_t i) {return cols.data() + i * hw;};
+
+	// hash every weft and warp then find the straight periods from the hash sequences
+	std::vector<uint64_t> rowHash(H), colHash(W);
+	parallelFor(H, 256, [&](size_t jBeg, size_t jEnd) {for (size_t j = jBeg; j < jEnd; j++) rowHash[j] = bits::hash(row(static_cast<uint_fast32_t>(j)), n);});
+	parallelFor(W, 256, [&](size_t iBeg, size_t iEnd) {for (size_t i = iBeg; i < iEnd; i++) colHash[i] = bits::hash(col(i), hw);});
+	const size_t px = smallestPeriod(colHash, [&](size_t p) {
+		for (size_t i = 0; i + p < W; i++) if (!bits::equal(col(i), col(i + p), hw)) return false;
+		return true;
+	});
+	const size_t py = smallestPeriod(rowHash, [&](size_t p) {
+		for (size_t j = 0; j + p < H; j++) if (!bits::equal(row(static_cast<uint_fast32_t>(j)), row(static_cast<uint_fast32_t>(j + p)), n)) return false;
+		return true;
+	});
+	rep.warps = rep.dropWarps = static_cast<uint_fast32_t>(px);
+	rep.wefts = rep.bandWefts = static_cast<uint_fast32_t>(py);
+
+	// check that (i + a, j) matches (i, j + b) everywhere both are in the cell (a may be negative)
+	auto matches = [&](int64_t a, size_t b) {
+		const size_t s = static_cast<size_t>(a < 0 ? -a : a);
+		if (s >= W || b >= H) return true; // no overlap
+		for (size_t j = 0; j + b < H; j++) {
+			uint64_t const* lo = row(static_cast<uint_fast32_t>(j    ));
+			uint64_t const* hi = row(static_cast<uint_fast32_t>(j + b));
+			if (!(a < 0 ? shiftedEqual(hi, lo, n, s, W - s) : shiftedEqual(lo, hi, n, s, W - s))) return false;
+		}
+		return true;
+	};
+
+	// when the cell holds at least 2 straight repeats any smaller unit is a lattice of translations containing the straight repeat
+	// so a band height must divide the vertical period and a drop width must divide the horizontal period
+	// otherwise (e.g. the band shift doesn't come back around within the cell) there is nothing to divide and every size is tried
+	// a band shift rotates the first period of each weft so the number of raised warps in it has to repeat every band (and the same for drops)
+	// those counts rule out almost every size before any shifts are compared
+	// for each candidate size the first 64 bits of the shifted row / column filter shifts before the full check
+	const uint64_t rowMask = W < 64 ? bits::tailMask(W) : ~uint64_t(0);
+	const uint64_t colMask = H < 64 ? bits::tailMask(H) : ~uint64_t(0);
+	const bool everyBand = 2 * py > H, everyDrop = 2 * px > W;
+	if (px > 1) {
+		std::vector<size_t> rowCount;
+		if (everyBand) {
+			rowCount.resize(H);
+			for (size_t j = 0; j < H; j++) rowCount[j] = countPrefix(row(static_cast<uint_fast32_t>(j)), px);
+		}
+		const std::vector<uint64_t> e = expandPeriod(row(0), px);
+		for (size_t h = 1; h < py && rep.bandWefts == py; h++) {
+			if (everyBand ? !isPeriod(rowCount, h) : 0 != py % h) continue;
+			const uint64_t target = row(static_cast<uint_fast32_t>(h))[0] & rowMask;
+			for (size_t o = 1; o < px; o++) {
+				if ((bits::window(e.data(), e.size(), o) & rowMask) != target) continue;
+				if (matches(int64_t(o), h) && matches(int64_t(o) - int64_t(px), h)) {
+					rep.bandWefts = static_cast<uint_fast32_t>(h);
+					rep.bandShift = static_cast<uint_fast32_t>(o);
+					break;
+				}
+			}
+		}
+	}
+	if (py > 1) {
+		std::vector<size_t> colCount;
+		if (everyDrop) {
+			colCount.resize(W);
+			for (size_t i = 0; i < W; i++) colCount[i] = countPrefix(col(i), py);
+		}
+		const std::vector<uint64_t> e = expandPeriod(col(0), py);
+		for (size_t a = 1; a < px && rep.dropWarps == px; a++) {
+			if (everyDrop ? !isPeriod(colCount, a) : 0 != px % a) continue;
+			const uint64_t target = col(a)[0] & colMask;
+			for (size_t d = 1; d < py; d++) {
+				if ((bits::window(e.data(), e.size(), d) & colMask) != target) continue;
+				if (matches(int64_t(a), d) && matches(-int64_t(a), py - d)) {
+					rep.dropWarps = static_cast<uint_fast32_t>(a);
+					rep.dropShift = static_cast<uint_fast32_t>(d);
+					break;
+				}
+			}
+		}
+	}
+	return rep;
+}
 
 void Cell::writeWeft(uint_fast32_t r, std::ostream& os, char warpSymb, char weftSymb) const {
-	for (uint_fast32_t c = 0; c < warps; c++) os << ' ' << (mask[r * warps + c] ? '#' : '.');
+	uint64_t const* w = row(r);
+	for (uint_fast32_t c = 0; c < warps; c++) os << ' ' << (bits::test(w, c) ? warpSymb : weftSymb);
 }
 
 void Cell::write(std::ostream& os, char warpSymb, char weftSymb) const {
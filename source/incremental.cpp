@@ -0,0 +1,225 @@
+#include "incremental.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace corvus;
+
+namespace {
+	constexpr uint_fast32_t none = ~uint_fast32_t(0);
+
+	//! insert a value into a sorted list
+	//! \param v sorted list
+	//! \param x value to insert
+	void insertSorted(std::vector<uint_fast32_t>& v, uint_fast32_t x) {v.insert(std::lower_bound(v.begin(), v.end(), x), x);}
+
+	//! remove a value from a sorted list
+	//! \param v sorted list
+	//! \param x value to remove (must be in the list)
+	void eraseSorted(std::vector<uint_fast32_t>& v, uint_fast32_t x) {v.erase(std::lower_bound(v.begin(), v.end(), x));}
+}
+
+IncrementalLayout::IncrementalLayout(uint_fast32_t warps) : numWarps(warps), rowBuff(bits::words(warps)), shaftOf(warps, 0), warpPos(warps), sigWords(1) {
+	// before any sheds every warp is on a single shaft (an empty shaft if there are no warps, like Cell::layout)
+	members.emplace_back();
+	for (uint_fast32_t i = 0; i < warps; i++) {
+		warpPos[i] = i;
+		members[0].push_back(i);
+	}
+	signatures.assign(sigWords, 0);
+	cutCount.assign(1, 0);
+	splitTo .assign(1, none);
+}
+
+IncrementalLayout::IncrementalLayout(Cell const& cell) : IncrementalLayout(cell.warps) {
+	for (uint_fast32_t j = 0; j < cell.wefts; j++) appendWeft(cell.row(j));
+}
+
+void IncrementalLayout::appendWeft(uint64_t const* row) {
+	const size_t n = rowWords();
+	std::copy(row, row + n, rowBuff.begin());
+	if (0 != n) rowBuff[n-1] &= bits::tailMask(numWarps);
+	weftShed.push_back(useShed(rowBuff.data()));
+}
+
+void IncrementalLayout::setWeft(uint_fast32_t j, uint64_t const* row) {
+	if (j >= weftShed.size()) throw std::invalid_argument("weft index outside of weft count");
+	const size_t n = rowWords();
+	std::copy(row, row + n, rowBuff.begin());
+	if (0 != n) rowBuff[n-1] &= bits::tailMask(numWarps);
+
+	// add the new shed before releasing the old one so an unchanged weft doesn't split and merge
+	const uint_fast32_t old = weftShed[j];
+	weftShed[j] = useShed(rowBuff.data());
+	releaseShed(old);
+}
+
+uint_fast32_t IncrementalLayout::useShed(uint64_t const* row) {
+	// check if we've already seen this shed
+	const size_t n = rowWords();
+	const uint64_t h = bits::hash(row, n);
+	auto range = shedIndex.equal_range(h);
+	for (auto iter = range.first; iter != range.second; ++iter) {
+		if (bits::equal(shedRows.data() + iter->second * n, row, n)) {
+			++shedUses[iter->second];
+			return iter->second;
+		}
+	}
+
+	// this is a new shed, reuse an empty treadle if there is one
+	uint_fast32_t k;
+	if (freeSheds.empty()) {
+		k = static_cast<uint_fast32_t>(shedHash.size());
+		shedRows.resize(shedRows.size() + n);
+		shedHash.push_back(0);
+		shedUses.push_back(0);
+		shedShafts.emplace_back();
+	} else {
+		k = freeSheds.back();
+		freeSheds.pop_back();
+	}
+	std::copy(row, row + n, shedRows.begin() + k * n);
+	shedHash[k] = h;
+	shedUses[k] = 1;
+	shedIndex.emplace(h, k);
+
+	// make room for the new shed in the signatures
+	if (k >= 64 * sigWords) {
+		const size_t newWords = std::max(2 * sigWords, bits::words(k + 1));
+		std::vector<uint64_t> grown(members.size() * newWords, 0);
+		for (size_t s = 0; s < members.size(); s++) std::copy(signature(s), signature(s) + sigWords, grown.begin() + s * newWords);
+		signatures.swap(grown);
+		sigWords = newWords;
+	}
+	const uint64_t bit = uint64_t(1) << (k % 64);
+	std::vector<uint_fast32_t>& lifted = shedShafts[k];
+	if (0 == numWarps) { // the empty shaft is part of every shed
+		signature(0)[k / 64] |= bit;
+		lifted.push_back(0);
+		return k;
+	}
+
+	// this is a single step of partition refinement
+	// count how many warps of each shaft the shed lifts, shafts that are only partly lifted are split in 2
+	bits::forEach(row, n, [&](size_t i) {
+		const uint_fast32_t s = shaftOf[i];
+		if (0 == cutCount[s]++) cut.push_back(s);
+	});
+	for (uint_fast32_t const& s : cut) {
+		if (cutCount[s] < members[s].size()) { // split off the lifted warps onto a new shaft with the same sheds + this one
+			const uint_fast32_t s2 = static_cast<uint_fast32_t>(members.size());
+			splitTo[s] = s2;
+			members.emplace_back();
+			signatures.resize(signatures.size() + sigWords);
+			std::copy(signature(s), signature(s) + sigWords, signature(s2));
+			cutCount.push_back(0);
+			splitTo .push_back(none);
+			bits::forEach(signature(s), sigWords, [&](size_t t) {insertSorted(shedShafts[t], s2);});
+			signature(s2)[k / 64] |= bit;
+			lifted.push_back(s2);
+		} else { // the whole shaft is lifted
+			signature(s)[k / 64] |= bit;
+			lifted.push_back(s);
+		}
+	}
+	bits::forEach(row, n, [&](size_t i) {
+		const uint_fast32_t s = shaftOf[i];
+		const uint_fast32_t s2 = splitTo[s];
+		if (none == s2) return;
+
+		// swap remove from the old shaft and append to the new one
+		std::vector<uint_fast32_t>& from = members[s];
+		const uint_fast32_t moved = from.back();
+		from[warpPos[i]] = moved;
+		warpPos[moved] = warpPos[i];
+		from.pop_back();
+		shaftOf[i] = s2;
+		warpPos[i] = static_cast<uint_fast32_t>(members[s2].size());
+		members[s2].push_back(static_cast<uint_fast32_t>(i));
+	});
+	for (uint_fast32_t const& s : cut) {
+		cutCount[s] = 0;
+		splitTo [s] = none;
+	}
+	cut.clear();
+	std::sort(lifted.begin(), lifted.end());
+	return k;
+}
+
+void IncrementalLayout::releaseShed(uint_fast32_t k) {
+	if (0 != --shedUses[k]) return;
+
+	// the shed is gone, remove it from the table and free up its treadle
+	auto range = shedIndex.equal_range(shedHash[k]);
+	for (auto iter = range.first; iter != range.second; ++iter) {
+		if (k == iter->second) {
+			shedIndex.erase(iter);
+			break;
+		}
+	}
+	std::vector<uint_fast32_t> lifted;
+	lifted.swap(shedShafts[k]);
+	freeSheds.push_back(k);
+
+	// the only shafts that can merge now are pairs that were separated by just this shed
+	// one of the pair was lifted by the shed and the other wasn't, so look for a partner of each lifted shaft
+	// a partner is lifted by exactly the same sheds so it is in the (hopefully short) list of any one of them
+	const uint64_t bit = uint64_t(1) << (k % 64);
+	for (uint_fast32_t const& s : lifted) signature(s)[k / 64] &= ~bit;
+	for (size_t idx = 0; idx < lifted.size(); idx++) {
+		const uint_fast32_t a = lifted[idx];
+		uint64_t const* sig = signature(a);
+		uint_fast32_t b = none;
+		size_t t = 0;
+		while (t < sigWords && 0 == sig[t]) ++t;
+		if (t < sigWords) {
+			for (uint_fast32_t const& c : shedShafts[t * 64 + bits::ctz(sig[t])]) {
+				if (c != a && bits::equal(sig, signature(c), sigWords)) {
+					b = c;
+					break;
+				}
+			}
+		} else { // a shaft that no shed lifts, there is at most 1 other
+			for (uint_fast32_t c = 0; c < members.size(); c++) {
+				if (c != a && bits::equal(sig, signature(c), sigWords)) {
+					b = c;
+					break;
+				}
+			}
+		}
+		if (none == b) continue;
+
+		// move the smaller shaft onto the larger one, the last shaft is renumbered to fill the gap
+		const bool keepA = members[a].size() >= members[b].size();
+		const uint_fast32_t drop = keepA ? b : a;
+		const uint_fast32_t last = mergeShafts(keepA ? a : b, drop);
+		for (uint_fast32_t& s : lifted) if (last == s) s = drop;
+	}
+}
+
+uint_fast32_t IncrementalLayout::mergeShafts(uint_fast32_t keep, uint_fast32_t drop) {
+	for (uint_fast32_t const& w : members[drop]) {
+		shaftOf[w] = keep;
+		warpPos[w] = static_cast<uint_fast32_t>(members[keep].size());
+		members[keep].push_back(w);
+	}
+	members[drop].clear();
+	bits::forEach(signature(drop), sigWords, [&](size_t t) {eraseSorted(shedShafts[t], drop);});
+
+	// keep the shaft numbers contiguous by moving the last shaft into the gap
+	const uint_fast32_t last = static_cast<uint_fast32_t>(members.size() - 1);
+	if (drop != last) {
+		members[drop].swap(members[last]);
+		for (uint_fast32_t const& w : members[drop]) shaftOf[w] = drop;
+		std::copy(signature(last), signature(last) + sigWords, signature(drop));
+		bits::forEach(signature(drop), sigWords, [&](size_t t) {
+			eraseSorted (shedShafts[t], last);
+			insertSorted(shedShafts[t], drop);
+		});
+	}
+	members.pop_back();
+	signatures.resize(signatures.size() - sigWords);
+	cutCount.pop_back();
+	splitTo .pop_back();
+	return last;
+}
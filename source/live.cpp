@@ -0,0 +1,188 @@
+#include "live.h"
+#include "wif.h"
+
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace corvus;
+
+LiveDraft::LiveDraft(uint_fast32_t warps, uint_fast32_t wefts, uint_fast32_t shafts, uint_fast32_t treadles, bool risingShed) :
+	numShafts(shafts), numTreadles(treadles), rising(risingShed),
+	liftWords(bits::words(shafts)), pressWords(bits::words(treadles)), weftWords(bits::words(wefts)),
+	shaftWarps(size_t(shafts) * bits::words(warps), 0),
+	warpShafts(size_t(warps) * liftWords, 0),
+	tieups(size_t(treadles) * liftWords, 0),
+	presses(size_t(wefts) * pressWords, 0),
+	lift(size_t(wefts) * liftWords, 0),
+	shaftWefts(size_t(shafts) * weftWords, 0),
+	treadWefts(size_t(treadles) * weftWords, 0),
+	cell(warps, wefts) {
+	rebuild();
+}
+
+// sanityCheck always fills liftMasks (from the treadling and tie up if there is no lift plan) and rejects lift plans that don't match the treadling
+// so any wif with treadles can be edited as a tie up and treadling, only wifs without treadles need a lift plan
+LiveDraft::LiveDraft(Wif const& wif) : LiveDraft(wif.warpThreads, wif.weftThreads, wif.shafts, wif.treadles, wif.risingShed) {
+	// fill in the draft directly from the dense thread arrays (shaft / treadle numbers are 1 based with 0 meaning none) then build the drawdown once
+	const size_t n = cell.rowWords();
+	Wif::Threads const& warp = wif.warp, & weft = wif.weft;
+	if (warp.shafts.size() > wif.warpThreads) throw std::invalid_argument("threading is longer than warp threads");
+	for (size_t i = 0; i < warp.shafts.size(); i++) {
+		for (Wif::Integer const* s = warp.shafts.begin(i); s != warp.shafts.end(i); ++s) {
+			if (*s > numShafts) throw std::invalid_argument("threading uses shaft number greater than shaft count");
+			if (0 == *s) continue;
+			bits::set(shaftWarps.data() + (*s - 1) * n, i, true);
+			bits::set(warpShafts.data() + i * liftWords, *s - 1, true);
+		}
+	}
+
+	// the tie up / lift plan are already packed, just copy them over (the wif always has at least 1 word per mask)
+	const size_t ww = wif.shaftWords();
+	if (0 == numTreadles) {
+		if (wif.liftMasks.size() != size_t(wif.weftThreads) * ww) throw std::invalid_argument("lift plan doesn't match weft thread count");
+		for (uint_fast32_t j = 0; j < cell.wefts; j++) std::copy_n(wif.liftMasks.data() + j * ww, liftWords, lift.data() + size_t(j) * liftWords);
+	} else {
+		if (wif.tieUpMasks.size() != size_t(numTreadles) * ww) throw std::invalid_argument("tie up doesn't match treadle count");
+		for (uint_fast32_t t = 0; t < numTreadles; t++) std::copy_n(wif.tieUpMasks.data() + t * ww, liftWords, tieups.data() + size_t(t) * liftWords);
+		if (weft.treadles.size() > wif.weftThreads) throw std::invalid_argument("treadling is longer than weft threads");
+		for (size_t j = 0; j < weft.treadles.size(); j++) {
+			for (Wif::Integer const* t = weft.treadles.begin(j); t != weft.treadles.end(j); ++t) {
+				if (*t > numTreadles) throw std::invalid_argument("treadling uses treadle number greater than treadle count");
+				if (0 == *t) continue;
+				bits::set(presses.data() + j * pressWords, *t - 1, true);
+				bits::set(treadWefts.data() + (*t - 1) * weftWords, j, true);
+			}
+		}
+		for (uint_fast32_t j = 0; j < cell.wefts; j++) {
+			uint64_t* l = lift.data() + size_t(j) * liftWords;
+			bits::forEach(presses.data() + size_t(j) * pressWords, pressWords, [&](size_t t) {bits::orRow(l, tieups.data() + t * liftWords, liftWords);});
+		}
+	}
+	rebuild();
+	dirty.clear();
+}
+
+void LiveDraft::setThreading(uint_fast32_t i, std::vector<uint_fast32_t> const& shafts) {
+	if (i >= cell.warps) throw std::invalid_argument("warp index outside of warp count");
+	std::vector<uint64_t> threaded(liftWords);
+	packList(shafts, numShafts, threaded.data(), "shaft");
+
+	// move the warp between shafts
+	const size_t n = cell.rowWords();
+	uint64_t* old = warpShafts.data() + size_t(i) * liftWords;
+	bits::forEach(old            , liftWords, [&](size_t s) {bits::set(shaftWarps.data() + s * n, i, false);});
+	bits::forEach(threaded.data(), liftWords, [&](size_t s) {bits::set(shaftWarps.data() + s * n, i, true );});
+	std::copy(threaded.cbegin(), threaded.cend(), old);
+
+	// the warp is lifted on every weft that lifts any of its shafts, build that as a packed column then write it into the rows
+	std::vector<uint64_t> column(weftWords, 0);
+	bits::forEach(threaded.data(), liftWords, [&](size_t s) {bits::orRow(column.data(), shaftWefts.data() + s * weftWords, weftWords);});
+	for (uint_fast32_t j = 0; j < cell.wefts; j++) cell.set(i, j, bits::test(column.data(), j) == rising);
+	if (0 != cell.wefts) dirty.push_back(Rect{i, 0, 1, cell.wefts});
+}
+
+void LiveDraft::setTieup(uint_fast32_t t, std::vector<uint_fast32_t> const& shafts) {
+	if (0 == numTreadles) throw std::invalid_argument("draft uses a lift plan");
+	if (t >= numTreadles) throw std::invalid_argument("treadle index outside of treadle count");
+	packList(shafts, numShafts, tieups.data() + size_t(t) * liftWords, "shaft");
+
+	// rebuild every weft that presses the treadle, consecutive wefts are reported as a single rectangle
+	Rect run{0, 0, cell.warps, 0};
+	bits::forEach(treadWefts.data() + size_t(t) * weftWords, weftWords, [&](size_t j) {
+		updateTreadled(static_cast<uint_fast32_t>(j));
+		if (0 != run.height && run.y + run.height == j) {
+			++run.height;
+		} else {
+			if (0 != run.height) dirty.push_back(run);
+			run.y = static_cast<uint_fast32_t>(j);
+			run.height = 1;
+		}
+	});
+	if (0 != run.height) dirty.push_back(run);
+}
+
+void LiveDraft::setTreadling(uint_fast32_t j, std::vector<uint_fast32_t> const& treadles) {
+	if (0 == numTreadles) throw std::invalid_argument("draft uses a lift plan");
+	if (j >= cell.wefts) throw std::invalid_argument("weft index outside of weft count");
+	std::vector<uint64_t> pressed(pressWords);
+	packList(treadles, numTreadles, pressed.data(), "treadle");
+
+	// keep the wefts pressing each treadle up to date for tie up edits
+	uint64_t* old = presses.data() + size_t(j) * pressWords;
+	for (size_t w = 0; w < pressWords; w++) {
+		const uint64_t changed = old[w] ^ pressed[w];
+		bits::forEach(&changed, 1, [&](size_t b) {
+			uint64_t* tw = treadWefts.data() + (w * 64 + b) * weftWords;
+			bits::set(tw, j, !bits::test(tw, j));
+		});
+	}
+	std::copy(pressed.cbegin(), pressed.cend(), old);
+	updateTreadled(j);
+	dirty.push_back(Rect{0, j, cell.warps, 1});
+}
+
+void LiveDraft::setLiftPlan(uint_fast32_t j, std::vector<uint_fast32_t> const& shafts) {
+	if (0 != numTreadles) throw std::invalid_argument("draft uses a tie up and treadling");
+	if (j >= cell.wefts) throw std::invalid_argument("weft index outside of weft count");
+	std::vector<uint64_t> lifted(liftWords);
+	packList(shafts, numShafts, lifted.data(), "shaft");
+	updateLift(j, lifted.data());
+	dirty.push_back(Rect{0, j, cell.warps, 1});
+}
+
+std::vector<Rect> LiveDraft::takeDirty() {
+	std::vector<Rect> d;
+	d.swap(dirty);
+	return d;
+}
+
+void LiveDraft::packList(std::vector<uint_fast32_t> const& list, size_t count, uint64_t* out, char const* name) {
+	std::fill(out, out + bits::words(count), uint64_t(0));
+	for (uint_fast32_t const& v : list) {
+		if (v >= count) throw std::invalid_argument(std::string(name) + " index outside of " + name + " count");
+		bits::set(out, v, true);
+	}
+}
+
+void LiveDraft::updateTreadled(uint_fast32_t j) {
+	std::vector<uint64_t> lifted(liftWords, 0);
+	bits::forEach(presses.data() + size_t(j) * pressWords, pressWords, [&](size_t t) {bits::orRow(lifted.data(), tieups.data() + t * liftWords, liftWords);});
+	updateLift(j, lifted.data());
+}
+
+void LiveDraft::updateLift(uint_fast32_t j, uint64_t const* lifted) {
+	// flip the weft in the columns of the shafts that changed
+	uint64_t* l = lift.data() + size_t(j) * liftWords;
+	for (size_t w = 0; w < liftWords; w++) {
+		const uint64_t changed = l[w] ^ lifted[w];
+		bits::forEach(&changed, 1, [&](size_t b) {
+			uint64_t* sw = shaftWefts.data() + (w * 64 + b) * weftWords;
+			bits::set(sw, j, !bits::test(sw, j));
+		});
+	}
+	std::copy(lifted, lifted + liftWords, l);
+
+	// the weft is the OR of the warps on each lifted shaft
+	const size_t n = cell.rowWords();
+	uint64_t* r = cell.row(j);
+	std::fill(r, r + n, uint64_t(0));
+	bits::forEach(l, liftWords, [&](size_t s) {bits::orRow(r, shaftWarps.data() + s * n, n);});
+	if (!rising) bits::invert(r, cell.warps);
+}
+
+void LiveDraft::rebuild() {
+	std::fill(shaftWefts.begin(), shaftWefts.end(), uint64_t(0));
+	const size_t n = cell.rowWords();
+	for (uint_fast32_t j = 0; j < cell.wefts; j++) {
+		uint64_t const* l = lift.data() + size_t(j) * liftWords;
+		uint64_t* r = cell.row(j);
+		std::fill(r, r + n, uint64_t(0));
+		bits::forEach(l, liftWords, [&](size_t s) {
+			bits::set(shaftWefts.data() + s * weftWords, j, true);
+			bits::orRow(r, shaftWarps.data() + s * n, n);
+		});
+		if (!rising) bits::invert(r, cell.warps);
+	}
+	if (0 != cell.warps && 0 != cell.wefts) dirty.push_back(Rect{0, 0, cell.warps, cell.wefts});
+}
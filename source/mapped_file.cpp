@@ -0,0 +1,83 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace corvus;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string const& path) {
+	hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (INVALID_HANDLE_VALUE == hFile) {
+		hFile = nullptr;
+		throw std::invalid_argument("couldn't open " + path);
+	}
+
+	LARGE_INTEGER sz;
+	if (!GetFileSizeEx(hFile, &sz)) {
+		CloseHandle(hFile);
+		throw std::invalid_argument("couldn't get size of " + path);
+	}
+	len = static_cast<size_t>(sz.QuadPart);
+	if (0 == len) return; // can't map an empty file but there is nothing to read anyway
+
+	hMap = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (NULL == hMap) {
+		CloseHandle(hFile);
+		throw std::invalid_argument("couldn't map " + path);
+	}
+	ptr = static_cast<char const*>(MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0));
+	if (nullptr == ptr) {
+		CloseHandle(hMap);
+		CloseHandle(hFile);
+		throw std::invalid_argument("couldn't map " + path);
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (nullptr != ptr  ) UnmapViewOfFile(ptr);
+	if (nullptr != hMap ) CloseHandle(hMap );
+	if (nullptr != hFile) CloseHandle(hFile);
+}
+
+#else
+
+MappedFile::MappedFile(std::string const& path) {
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (-1 == fd) throw std::invalid_argument("couldn't open " + path);
+
+	struct stat st;
+	if (-1 == ::fstat(fd, &st)) {
+		::close(fd);
+		throw std::invalid_argument("couldn't get size of " + path);
+	}
+	len = static_cast<size_t>(st.st_size);
+	if (0 == len) { // can't map an empty file but there is nothing to read anyway
+		::close(fd);
+		return;
+	}
+
+	void* p = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping keeps its own reference to the file
+	if (MAP_FAILED == p) throw std::invalid_argument("couldn't map " + path);
+	::madvise(p, len, MADV_SEQUENTIAL); // we only ever make a single forward pass
+	ptr = static_cast<char const*>(p);
+}
+
+MappedFile::~MappedFile() {
+	if (nullptr != ptr) ::munmap(const_cast<char*>(ptr), len);
+}
+
+#endif
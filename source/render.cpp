@@ -0,0 +1,157 @@
+#include "render.h"
+#include "repeat.h"
+#include "wif.h"
+#include "parallel.h"
+
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace corvus;
+
+namespace {
+	// tiles are sized so a tile's output (and the packed rows it reads) stay in cache while it is written
+	// the width is a multiple of 64 so every tile starts on a word boundary of the packed rows
+	constexpr uint_fast32_t tileWidth  = 512;
+	constexpr uint_fast32_t tileHeight =  64; // 512 * 64 * 3 bytes = 96 kB per tile
+
+	//! scale a wif color to 8 bits
+	//! \param c color to scale
+	//! \param r range of color values (assumed to be [0, 255] if empty)
+	//! \return scaled color
+	Palette::Rgb scale(Wif::Color const& c, Wif::Range const& r) {
+		const bool valid = r.second > r.first;
+		const double lo = valid ? r.first : 0.0;
+		const double span = valid ? r.second - r.first : 255.0;
+		Palette::Rgb rgb;
+		for (size_t i = 0; i < 3; i++) {
+			const double v = (double(c[i]) - lo) * 255.0 / span + 0.5;
+			rgb[i] = static_cast<uint8_t>(std::min(255.0, std::max(0.0, v)));
+		}
+		return rgb;
+	}
+
+	//! build the color of every thread in one direction
+	//! \param count number of threads
+	//! \param indices color table index of each thread (0 for the default color)
+	//! \param table scaled color table (indexed by color number)
+	//! \param found does the color table have an entry for each color number
+	//! \param def color for threads without a color index
+	//! \param name warp or weft (for error messages)
+	//! \return color of each thread
+	std::vector<Palette::Rgb> threadColors(Wif::Integer count, std::vector<Wif::Integer> const& indices, std::vector<Palette::Rgb> const& table, std::vector<bool> const& found, Palette::Rgb def, std::string const& name) {
+		if (indices.size() > count) throw std::invalid_argument(name + " colors is longer than " + name + " threads");
+		std::vector<Palette::Rgb> colors(count, def);
+		for (size_t i = 0; i < indices.size(); i++) {
+			if (0 == indices[i]) continue;
+			if (indices[i] >= found.size() || !found[indices[i]]) throw std::invalid_argument(name + " colors has index not in color table");
+			colors[i] = table[indices[i]];
+		}
+		return colors;
+	}
+}
+
+void Image::writePpm(std::ostream& os) const {
+	os << "P6\n" << width << ' ' << height << "\n255\n";
+	os.write(reinterpret_cast<char const*>(rgb.data()), rgb.size());
+}
+
+void Image::writePpm(std::string const& path) const {
+	std::ofstream os(path, std::ios::out | std::ios::binary);
+	if (!os) throw std::invalid_argument("couldn't open " + path + " for writing");
+	writePpm(os);
+}
+
+Palette corvus::palette(Wif const& wif) {
+	// scale the color table once, color numbers are small so a dense lookup is fine
+	Wif::Integer maxIndex = 0;
+	for (std::pair<Wif::Integer, Wif::Color> const& p : wif.colorTable) maxIndex = std::max(maxIndex, p.first);
+	std::vector<Palette::Rgb> table(size_t(maxIndex) + 1, Palette::Rgb{0, 0, 0});
+	std::vector<bool> found(table.size(), false);
+	for (std::pair<Wif::Integer, Wif::Color> const& p : wif.colorTable) {
+		table[p.first] = scale(p.second, wif.range);
+		found[p.first] = true;
+	}
+
+	// the default color is either given explicitly or as an index into the color table
+	auto defColor = [&](Wif::Integer index, Wif::Color const& value, Palette::Rgb fallback, std::string const& name) {
+		if (Wif::Color{0, 0, 0} != value) return scale(value, wif.range);
+		if (0 == index) return fallback;
+		if (index >= found.size() || !found[index]) throw std::invalid_argument(name + " color index not in " + name + " colors");
+		return table[index];
+	};
+
+	Palette pal;
+	pal.warp = threadColors(wif.warpThreads, wif.warp.colors, table, found, defColor(wif.warpColorIndex, wif.warpColorValue, Palette::Rgb{  0,   0,   0}, "warp"), "warp");
+	pal.weft = threadColors(wif.weftThreads, wif.weft.colors, table, found, defColor(wif.weftColorIndex, wif.weftColorValue, Palette::Rgb{255, 255, 255}, "weft"), "weft");
+	return pal;
+}
+
+namespace {
+	//! render part of a drawdown in color from a source of rows
+	//! \param warps number of warps
+	//! \param wefts number of wefts
+	//! \param fetch function to get words [wBeg, wEnd) of a weft as fetch(j, wBeg, wEnd, scratch)
+	//! \param pal color of each thread
+	//! \param region warps / wefts to render
+	//! \param img image with a pixel for each warp/weft crossing to render into
+	template <typename Fetch>
+	void renderRows(uint_fast32_t warps, uint_fast32_t wefts, Fetch fetch, Palette const& pal, Rect const& region, Image& img) {
+		if (pal.warp.size() < warps || pal.weft.size() < wefts) throw std::invalid_argument("palette doesn't have a color for every thread");
+
+		// render tiles in parallel, every tile writes a disjoint rectangle of the image
+		const size_t tilesX = (size_t(region.width ) + tileWidth  - 1) / tileWidth ;
+		const size_t tilesY = (size_t(region.height) + tileHeight - 1) / tileHeight;
+		parallelFor(tilesX * tilesY, 1, [&](size_t tBeg, size_t tEnd) {
+			std::vector<uint64_t> scratch(tileWidth / 64 + 1); // a tile that doesn't start on a word boundary spans an extra word
+			for (size_t t = tBeg; t < tEnd; t++) {
+				const uint_fast32_t x0 = region.x + static_cast<uint_fast32_t>(t % tilesX) * tileWidth ;
+				const uint_fast32_t j0 = region.y + static_cast<uint_fast32_t>(t / tilesX) * tileHeight;
+				const uint_fast32_t x1 = std::min<uint_fast32_t>(x0 + tileWidth , region.x + region.width );
+				const uint_fast32_t j1 = std::min<uint_fast32_t>(j0 + tileHeight, region.y + region.height);
+				const size_t w0 = x0 / 64;
+				for (uint_fast32_t j = j0; j < j1; j++) {
+					// the first weft is woven first so it goes at the bottom of the image
+					uint64_t const* r = fetch(j, w0, bits::words(x1), scratch.data());
+					uint8_t* out = img.pixel(x0, wefts - 1 - j);
+					Palette::Rgb const& weft = pal.weft[j];
+					for (uint_fast32_t x = x0; x < x1; x++, out += 3) {
+						// select between the warp and weft color with a mask instead of a branch
+						const uint8_t m = static_cast<uint8_t>(0 - ((r[x / 64 - w0] >> (x % 64)) & 1));
+						Palette::Rgb const& warp = pal.warp[x];
+						out[0] = static_cast<uint8_t>((warp[0] & m) | (weft[0] & ~m));
+						out[1] = static_cast<uint8_t>((warp[1] & m) | (weft[1] & ~m));
+						out[2] = static_cast<uint8_t>((warp[2] & m) | (weft[2] & ~m));
+					}
+				}
+			}
+		});
+	}
+}
+
+Image corvus::render(Cell const& cell, Palette const& pal) {
+	Image img(cell.warps, cell.wefts);
+	render(cell, pal, Rect{0, 0, cell.warps, cell.wefts}, img);
+	return img;
+}
+
+void corvus::render(Cell const& cell, Palette const& pal, Rect const& region, Image& img) {
+	if (img.width != cell.warps || img.height != cell.wefts) throw std::invalid_argument("image size doesn't match drawdown");
+	if (uint64_t(region.x) + region.width > cell.warps || uint64_t(region.y) + region.height > cell.wefts) throw std::invalid_argument("region extends past edge of drawdown");
+	auto fetch = [&cell](uint_fast32_t j, size_t wBeg, size_t, uint64_t*) {return static_cast<uint64_t const*>(cell.row(j) + wBeg);};
+	renderRows(cell.warps, cell.wefts, fetch, pal, region, img);
+}
+
+Image corvus::render(RepeatView const& view, Palette const& pal) {
+	auto fetch = [&view](uint_fast32_t j, size_t wBeg, size_t wEnd, uint64_t* scratch) {
+		view.rowRange(j, wBeg, wEnd, scratch);
+		return static_cast<uint64_t const*>(scratch);
+	};
+	Image img(view.warps(), view.wefts());
+	renderRows(view.warps(), view.wefts(), fetch, pal, Rect{0, 0, view.warps(), view.wefts()}, img);
+	return img;
+}
+
+Image corvus::render(Wif const& wif) {
+	return render(fromWif(wif), palette(wif));
+}
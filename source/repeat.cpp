@@ -0,0 +1,88 @@
+#include "repeat.h"
+
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace corvus;
+
+namespace {
+	//! multiply 2 sizes making sure the result fits in 32 bits
+	//! \param a first size
+	//! \param b second size
+	//! \param what description of the size for error messages
+	//! \return a * b
+	uint_fast32_t checkedProduct(uint_fast32_t a, uint_fast32_t b, char const* what) {
+		const uint64_t p = uint64_t(a) * uint64_t(b);
+		if (p > std::numeric_limits<uint32_t>::max()) throw std::invalid_argument(std::string(what) + " is too large to represent");
+		return static_cast<uint_fast32_t>(p);
+	}
+}
+
+RepeatView::RepeatView(Cell const& cell, uint_fast32_t across, uint_fast32_t down) :
+	RepeatView(std::vector<Cell>(1, cell), std::vector<Band>(1, Band()), checkedProduct(cell.warps, across, "repeated width"), down) {}
+
+RepeatView::RepeatView(std::vector<Cell> c, std::vector<Band> const& bands, uint_fast32_t warps, uint_fast32_t repeats) : cells(std::move(c)), numWarps(warps), numWefts(0) {
+	// repeat each row of each cell out past its width so that rows can be built a word at a time
+	// a 64 bit window starting anywhere in the first cell width never runs off the end
+	for (Cell const& cell : cells) {
+		const size_t len = size_t(cell.warps) + 64;
+		const size_t ew = bits::words(len);
+		expWords.push_back(ew);
+		expanded.emplace_back(ew * cell.wefts, 0);
+		if (0 == cell.warps) continue; // can't be used by a band (checked below)
+		for (uint_fast32_t r = 0; r < cell.wefts; r++) {
+			uint64_t* dst = expanded.back().data() + r * ew;
+			for (size_t k = 0; k < len; k++) if (cell.get(static_cast<uint_fast32_t>(k % cell.warps), r)) bits::set(dst, k, true);
+		}
+	}
+
+	// now work out where each weft in one period of the bands comes from
+	for (Band const& b : bands) {
+		if (b.cell >= cells.size()) throw std::invalid_argument("band uses cell index outside of cell count");
+		Cell const& cell = cells[b.cell];
+		if (0 == cell.warps || 0 == cell.wefts) throw std::invalid_argument("cannot repeat an empty cell");
+		const uint_fast32_t h = 0 == b.wefts ? cell.wefts : b.wefts;
+		for (uint_fast32_t k = 0; k < h; k++) lines.push_back(Line{b.cell, static_cast<uint_fast32_t>((uint64_t(b.start) + k) % cell.wefts), b.shift % cell.warps});
+	}
+	numWefts = checkedProduct(static_cast<uint_fast32_t>(lines.size()), repeats, "repeated length");
+}
+
+void RepeatView::rowRange(uint_fast32_t j, size_t wBeg, size_t wEnd, uint64_t* out) const {
+	if (wEnd <= wBeg) return;
+	Line const& l = lines[j % lines.size()];
+	const size_t cw = cells[l.cell].warps;
+	uint64_t const* exp = expanded[l.cell].data() + l.row * expWords[l.cell];
+
+	// each output word is a 64 bit window of the expanded row, the window start just advances by 64 (mod the cell width)
+	size_t off = (wBeg * 64 + l.shift) % cw;
+	const size_t step = 64 % cw;
+	for (size_t w = wBeg; w < wEnd; w++) {
+		const size_t k = off / 64, b = off % 64;
+		out[w - wBeg] = 0 == b ? exp[k] : (exp[k] >> b) | (exp[k+1] << (64 - b));
+		off += step;
+		if (off >= cw) off -= cw;
+	}
+
+	// keep the padding bits past the last warp 0
+	if (rowWords() == wEnd) out[wEnd - 1 - wBeg] &= bits::tailMask(numWarps);
+}
+
+void RepeatView::column(uint_fast32_t i, uint64_t* out) const {
+	std::fill(out, out + bits::words(numWefts), uint64_t(0));
+	for (uint_fast32_t j = 0; j < numWefts; j++) if (get(i, j)) out[j / 64] |= uint64_t(1) << (j % 64);
+}
+
+Cell RepeatView::materialize() const {
+	Cell c(numWarps, numWefts);
+	for (uint_fast32_t j = 0; j < numWefts; j++) row(j, c.row(j));
+	return c;
+}
+
+void RepeatView::write(std::ostream& os, char warpSymb, char weftSymb) const {
+	forEachRow(0, numWefts, [&](uint_fast32_t, uint64_t const* r) {
+		for (uint_fast32_t i = 0; i < numWarps; i++) os << ' ' << (bits::test(r, i) ? warpSymb : weftSymb);
+		os << '\n';
+	});
+}
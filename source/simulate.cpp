@@ -0,0 +1,191 @@
+#include "simulate.h"
+#include "repeat.h"
+#include "wif.h"
+#include "parallel.h"
+
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace corvus;
+
+namespace {
+	//! get the number of inches in a wif unit
+	//! \param u unit to convert from
+	//! \return inches per unit
+	double inches(Wif::Unit u) {
+		switch (u) {
+			case Wif::Unit::Decipoints : return 1.0 / 720.0; // a tenth of a point
+			case Wif::Unit::Centimeters: return 1.0 / 2.54 ;
+			default                    : return 1.0        ; // inches (or unspecified)
+		}
+	}
+
+	//! build the layout of the threads in one direction from the wif fields
+	//! \param count number of threads
+	//! \param unit unit of spacing / thickness values
+	//! \param spacing base spacing (NAN if not given)
+	//! \param thickness base thickness (NAN if not given)
+	//! \param threads dense per thread spacing / thickness / zooms (filled in by sanityCheck)
+	//! \param pitch fallback spacing / thickness in inches
+	//! \param dir warp or weft (for error messages)
+	//! \return thread layout
+	ThreadLayout layoutThreads(Wif::Integer count, Wif::Unit unit, Wif::Real spacing, Wif::Real thickness, Wif::Threads const& threads, double pitch, std::string const& dir) {
+		if (threads.spacing.size() != count || threads.spacingZoom.size() != count || threads.thickness.size() != count || threads.thicknessZoom.size() != count) {
+			throw std::invalid_argument(dir + " spacing / thickness lists don't match " + dir + " thread count");
+		}
+
+		// a missing base value is filled in from the other one (i.e. threads that just touch)
+		const double scale = inches(unit);
+		double baseSpacing   = spacing   * scale;
+		double baseThickness = thickness * scale;
+		if (std::isnan(baseSpacing  )) baseSpacing   = std::isnan(baseThickness) ? pitch : baseThickness;
+		if (std::isnan(baseThickness)) baseThickness = baseSpacing;
+
+		// positions are a prefix sum of the spacing, threads without a value (NAN) get the base value
+		ThreadLayout l;
+		l.start.resize(size_t(count) + 1, 0.0);
+		l.thickness.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			const double sp = std::isnan(threads.spacing  [i]) ? baseSpacing   : threads.spacing  [i] * scale;
+			const double th = std::isnan(threads.thickness[i]) ? baseThickness : threads.thickness[i] * scale;
+			l.start[i+1] = l.start[i] + sp * threads.spacingZoom[i];
+			l.thickness[i] = th * threads.thicknessZoom[i];
+		}
+		return l;
+	}
+
+	//! the thread that covers most of a pixel and how much it covers
+	struct Coverage {
+		uint_fast32_t thread; //!< index of thread
+		uint_fast32_t alpha ; //!< fraction of the pixel covered in [0, 256]
+	};
+
+	//! find the thread covering each pixel in a line of pixels
+	//! \param l thread layout
+	//! \param dpi pixels per inch
+	//! \param first index of first pixel
+	//! \param count number of pixels
+	//! \return coverage of each pixel
+	std::vector<Coverage> coverage(ThreadLayout const& l, double dpi, size_t first, size_t count) {
+		std::vector<Coverage> cov(count, Coverage{0, 0});
+		if (0 == l.size()) return cov;
+
+		// find the thread whose space holds the first pixel center then walk forward
+		const double px = 1.0 / dpi;
+		size_t i = std::upper_bound(l.start.cbegin(), l.start.cend(), (first + 0.5) * px) - l.start.cbegin();
+		i = std::min(i > 0 ? i - 1 : 0, l.size() - 1);
+		for (size_t k = 0; k < count; k++) {
+			const double lo = (first + k) * px, hi = lo + px;
+			while (i + 1 < l.size() && l.start[i+1] <= lo + px / 2) ++i;
+
+			// the thread with the pixel center in its space or a thick neighbor spilling over can cover the most
+			double best = 0;
+			for (size_t t = i > 0 ? i - 1 : 0; t <= i + 1 && t < l.size(); t++) {
+				const double c = l.center(t), h = l.thickness[t] / 2;
+				const double overlap = std::min(hi, c + h) - std::max(lo, c - h);
+				if (overlap > best) {
+					best = overlap;
+					cov[k].thread = static_cast<uint_fast32_t>(t);
+				}
+			}
+			if (best > 0) cov[k].alpha = static_cast<uint_fast32_t>(std::min(1.0, best / px) * 256 + 0.5);
+			else cov[k].thread = static_cast<uint_fast32_t>(i); // nothing here, just keep a valid index
+		}
+		return cov;
+	}
+}
+
+ThreadLayout corvus::warpLayout(Wif const& wif, double pitch) {
+	return layoutThreads(wif.warpThreads, wif.warpUnit, wif.warpSpacing, wif.warpThickness, wif.warp, pitch, "warp");
+}
+
+ThreadLayout corvus::weftLayout(Wif const& wif, double pitch) {
+	return layoutThreads(wif.weftThreads, wif.weftUnit, wif.weftSpacing, wif.weftThickness, wif.weft, pitch, "weft");
+}
+
+std::pair<uint_fast32_t, uint_fast32_t> corvus::simulatedSize(ThreadLayout const& warps, ThreadLayout const& wefts, double dpi) {
+	if (!(dpi > 0)) throw std::invalid_argument("dpi must be positive");
+	return std::pair<uint_fast32_t, uint_fast32_t>(static_cast<uint_fast32_t>(std::ceil(warps.extent() * dpi - 1e-6)), static_cast<uint_fast32_t>(std::ceil(wefts.extent() * dpi - 1e-6)));
+}
+
+namespace {
+	//! simulate the appearance of woven fabric from a source of rows
+	//! \param warpCount number of warps
+	//! \param weftCount number of wefts
+	//! \param fetch function to get words [wBeg, wEnd) of a weft as fetch(j, wBeg, wEnd, scratch)
+	//! \param pal color of each thread
+	//! \param warps physical layout of the warps
+	//! \param wefts physical layout of the wefts
+	//! \param opts resolution, background, and region to render
+	//! \return image of the requested region
+	template <typename Fetch>
+	Image simulateRows(uint_fast32_t warpCount, uint_fast32_t weftCount, Fetch fetch, Palette const& pal, ThreadLayout const& warps, ThreadLayout const& wefts, SimulateOptions const& opts) {
+		if (warps.size() != warpCount || wefts.size() != weftCount) throw std::invalid_argument("thread layout doesn't match cell size");
+		if (pal.warp.size() < warpCount || pal.weft.size() < weftCount) throw std::invalid_argument("palette doesn't have a color for every thread");
+
+		// clip the requested region to the full image
+		const std::pair<uint_fast32_t, uint_fast32_t> full = simulatedSize(warps, wefts, opts.dpi);
+		const uint_fast32_t x0 = std::min(opts.x, full.first ), w = 0 == opts.width  ? full.first  - x0 : std::min(opts.width , full.first  - x0);
+		const uint_fast32_t y0 = std::min(opts.y, full.second), h = 0 == opts.height ? full.second - y0 : std::min(opts.height, full.second - y0);
+
+		// the thread geometry only depends on the column / row so it is computed once up front
+		// the first weft is at the bottom so rows are computed from the bottom of the region up
+		const std::vector<Coverage> cols = coverage(warps, opts.dpi, x0, w);
+		const std::vector<Coverage> rows = coverage(wefts, opts.dpi, full.second - y0 - h, h);
+
+		// only the words holding warps that show up in the region are needed from each row
+		Image img(w, h);
+		if (0 == w || 0 == h) return img;
+		const size_t wBeg = cols.front().thread / 64, wEnd = cols.back().thread / 64 + 1;
+		Palette::Rgb const& bg = opts.background;
+		parallelFor(h, 16, [&](size_t yBeg, size_t yEnd) {
+			std::vector<uint64_t> scratch(wEnd - wBeg);
+			uint64_t const* r = nullptr;
+			uint_fast32_t current = 0; // weft in r
+			for (size_t y = yBeg; y < yEnd; y++) {
+				Coverage const& rc = rows[h - 1 - y];
+				if (nullptr == r || current != rc.thread) { // neighboring pixel rows usually show the same weft
+					r = fetch(rc.thread, wBeg, wEnd, scratch.data());
+					current = rc.thread;
+				}
+				Palette::Rgb const& weft = pal.weft[rc.thread];
+				uint8_t* out = img.pixel(0, static_cast<uint_fast32_t>(y));
+				for (uint_fast32_t x = 0; x < w; x++, out += 3) {
+					// whichever thread is on top at this crossing is drawn over the other, which is drawn over the background
+					// the top / bottom thread is selected with masks instead of branching
+					Coverage const& cc = cols[x];
+					Palette::Rgb const& warp = pal.warp[cc.thread];
+					const uint_fast32_t m = 0 - static_cast<uint_fast32_t>((r[cc.thread / 64 - wBeg] >> (cc.thread % 64)) & 1); // all 1s if the warp is on top
+					const uint_fast32_t aTop = (cc.alpha & m) | (rc.alpha & ~m);
+					const uint_fast32_t aBot = (rc.alpha & m) | (cc.alpha & ~m);
+					for (size_t c = 0; c < 3; c++) {
+						const uint_fast32_t top = (warp[c] & m) | (weft[c] & ~m);
+						const uint_fast32_t bot = (weft[c] & m) | (warp[c] & ~m);
+						const uint_fast32_t under = (bot * aBot + bg[c] * (256 - aBot)) >> 8;
+						out[c] = static_cast<uint8_t>((top * aTop + under * (256 - aTop)) >> 8);
+					}
+				}
+			}
+		});
+		return img;
+	}
+}
+
+Image corvus::simulate(Cell const& cell, Palette const& pal, ThreadLayout const& warps, ThreadLayout const& wefts, SimulateOptions const& opts) {
+	auto fetch = [&cell](uint_fast32_t j, size_t wBeg, size_t, uint64_t*) {return static_cast<uint64_t const*>(cell.row(j) + wBeg);};
+	return simulateRows(cell.warps, cell.wefts, fetch, pal, warps, wefts, opts);
+}
+
+Image corvus::simulate(RepeatView const& view, Palette const& pal, ThreadLayout const& warps, ThreadLayout const& wefts, SimulateOptions const& opts) {
+	auto fetch = [&view](uint_fast32_t j, size_t wBeg, size_t wEnd, uint64_t* scratch) {
+		view.rowRange(j, wBeg, wEnd, scratch);
+		return static_cast<uint64_t const*>(scratch);
+	};
+	return simulateRows(view.warps(), view.wefts(), fetch, pal, warps, wefts, opts);
+}
+
+Image corvus::simulate(Wif const& wif, SimulateOptions const& opts) {
+	return simulate(fromWif(wif), palette(wif), warpLayout(wif, opts.pitch), weftLayout(wif, opts.pitch), opts);
+}
@@ -0,0 +1,61 @@
+#include "stats.h"
+
+#include <sstream>
+
+using namespace corvus;
+
+char const* Stats::name(Phase p) {
+	switch (p) {
+		case Tokenize       : return "tokenize"          ;
+		case DecodeSections : return "decode_sections"   ;
+		case SortAndDupCheck: return "sort_and_dup_check";
+		case RangeChecks    : return "range_checks"      ;
+		case Densify        : return "densify"           ;
+		case LiftPlan       : return "lift_plan"         ;
+		case DenseValues    : return "dense_values"      ;
+		case ShedDedup      : return "shed_dedup"        ;
+		case Partition      : return "partition"         ;
+		case TieUp          : return "tie_up"            ;
+		default             : return "unknown"           ;
+	}
+}
+
+char const* Stats::name(Counter c) {
+	switch (c) {
+		case Lines             : return "lines"              ;
+		case Sections          : return "sections"           ;
+		case Keys              : return "keys"               ;
+		case ScratchAllocations: return "scratch_allocations";
+		case UniqueSheds       : return "unique_sheds"       ;
+		case PartitionGroups   : return "partition_groups"   ;
+		default                : return "unknown"            ;
+	}
+}
+
+Stats& Stats::operator+=(Stats const& other) {
+	for (size_t i = 0; i < PhaseCount; i++) {
+		nanoseconds[i] += other.nanoseconds[i];
+		calls      [i] += other.calls      [i];
+	}
+	for (size_t i = 0; i < CounterCount; i++) counters[i] += other.counters[i];
+	return *this;
+}
+
+void Stats::writeJson(std::ostream& os) const {
+	// every name is a plain identifier so nothing needs to be escaped
+	os << "{\"enabled\": " << (enabled ? "true" : "false") << ", \"phases\": {";
+	for (size_t i = 0; i < PhaseCount; i++) {
+		os << (0 == i ? "" : ", ") << '"' << name(Phase(i)) << "\": {\"ns\": " << nanoseconds[i] << ", \"calls\": " << calls[i] << '}';
+	}
+	os << "}, \"counters\": {";
+	for (size_t i = 0; i < CounterCount; i++) {
+		os << (0 == i ? "" : ", ") << '"' << name(Counter(i)) << "\": " << counters[i];
+	}
+	os << "}}";
+}
+
+std::string Stats::json() const {
+	std::ostringstream ss;
+	writeJson(ss);
+	return ss.str();
+}
@@ -0,0 +1,332 @@
+#include "tieup.h"
+#include "bits.h"
+#include "parallel.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+namespace corvus {
+	namespace {
+		typedef std::chrono::steady_clock Clock;
+		constexpr size_t none = std::numeric_limits<size_t>::max();
+		constexpr size_t branching = 8; // most candidate treadles tried for a shed at each step of the search
+
+		//! check if a set of shafts can be lifted by pressing at most n treadles
+		//! \param remaining shafts that still need to be lifted
+		//! \param avail treadles that can be pressed (each a subset of the shed)
+		//! \param count number of treadles in avail
+		//! \param n maximum number of presses
+		//! \param pick location to write the indices (into avail) of the pressed treadles, or nullptr
+		//! \return true if remaining can be lifted
+		bool coverable(uint64_t remaining, uint64_t const* avail, size_t count, size_t n, size_t* pick) {
+			if (0 == remaining) return true;
+			if (0 == n) return false;
+			const uint64_t low = remaining & (~remaining + 1); // some treadle has to lift the lowest remaining shaft
+			for (size_t i = 0; i < count; i++) {
+				if (0 == (avail[i] & low)) continue;
+				if (nullptr != pick) *pick = i;
+				if (coverable(remaining & ~avail[i], avail, count, n - 1, nullptr == pick ? nullptr : pick + 1)) return true;
+			}
+			return false;
+		}
+
+		//! compare 2 masks as if they were sorted lists of shafts
+		bool listLess(uint64_t a, uint64_t b) {
+			for (; 0 != a && 0 != b; a &= a - 1, b &= b - 1) {
+				const size_t ia = bits::ctz(a), ib = bits::ctz(b);
+				if (ia != ib) return ia < ib;
+			}
+			return 0 == a && 0 != b;
+		}
+
+		//! everything shared between the threads searching for a tie up with a given number of presses
+		struct Problem {
+			std::vector<uint64_t>                sheds   ; //!< non empty sheds in the order they are built
+			std::vector< std::vector<uint64_t> > subsets ; //!< candidate treadles for each shed (each a subset of it)
+			size_t                               treadles; //!< treadle budget
+			size_t                               maxPress; //!< most treadles that may be pressed at once
+			Clock::time_point                    deadline; //!< when to give up
+			std::atomic<bool>                    timeout ; //!< set once the deadline has passed
+			std::atomic<size_t>                  found   ; //!< earliest task with a solution (none if no solution yet)
+		};
+
+		//! depth first branch and bound search for a tie up
+		//! sheds are visited in order, whenever one can't be built (within maxPress presses) we branch on a treadle to add for it
+		//! adding treadles never makes an earlier shed unbuildable so sheds that are already built never need to be revisited
+		class Search {
+			Problem&              prob ;
+			size_t                task ; // task being searched, once an earlier task succeeds there is no point continuing
+			size_t                nodes; // nodes visited (to avoid checking the clock too often)
+			std::vector<uint64_t> avail; // scratch space for pressable treadles
+
+			//! collect the treadles that can be pressed for a shed
+			//! \param shed shed to build
+			//! \param tread current treadles
+			//! \return union of the pressable treadles
+			uint64_t usable(uint64_t shed, std::vector<uint64_t> const& tread) {
+				avail.clear();
+				uint64_t u = 0;
+				for (uint64_t const& t : tread) {
+					if (0 != (t & ~shed)) continue; // pressing this treadle would lift a shaft that shouldn't be
+					avail.push_back(t);
+					u |= t;
+				}
+				return u;
+			}
+
+			//! check if it is time to give up on the search
+			bool stop() {
+				if (prob.found.load(std::memory_order_relaxed) < task) return true;
+				if (0 == (++nodes & 0xFF) && Clock::now() > prob.deadline) prob.timeout = true;
+				return prob.timeout.load(std::memory_order_relaxed);
+			}
+
+			//! compute a lower bound on the number of treadles that still need to be added
+			//! \param s first shed that can't be built
+			//! \param tread current treadles
+			//! \return lower bound
+			size_t bound(size_t s, std::vector<uint64_t> const& tread) {
+				// every shed that has a shaft no current treadle can lift needs a new treadle
+				// 2 such sheds a and b can only share a new treadle if it fits in both, i.e. if a's missing shafts overlap b and vice versa
+				// so a greedy set of sheds that pairwise can't share gives a bound
+				std::vector< std::pair<uint64_t, uint64_t> > chosen; // shed, missing shafts
+				for (size_t r = s; r < prob.sheds.size(); r++) {
+					const uint64_t shed = prob.sheds[r];
+					uint64_t u = 0;
+					for (uint64_t const& t : tread) if (0 == (t & ~shed)) u |= t;
+					const uint64_t missing = shed & ~u;
+					if (0 == missing) continue;
+					bool independent = true;
+					for (std::pair<uint64_t, uint64_t> const& c : chosen) {
+						if (0 != (missing & c.first) && 0 != (c.second & shed)) {
+							independent = false;
+							break;
+						}
+					}
+					if (independent) chosen.emplace_back(shed, missing);
+				}
+				return chosen.size();
+			}
+
+		public:
+			Search(Problem& p, size_t t) : prob(p), task(t), nodes(0) {}
+
+			//! find the first shed that can't be built with the current treadles
+			//! \param s shed to start from
+			//! \param tread current treadles
+			//! \return index of first unbuildable shed (or sheds.size() if they can all be built)
+			size_t next(size_t s, std::vector<uint64_t> const& tread) {
+				for (; s < prob.sheds.size(); s++) {
+					const uint64_t shed = prob.sheds[s];
+					if (usable(shed, tread) != shed) break;
+					if (!coverable(shed, avail.data(), avail.size(), prob.maxPress, nullptr)) break;
+				}
+				return s;
+			}
+
+			//! get the treadles worth adding to build a shed (best first)
+			//! \param s shed to build
+			//! \param tread current treadles
+			//! \param kids location to write candidate treadles
+			void children(size_t s, std::vector<uint64_t> const& tread, std::vector<uint64_t>& kids) {
+				// if the shed has shafts that nothing lifts yet the new treadle needs to lift some of them
+				// otherwise the shed just takes too many presses and any new treadle that fits may help
+				const uint64_t shed = prob.sheds[s];
+				const uint64_t missing = shed & ~usable(shed, tread);
+
+				// prefer treadles that are big and can be reused by many of the remaining sheds
+				std::vector< std::pair<size_t, uint64_t> > scored;
+				for (uint64_t const& c : prob.subsets[s]) {
+					if (0 != missing && 0 == (c & missing)) continue;
+					if (tread.cend() != std::find(tread.cbegin(), tread.cend(), c)) continue;
+					size_t score = 0;
+					for (size_t r = s; r < prob.sheds.size(); r++) if (0 == (c & ~prob.sheds[r])) score += bits::popcount(c);
+					scored.emplace_back(score, c);
+				}
+				const size_t n = std::min(branching, scored.size());
+				std::partial_sort(scored.begin(), scored.begin() + n, scored.end(), [](std::pair<size_t, uint64_t> const& lhs, std::pair<size_t, uint64_t> const& rhs) {
+					return lhs.first == rhs.first ? lhs.second < rhs.second : lhs.first > rhs.first;
+				});
+				kids.clear();
+				for (size_t i = 0; i < n; i++) kids.push_back(scored[i].second);
+			}
+
+			//! extend a partial tie up until every shed can be built
+			//! \param tread current treadles, updated with the solution on success
+			//! \param s first shed that may not be buildable
+			//! \return true if a solution was found
+			bool extend(std::vector<uint64_t>& tread, size_t s) {
+				s = next(s, tread);
+				if (prob.sheds.size() == s) return true;
+				if (tread.size() >= prob.treadles || stop()) return false;
+				if (tread.size() + bound(s, tread) > prob.treadles) return false; // we'll run out of treadles
+
+				std::vector<uint64_t> kids;
+				children(s, tread, kids);
+				for (uint64_t const& c : kids) {
+					tread.push_back(c);
+					if (extend(tread, s)) return true;
+					tread.pop_back();
+					if (stop()) return false;
+				}
+				return false;
+			}
+		};
+
+		//! search for a tie up where no shed needs more than prob.maxPress presses
+		//! \param prob problem to solve
+		//! \param threads number of threads to use
+		//! \return treadles or an empty vector if nothing was found (check prob.timeout to see if the search was cut short)
+		std::vector<uint64_t> decide(Problem& prob, unsigned threads) {
+			// split the top of the search tree into tasks (in depth first order) so threads can share the work
+			// the earliest task with a solution wins so the result doesn't depend on how the threads are scheduled
+			struct Task {
+				std::vector<uint64_t> tread;
+				size_t                shed ;
+			};
+			std::vector<Task> tasks(1, Task{std::vector<uint64_t>(), 0});
+			Search split(prob, 0);
+			for (size_t depth = 0; depth < 3 && tasks.size() < 8 * size_t(threads); depth++) {
+				std::vector<Task> expanded;
+				std::vector<uint64_t> kids;
+				for (Task& t : tasks) {
+					const size_t s = split.next(t.shed, t.tread);
+					if (prob.sheds.size() == s || t.tread.size() >= prob.treadles) { // nothing to expand
+						expanded.push_back(std::move(t));
+						continue;
+					}
+					split.children(s, t.tread, kids);
+					for (uint64_t const& c : kids) {
+						expanded.push_back(Task{t.tread, s});
+						expanded.back().tread.push_back(c);
+					}
+				}
+				tasks.swap(expanded);
+			}
+
+			// now search the tasks in parallel
+			prob.found = none;
+			std::atomic<size_t> nextTask(0);
+			std::vector< std::vector<uint64_t> > results(tasks.size());
+			const size_t count = std::max<size_t>(1, std::min<size_t>(threads, tasks.size()));
+			std::vector<std::exception_ptr> errors(count);
+			auto work = [&](size_t id) {
+				try {
+					for (size_t t = nextTask++; t < tasks.size(); t = nextTask++) {
+						if (prob.found.load() < t || prob.timeout) return; // tasks are handed out in order so nothing later can win
+						Search search(prob, t);
+						std::vector<uint64_t> tread = tasks[t].tread;
+						if (search.extend(tread, tasks[t].shed)) {
+							results[t].swap(tread);
+							size_t f = prob.found.load();
+							while (t < f && !prob.found.compare_exchange_weak(f, t)) ;
+						}
+					}
+				} catch (...) {
+					errors[id] = std::current_exception();
+					prob.timeout = true; // stop the other threads
+				}
+			};
+			std::vector<std::thread> pool;
+			pool.reserve(count - 1);
+			for (size_t i = 1; i < count; i++) pool.emplace_back(work, i);
+			work(0);
+			for (std::thread& t : pool) t.join();
+			for (std::exception_ptr const& e : errors) if (e) std::rethrow_exception(e);
+
+			const size_t f = prob.found.load();
+			return none == f ? std::vector<uint64_t>() : results[f];
+		}
+	}
+
+	std::vector<uint64_t> skeletonTieup(std::vector<uint64_t> const& sheds, size_t treadles, size_t maxPress, double seconds, unsigned threads) {
+		if (!(seconds > 0) || maxPress < 2) return std::vector<uint64_t>(); // no time to search or nothing to improve on
+
+		Problem prob;
+		prob.treadles = treadles;
+		prob.deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(std::min(seconds, 1e8)));
+		prob.timeout = false;
+		prob.found = none;
+
+		// build the sheds from fewest to most shafts, small sheds tend to become the treadles that larger ones are built from
+		for (uint64_t const& s : sheds) if (0 != s) prob.sheds.push_back(s);
+		std::sort(prob.sheds.begin(), prob.sheds.end(), [](uint64_t lhs, uint64_t rhs) {
+			const size_t pl = bits::popcount(lhs), pr = bits::popcount(rhs);
+			return pl == pr ? lhs < rhs : pl < pr;
+		});
+		prob.sheds.erase(std::unique(prob.sheds.begin(), prob.sheds.end()), prob.sheds.end());
+		std::vector<uint64_t> best;
+		if (prob.sheds.size() <= treadles) { // every shed fits on its own treadle
+			best = prob.sheds;
+		} else {
+			// candidate treadles are the sheds themselves, their pairwise intersections and single shafts (which make a straight tie up reachable)
+			std::vector<uint64_t> pool = prob.sheds;
+			uint64_t all = 0;
+			for (size_t a = 0; a < prob.sheds.size(); a++) {
+				all |= prob.sheds[a];
+				if (prob.sheds.size() > 1024) continue; // don't let the pool explode for huge designs
+				for (size_t b = a + 1; b < prob.sheds.size(); b++) {
+					const uint64_t x = prob.sheds[a] & prob.sheds[b];
+					if (0 != x) pool.push_back(x);
+				}
+			}
+			bits::forEach(&all, 1, [&pool](size_t i) {pool.push_back(uint64_t(1) << i);});
+			std::sort(pool.begin(), pool.end());
+			pool.erase(std::unique(pool.begin(), pool.end()), pool.end());
+			prob.subsets.resize(prob.sheds.size());
+			for (size_t s = 0; s < prob.sheds.size(); s++) {
+				for (uint64_t const& c : pool) if (0 == (c & ~prob.sheds[s])) prob.subsets[s].push_back(c);
+			}
+
+			// n treadles can only build so many sheds by pressing at most p at once, skip budgets that can't possibly work
+			size_t lower = 1;
+			for (size_t combos = treadles, choose = treadles; combos < prob.sheds.size() && lower < maxPress; ) {
+				// combos = sum of (treadles choose i) for i <= lower, saturating so it can't overflow
+				lower++;
+				choose = treadles < lower ? 0 : choose * (treadles - lower + 1) / lower;
+				combos = std::max(combos, combos + choose);
+			}
+
+			// tighten the press limit until the search fails or runs out of time, each success is a better tie up
+			if (0 == threads) threads = threadCount();
+			for (size_t p = maxPress - 1; p >= lower; p--) {
+				prob.maxPress = p;
+				std::vector<uint64_t> tieup = decide(prob, threads);
+				if (tieup.empty()) break; // either out of time or (as far as this search can tell) nothing works
+				best.swap(tieup);
+			}
+		}
+
+		std::sort(best.begin(), best.end(), listLess);
+		return best;
+	}
+
+	std::vector<uint_fast32_t> pressTreadles(uint64_t shed, std::vector<uint64_t> const& tieup) {
+		// get the treadles that can be pressed for this shed
+		std::vector<uint64_t> avail;
+		std::vector<uint_fast32_t> index;
+		uint64_t u = 0;
+		for (size_t i = 0; i < tieup.size(); i++) {
+			if (0 != (tieup[i] & ~shed)) continue;
+			avail.push_back(tieup[i]);
+			index.push_back(static_cast<uint_fast32_t>(i));
+			u |= tieup[i];
+		}
+		if (u != shed) throw std::invalid_argument("shed can't be built from tie up");
+
+		// iterative deepening finds the fewest presses (a shed never needs more presses than it has shafts)
+		std::vector<size_t> pick(bits::popcount(shed) + 1);
+		size_t n = 0;
+		while (!coverable(shed, avail.data(), avail.size(), n, pick.data())) n++;
+		std::vector<uint_fast32_t> press(n);
+		for (size_t i = 0; i < n; i++) press[i] = index[pick[i]];
+		std::sort(press.begin(), press.end());
+		return press;
+	}
+}
@@ -1,13 +1,134 @@
 #include "wif.h"
+#include "wif_parser.h"
+#include "wif_io.h"
+#include "mapped_file.h"
+#include "bits.h"
+#include "parallel.h"
+#include "stats.h"
 
 #include <sstream>
 #include <functional>
 #include <unordered_map>
 #include <algorithm>
+#include <iterator>
 #include <limits>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+#include <memory>
+#include <type_traits>
+#include <optional>
+#include <array>
+#include <memory_resource>
 
 using namespace corvus;
 
+//! run independent tasks, in parallel if asked to, recording failures instead of stopping at the first one
+//! \param n number of tasks
+//! \param threads number of threads (0 for every hardware thread, 1 to run the tasks in order on the calling thread)
+//! \param order function to get the task to hand out i-th as order(i), e.g. to start the biggest tasks first
+//! \param f function to call as f(task)
+//! \return exception thrown by each task (null if it finished), when running in order nothing after the first failure is run
+template <typename O, typename F> std::vector<std::exception_ptr> runTasks(size_t n, unsigned threads, O order, F f) {
+	std::vector<std::exception_ptr> errors(n);
+	if (1 == threads || detail::inWorker) { // nested parallel work stays serial like parallelFor
+		for (size_t i = 0; i < n; i++) {
+			try {
+				f(i);
+			} catch (...) {
+				errors[i] = std::current_exception();
+				break;
+			}
+		}
+	} else {
+		parallelForEach(n, threads, [&](size_t i, size_t) {
+			const size_t t = order(i);
+			try {
+				f(t);
+			} catch (...) {
+				errors[t] = std::current_exception();
+			}
+			return true;
+		});
+	}
+	return errors;
+}
+
+//! run independent tasks in the order they are listed (see above)
+template <typename F> std::vector<std::exception_ptr> runTasks(size_t n, unsigned threads, F f) {
+	return runTasks(n, threads, [](size_t i) {return i;}, f);
+}
+
+//! rethrow the first failure from runTasks
+//! \param errors exception from each task
+//! \note since only the first failure is rethrown the error is the same one running the tasks in order would give
+void rethrowFirst(std::vector<std::exception_ptr> const& errors) {
+	for (std::exception_ptr const& e : errors) if (e) std::rethrow_exception(e);
+}
+
+namespace corvus { namespace wif_io {
+	//! a sparse 1 indexed list of lists (e.g. [THREADING]) with every list stored back to back
+	//! big drafts have a list per thread so this is a handful of allocations instead of a vector per thread
+	struct KeyedRows {
+		std::vector<Wif::Integer> keys; //!< thread (or treadle) number of each list
+		Csr<Wif::Integer>         rows; //!< values of each list (in the same order as keys)
+
+		//! get the number of lists
+		size_t size() const {return keys.size();}
+
+		//! check if there are any lists
+		bool empty() const {return keys.empty();}
+
+		//! move the lists out of a list of <int, vec<int>>
+		//! \param v list to take (emptied)
+		void take(std::vector< std::pair<Wif::Integer, Wif::VecInt > >& v) {
+			size_t n = 0;
+			for (std::pair<Wif::Integer, Wif::VecInt > const& p : v) n += p.second.size();
+			keys.clear();
+			rows.clear();
+			keys.reserve(v.size());
+			rows.offsets.reserve(v.size() + 1);
+			rows.values.reserve(n);
+			for (std::pair<Wif::Integer, Wif::VecInt > const& p : v) {
+				keys.push_back(p.first);
+				rows.push(p.second.data(), p.second.data() + p.second.size());
+			}
+			std::vector< std::pair<Wif::Integer, Wif::VecInt > >().swap(v);
+		}
+
+		//! reorder (or drop) lists
+		//! \param order indices of the lists to keep in their new order
+		void select(std::vector<size_t> const& order) {
+			KeyedRows sel;
+			sel.keys.reserve(order.size());
+			sel.rows.offsets.reserve(order.size() + 1);
+			sel.rows.values.reserve(rows.values.size());
+			for (size_t const& k : order) {
+				sel.keys.push_back(keys[k]);
+				sel.rows.push(rows.begin(k), rows.end(k));
+			}
+			*this = std::move(sel);
+		}
+
+		//! sort the lists by key keeping the order of equal keys (lists that are already sorted, e.g. from read, are left alone)
+		void sortKeys() {
+			if (std::is_sorted(keys.cbegin(), keys.cend())) return;
+			std::vector<size_t> order(keys.size());
+			for (size_t k = 0; k < order.size(); k++) order[k] = k;
+			std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {return keys[a] < keys[b];});
+			select(order);
+		}
+	};
+
+	//! the lists of lists while they are being checked
+	struct LayoutLists {
+		KeyedRows tieUp    ;
+		KeyedRows threading;
+		KeyedRows treadling;
+		KeyedRows liftPlan ;
+	};
+} }
+
 template <typename T> void sortAndDupCheck(std::vector< std::pair<Wif::Integer, T> >& v, std::string const& name) {
 	std::sort(v.begin(), v.end());
 	v.erase(std::unique(v.begin(), v.end()), v.end()); // it is ok if we have double entries as long as they are the same
@@ -18,6 +139,25 @@ template <typename T> void sortAndDupCheck(std::vector< std::pair<Wif::Integer,
 	}
 }
 
+//! sort a list of lists by key and check for duplicates (the same as above for a list of <int, vec<int>>)
+//! \param v lists to sort, identical duplicates are removed
+//! \param name name of list for error messages
+void sortAndDupCheck(wif_io::KeyedRows& v, std::string const& name) {
+	v.sortKeys();
+	bool doubles = false;
+	for (size_t i = 1; i < v.size(); i++) {
+		if (v.keys[i-1] != v.keys[i]) continue;
+		if (!std::equal(v.rows.begin(i-1), v.rows.end(i-1), v.rows.begin(i), v.rows.end(i))) {
+			throw std::invalid_argument(name + " has multiple entries for number " + std::to_string(v.keys[i])); // these conflict
+		}
+		doubles = true; // it is ok if we have double entries as long as they are the same
+	}
+	if (!doubles) return;
+	std::vector<size_t> keep;
+	for (size_t i = 0; i < v.size(); i++) if (0 == i || v.keys[i-1] != v.keys[i]) keep.push_back(i);
+	v.select(keep);
+}
+
 //! get the iterator to an item in a sorted list of pairs of <int, T>
 //! \param v vector of pairs to search
 //! \param i index to search for
@@ -52,58 +192,124 @@ template <typename T> bool searchIndex(std::vector< std::pair<Wif::Integer, T> >
 	}
 }
 
-//! densify a list of <int, vec<int>>
-//! \param v list to densify, i.e. replace implied <i, {0}> with actual entries
+//! move a sorted list of lists into dense compressed rows
+//! \param v lists to densify (emptied), implied entries become {0}
 //! \param n target number
-void densifyList(typename std::vector< std::pair<Wif::Integer, Wif::VecInt > >& v, Wif::Integer n) {
-	for (std::pair<Wif::Integer, Wif::VecInt >& p : v) std::sort(p.second.begin(), p.second.end()); // also sort the vecint while we're at it
-
-	typename std::vector<std::pair<Wif::Integer, Wif::VecInt> > skipped;
-	skipped.reserve(n - v.size());
-	Wif::Integer curIdx = 1;
-	for (Wif::Integer i = 1; i <= n; i++) {
-		if (curIdx-1 >= v.size()) { // we've reached the end of our list
-			skipped.emplace_back(curIdx, Wif::VecInt{0}); // i.e. advance i but leave the current thread unchanged
-		} else if (v[curIdx-1].first == i) {
-			// we have this thread in the list already, advance to next one
-			++curIdx; // i.e. advance current thread and i together
+//! \param csr location to write n rows, each row is sorted
+//! \param name name of list for error messages
+//! \param count name of target number for error messages
+//! \note if v is empty the existing rows are kept and padded out to n (e.g. sanityCheck is being called a second time)
+void densifyList(wif_io::KeyedRows& v, Wif::Integer n, Csr<Wif::Integer>& csr, std::string const& name, std::string const& count) {
+	if (!v.empty()) csr.clear();
+	else if (csr.size() > n) throw std::invalid_argument(name + " is longer than " + count);
+
+	// the keys are sorted and unique so a list with an entry for every thread is already dense (this is the usual case)
+	for (size_t k = 0; k < v.size(); k++) std::sort(v.rows.begin(k), v.rows.end(k));
+	bool dense = !v.empty() && v.size() == n && v.keys.back() == n;
+	for (size_t k = 0; k < v.size() && dense; k++) dense = v.rows.count(k) > 0;
+	if (dense) {
+		csr = std::move(v.rows);
+		v = wif_io::KeyedRows();
+		return;
+	}
+
+	const Wif::Integer zero = 0;
+	csr.offsets.reserve(size_t(n) + 1);
+	size_t k = 0;
+	for (Wif::Integer i = static_cast<Wif::Integer>(csr.size()) + 1; i <= n; i++) {
+		if (k < v.size() && v.keys[k] == i) {
+			if (0 == v.rows.count(k)) csr.push(zero);
+			else csr.push(v.rows.begin(k), v.rows.end(k));
+			++k;
 		} else {
-			// we don't have it, since the list has been sorted that means v[curIdx].first > i, leave it unchanged
-			skipped.emplace_back(curIdx, Wif::VecInt{0}); // i.e. advance i but leave the current thread unchanged
+			csr.push(zero); // we don't have it, since the list has been sorted that means v.keys[k] > i
 		}
 	}
+	if (k != v.size()) throw std::invalid_argument(name + " has index outside of " + count);
+	v = wif_io::KeyedRows(); // free the lists
+}
+
+//! pack a sorted list of lists into masks
+//! \param v lists to pack (emptied), implied entries have no bits set
+//! \param n target number
+//! \param words 64 bit words per mask
+//! \param masks location to write n masks, value k sets bit k-1 (0 sets nothing)
+//! \param check function to call as check(begin, end) with each sorted value list before it is packed (should throw if the list isn't valid)
+//! \param name name of list for error messages
+//! \param count name of target number for error messages
+//! \note if v is empty the existing masks are kept (e.g. sanityCheck is being called a second time)
+template <typename F> void packList(wif_io::KeyedRows& v, Wif::Integer n, size_t words, std::vector<uint64_t>& masks, F check, std::string const& name, std::string const& count) {
+	if (v.empty()) {
+		if (masks.empty()) masks.assign(n * words, 0);
+		else if (masks.size() != n * words) throw std::invalid_argument(name + " doesn't match " + count);
+		return;
+	}
 
-	// now that we have the list of skipped threads add them all in
-	auto iter = v.insert(v.end(), skipped.cbegin(), skipped.cend()); // split over 2 lines since c.begin may be invalidated
-	std::inplace_merge(v.begin(), iter, v.end());
+	masks.assign(n * words, 0);
+	for (size_t k = 0; k < v.size(); k++) {
+		if (0 == v.keys[k] || v.keys[k] > n) throw std::invalid_argument(name + " has index outside of " + count);
+		Wif::Integer* const b = v.rows.begin(k);
+		Wif::Integer* const e = v.rows.end  (k);
+		std::sort(b, e);
+		check(static_cast<Wif::Integer const*>(b), static_cast<Wif::Integer const*>(e));
+		uint64_t* m = masks.data() + (v.keys[k] - 1) * words;
+		for (Wif::Integer const* s = b; s != e; ++s) if (0 != *s) bits::set(m, *s - 1, true);
+	}
+	v = wif_io::KeyedRows(); // free the lists
 }
 
-void Wif::sanityCheck() {
+//! expand a sorted list of <int, T> to a value for every thread
+//! \param v list to expand (indices already checked to be in [1, n])
+//! \param n number of threads
+//! \param def value for threads that aren't listed
+//! \param dense location to write n values
+template <typename T> void denseValues(std::vector< std::pair<Wif::Integer, T> > const& v, Wif::Integer n, T const& def, std::vector<T>& dense) {
+	dense.assign(n, def);
+	for (std::pair<Wif::Integer, T> const& p : v) dense[p.first - 1] = p.second;
+}
+
+void Wif::sanityCheck(unsigned threads) {
+	// the lists of lists are checked in the same flat form that read parses them into
+	wif_io::LayoutLists lists;
+	lists.tieUp    .take(tieUp    );
+	lists.threading.take(threading);
+	lists.treadling.take(treadling);
+	lists.liftPlan .take(liftPlan );
+	sanityCheck(threads, lists);
+}
+
+void Wif::sanityCheck(unsigned threads, wif_io::LayoutLists& lists) {
 	// sort all of our lists of {thread id, value} and check for duplicates
-	sortAndDupCheck(notes                , "notes"              );
-	sortAndDupCheck(tieUp                , "tieup"              );
-	sortAndDupCheck(colorTable           , "color table"        );
-	sortAndDupCheck(warpSymbolTable      , "warp symbol table"  );
-	sortAndDupCheck(weftSymbolTable      , "weft symbol table"  );
-	sortAndDupCheck(threading            , "threading"          );
-	sortAndDupCheck(warpThicknessList    , "warp thickness"     );
-	sortAndDupCheck(warpThicknessZoomList, "warp thickness zoom");
-	sortAndDupCheck(warpSpacingList      , "warp spacing"       );
-	sortAndDupCheck(warpSpacingZoomList  , "warp spacing zoom"  );
-	sortAndDupCheck(warpColorList        , "warp colors"        );
-	sortAndDupCheck(warpSymbolList       , "warp symbols"       );
-	sortAndDupCheck(treadling            , "treadling"          );
-	sortAndDupCheck(liftPlan             , "liftplan"           );
-	sortAndDupCheck(weftThicknessList    , "weft thickness"     );
-	sortAndDupCheck(weftThicknessZoomList, "weft thickness zoom");
-	sortAndDupCheck(weftSpacingList      , "weft spacing"       );
-	sortAndDupCheck(weftSpacingZoomList  , "weft spacing zoom"  );
-	sortAndDupCheck(weftColorList        , "weft colors"        );
-	sortAndDupCheck(weftSymbolList       , "weft symbols"       );
+	// the lists are independent so they can be sorted at the same time
+	CORVUS_STATS_PHASES(timer, SortAndDupCheck);
+	const std::function<void()> sorts[] = {
+		[&]() {sortAndDupCheck(notes                , "notes"              );},
+		[&]() {sortAndDupCheck(lists.tieUp          , "tieup"              );},
+		[&]() {sortAndDupCheck(colorTable           , "color table"        );},
+		[&]() {sortAndDupCheck(warpSymbolTable      , "warp symbol table"  );},
+		[&]() {sortAndDupCheck(weftSymbolTable      , "weft symbol table"  );},
+		[&]() {sortAndDupCheck(lists.threading      , "threading"          );},
+		[&]() {sortAndDupCheck(warpThicknessList    , "warp thickness"     );},
+		[&]() {sortAndDupCheck(warpThicknessZoomList, "warp thickness zoom");},
+		[&]() {sortAndDupCheck(warpSpacingList      , "warp spacing"       );},
+		[&]() {sortAndDupCheck(warpSpacingZoomList  , "warp spacing zoom"  );},
+		[&]() {sortAndDupCheck(warpColorList        , "warp colors"        );},
+		[&]() {sortAndDupCheck(warpSymbolList       , "warp symbols"       );},
+		[&]() {sortAndDupCheck(lists.treadling      , "treadling"          );},
+		[&]() {sortAndDupCheck(lists.liftPlan       , "liftplan"           );},
+		[&]() {sortAndDupCheck(weftThicknessList    , "weft thickness"     );},
+		[&]() {sortAndDupCheck(weftThicknessZoomList, "weft thickness zoom");},
+		[&]() {sortAndDupCheck(weftSpacingList      , "weft spacing"       );},
+		[&]() {sortAndDupCheck(weftSpacingZoomList  , "weft spacing zoom"  );},
+		[&]() {sortAndDupCheck(weftColorList        , "weft colors"        );},
+		[&]() {sortAndDupCheck(weftSymbolList       , "weft symbols"       );},
+	};
+	rethrowFirst(runTasks(std::size(sorts), threads, [&](size_t i) {sorts[i]();}));
+	CORVUS_STATS_NEXT(timer, RangeChecks);
 
 	// next make sure none of our lists are longer than they should be
 	if (warpSymbolTable      .size() > warpThreads) throw std::invalid_argument("warp symbol table is longer than warp threads");
-	if (threading            .size() > warpThreads) throw std::invalid_argument("threading is longer than warp threads");
+	if (lists.threading      .size() > warpThreads) throw std::invalid_argument("threading is longer than warp threads");
 	if (warpThicknessList    .size() > warpThreads) throw std::invalid_argument("warp thickness is longer than warp threads");
 	if (warpThicknessZoomList.size() > warpThreads) throw std::invalid_argument("warp thickness zoom is longer than warp threads");
 	if (warpSpacingList      .size() > warpThreads) throw std::invalid_argument("warp spacing is longer than warp threads");
@@ -111,8 +317,8 @@ void Wif::sanityCheck() {
 	if (warpColorList        .size() > warpThreads) throw std::invalid_argument("warp colors is longer than warp threads");
 	if (warpSymbolList       .size() > warpThreads) throw std::invalid_argument("warp symbols is longer than warp threads");
 	if (weftSymbolTable      .size() > weftThreads) throw std::invalid_argument("weft symbol table is longer than weft threads");
-	if (treadling            .size() > weftThreads) throw std::invalid_argument("treadling is longer than weft threads");
-	if (liftPlan             .size() > weftThreads) throw std::invalid_argument("lift plan is longer than weft threads");
+	if (lists.treadling      .size() > weftThreads) throw std::invalid_argument("treadling is longer than weft threads");
+	if (lists.liftPlan       .size() > weftThreads) throw std::invalid_argument("lift plan is longer than weft threads");
 	if (weftThicknessList    .size() > weftThreads) throw std::invalid_argument("weft thickness is longer than weft threads");
 	if (weftThicknessZoomList.size() > weftThreads) throw std::invalid_argument("weft thickness zoom is longer than weft threads");
 	if (weftSpacingList      .size() > weftThreads) throw std::invalid_argument("weft spacing is longer than weft threads");
@@ -139,6 +345,33 @@ void Wif::sanityCheck() {
 		throw std::invalid_argument("shaft / treadle count must either both be positive or both be 0");
 	}
 
+	// check the index / value of each entry in the per thread lists (these are the slow checks for big drafts so they are run together up front)
+	// they only read the sorted lists so the errors are held until the same point the checks would be made one at a time
+	const std::function<void()> warpChecks[] = {
+		[&]() {for (auto const& p : warpSymbolTable      ) if (0 == p.first || p.first > warpThreads) throw std::invalid_argument("warp symbol table has warp index outside of warp thread count");},
+		[&]() {wif_io::KeyedRows const& l = lists.threading; for (size_t k = 0; k < l.size(); k++) if (0 == l.keys[k] || l.keys[k] > warpThreads || 0 == l.rows.count(k)) throw std::invalid_argument("threading has warp index outside of warp thread count or empty list (please use shaft 0 for unused warps)");}, // spec says use 0 not an empty list
+		[&]() {for (auto const& p : warpThicknessList    ) if (0 == p.first || p.first > warpThreads || p.second <  0) throw std::invalid_argument("warp thickness has warp index outside of warp thread count or thickness < 0");},
+		[&]() {for (auto const& p : warpThicknessZoomList) if (0 == p.first || p.first > warpThreads || p.second == 0) throw std::invalid_argument("warp zoom has warp index outside of warp thread count or zoom = 0");},
+		[&]() {for (auto const& p : warpSpacingList      ) if (0 == p.first || p.first > warpThreads || p.second <  0) throw std::invalid_argument("warp spacing has warp index outside of warp thread count or spacing < 0");},
+		[&]() {for (auto const& p : warpSpacingZoomList  ) if (0 == p.first || p.first > warpThreads || p.second == 0) throw std::invalid_argument("warp spacing zoom has warp index outside of warp thread count or zoom = 0");},
+		[&]() {for (auto const& p : warpColorList        ) if (0 == p.first || p.first > warpThreads || !searchIndex(colorTable     , p.second) ) throw std::invalid_argument("warp colors has warp index outside of warp thread count or index not in color table");},
+		[&]() {for (auto const& p : warpSymbolList       ) if (0 == p.first || p.first > warpThreads || !searchIndex(warpSymbolTable, p.second) ) throw std::invalid_argument("warp symbols has warp index outside of warp thread count or index not in symbol table");},
+	};
+	const std::function<void()> weftChecks[] = {
+		[&]() {for (auto const& p : weftSymbolTable      ) if (0 == p.first || p.first > weftThreads) throw std::invalid_argument("weft symbol table has weft index outside of weft thread count");},
+		[&]() {for (Integer const& t : lists.treadling.keys) if (0 == t || t > weftThreads) throw std::invalid_argument("treadling has weft index outside of weft thread count");},
+		[&]() {for (Integer const& t : lists.liftPlan .keys) if (0 == t || t > weftThreads) throw std::invalid_argument("liftPlan has weft index outside of weft thread count");},
+		[&]() {for (auto const& p : weftThicknessList    ) if (0 == p.first || p.first > weftThreads || p.second <  0) throw std::invalid_argument("weft thickness has weft index outside of weft thread count or thickness < 0");},
+		[&]() {for (auto const& p : weftThicknessZoomList) if (0 == p.first || p.first > weftThreads || p.second == 0) throw std::invalid_argument("weft zoom has weft index outside of weft thread count or zoom = 0");},
+		[&]() {for (auto const& p : weftSpacingList      ) if (0 == p.first || p.first > weftThreads || p.second <  0) throw std::invalid_argument("weft spacing has weft index outside of weft thread count or spacing < 0");},
+		[&]() {for (auto const& p : weftSpacingZoomList  ) if (0 == p.first || p.first > weftThreads || p.second == 0) throw std::invalid_argument("weft spacing zoom has weft index outside of weft thread count or zoom = 0");},
+		[&]() {for (auto const& p : weftColorList        ) if (0 == p.first || p.first > weftThreads || !searchIndex(colorTable     , p.second) ) throw std::invalid_argument("weft colors has weft index outside of weft thread count or index not in color table");},
+		[&]() {for (auto const& p : weftSymbolList       ) if (0 == p.first || p.first > weftThreads || !searchIndex(weftSymbolTable, p.second) ) throw std::invalid_argument("weft symbols has weft index outside of weft thread count or index not in symbol table");},
+	};
+	std::vector<std::exception_ptr> warpRanges, weftRanges;
+	if (warpThreads != 0) warpRanges = runTasks(std::size(warpChecks), threads, [&](size_t i) {warpChecks[i]();});
+	if (weftThreads != 0) weftRanges = runTasks(std::size(weftChecks), threads, [&](size_t i) {weftChecks[i]();});
+
 	// there is a bunch of stuff that needs to be consistent across the warp information
 	if (warpThreads != 0) {
 		// we have warps, the numbering better be consistent
@@ -158,22 +391,15 @@ void Wif::sanityCheck() {
 		if (Unit::None == warpUnit) throw std::invalid_argument("warp units is required");
 		if (warpSpacing   < 0     ) throw std::invalid_argument("warp spacing must be >= 0");
 		if (warpThickness < 0     ) throw std::invalid_argument("warp thickness must be >= 0");
-		for (auto const& p : warpSymbolTable      ) if (0 == p.first || p.first > warpThreads) throw std::invalid_argument("warp symbol table has warp index outside of warp thread count");
-		for (auto const& p : threading            ) if (0 == p.first || p.first > warpThreads || p.second.empty()) throw std::invalid_argument("threading has warp index outside of warp thread count or empty list (please use shaft 0 for unused warps)"); // spec says use 0 not an empty list
-		for (auto const& p : warpThicknessList    ) if (0 == p.first || p.first > warpThreads || p.second <  0) throw std::invalid_argument("warp thickness has warp index outside of warp thread count or thickness < 0");
-		for (auto const& p : warpThicknessZoomList) if (0 == p.first || p.first > warpThreads || p.second == 0) throw std::invalid_argument("warp zoom has warp index outside of warp thread count or zoom = 0");
-		for (auto const& p : warpSpacingList      ) if (0 == p.first || p.first > warpThreads || p.second <  0) throw std::invalid_argument("warp spacing has warp index outside of warp thread count or spacing < 0");
-		for (auto const& p : warpSpacingZoomList  ) if (0 == p.first || p.first > warpThreads || p.second == 0) throw std::invalid_argument("warp spacing zoom has warp index outside of warp thread count or zoom = 0");
-		for (auto const& p : warpColorList        ) if (0 == p.first || p.first > warpThreads || !searchIndex(colorTable     , p.second) ) throw std::invalid_argument("warp colors has warp index outside of warp thread count or index not in color table");
-		for (auto const& p : warpSymbolList       ) if (0 == p.first || p.first > warpThreads || !searchIndex(warpSymbolTable, p.second) ) throw std::invalid_argument("warp symbols has warp index outside of warp thread count or index not in symbol table");
+		rethrowFirst(warpRanges);
 	} else {
 		// we don't have warps, we'd better not have anything else
 		if (0 != warpColorIndex           ) throw std::invalid_argument("cannot have warp color index without warp threads");
 		if (0 != warpSymbol               ) throw std::invalid_argument("cannot have warp symbol without warp threads");
 		if (0 != warpSymbolNum            ) throw std::invalid_argument("cannot have warp symbol number without warp threads");
 		if (Unit::None != warpUnit        ) throw std::invalid_argument("cannot have warp unit without warp threads");
-		if (!isnan(warpSpacing  )         ) throw std::invalid_argument("cannot have warp spacing without warp threads");
-		if (!isnan(warpThickness)         ) throw std::invalid_argument("cannot have warp spacing without warp threads");
+		if (!std::isnan(warpSpacing  )         ) throw std::invalid_argument("cannot have warp spacing without warp threads");
+		if (!std::isnan(warpThickness)         ) throw std::invalid_argument("cannot have warp spacing without warp threads");
 		if (1 != warpSpacingZoom          ) throw std::invalid_argument("cannot have warp spacing zoom without warp threads");
 		if (1 != warpThicknessZoom        ) throw std::invalid_argument("cannot have warp thickness zoom without warp threads");
 		// already handled empty lists with our size comparison check
@@ -198,23 +424,15 @@ void Wif::sanityCheck() {
 		if (Unit::None == weftUnit) throw std::invalid_argument("weft units is required");
 		if (weftSpacing   < 0     ) throw std::invalid_argument("weft spacing must be >= 0");
 		if (weftThickness < 0     ) throw std::invalid_argument("weft thickness must be >= 0");
-		for (auto const& p : weftSymbolTable      ) if (0 == p.first || p.first > weftThreads) throw std::invalid_argument("weft symbol table has weft index outside of weft thread count");
-		for (auto const& p : treadling            ) if (0 == p.first || p.first > weftThreads) throw std::invalid_argument("treadling has weft index outside of weft thread count");
-		for (auto const& p : liftPlan             ) if (0 == p.first || p.first > weftThreads) throw std::invalid_argument("liftPlan has weft index outside of weft thread count");
-		for (auto const& p : weftThicknessList    ) if (0 == p.first || p.first > weftThreads || p.second <  0) throw std::invalid_argument("weft thickness has weft index outside of weft thread count or thickness < 0");
-		for (auto const& p : weftThicknessZoomList) if (0 == p.first || p.first > weftThreads || p.second == 0) throw std::invalid_argument("weft zoom has weft index outside of weft thread count or zoom = 0");
-		for (auto const& p : weftSpacingList      ) if (0 == p.first || p.first > weftThreads || p.second <  0) throw std::invalid_argument("weft spacing has weft index outside of weft thread count or spacing < 0");
-		for (auto const& p : weftSpacingZoomList  ) if (0 == p.first || p.first > weftThreads || p.second == 0) throw std::invalid_argument("weft spacing zoom has weft index outside of weft thread count or zoom = 0");
-		for (auto const& p : weftColorList        ) if (0 == p.first || p.first > weftThreads || !searchIndex(colorTable     , p.second) ) throw std::invalid_argument("weft colors has weft index outside of weft thread count or index not in color table");
-		for (auto const& p : weftSymbolList       ) if (0 == p.first || p.first > weftThreads || !searchIndex(weftSymbolTable, p.second) ) throw std::invalid_argument("weft symbols has weft index outside of weft thread count or index not in symbol table");
+		rethrowFirst(weftRanges);
 	} else {
 		// we don't have wefts, we'd better not have anything else
 		if (0 != weftColorIndex           ) throw std::invalid_argument("cannot have weft color index without weft threads");
 		if (0 != weftSymbol               ) throw std::invalid_argument("cannot have weft symbol without weft threads");
 		if (0 != weftSymbolNum            ) throw std::invalid_argument("cannot have weft symbol number without weft threads");
 		if (Unit::None != weftUnit        ) throw std::invalid_argument("cannot have weft unit without weft threads");
-		if (!isnan(weftSpacing  )         ) throw std::invalid_argument("cannot have weft spacing without weft threads");
-		if (!isnan(weftThickness)         ) throw std::invalid_argument("cannot have weft spacing without weft threads");
+		if (!std::isnan(weftSpacing  )         ) throw std::invalid_argument("cannot have weft spacing without weft threads");
+		if (!std::isnan(weftThickness)         ) throw std::invalid_argument("cannot have weft spacing without weft threads");
 		if (1 != weftSpacingZoom          ) throw std::invalid_argument("cannot have weft spacing zoom without weft threads");
 		if (1 != weftThicknessZoom        ) throw std::invalid_argument("cannot have weft thickness zoom without weft threads");
 		// already handled empty lists with our size comparison check
@@ -225,350 +443,657 @@ void Wif::sanityCheck() {
 	// it is also helpful to 'densify' the structure (i.e. populate all the optional/implied fields)
 	
 	// start by densifying
-	densifyList(threading, warpThreads);
-	densifyList(tieUp    , treadles   );
-	densifyList(treadling, weftThreads);
+	CORVUS_STATS_NEXT(timer, Densify);
+	densifyList(lists.threading, warpThreads, warp.shafts  , "threading", "warp threads");
+	densifyList(lists.treadling, weftThreads, weft.treadles, "treadling", "weft threads");
 
 	// now sanity check
-	for (auto const& p : threading) {
-		if (0 == p.second.front() && 1 != p.second.size()) throw std::invalid_argument("warp cannot be threaded through null shaft 0 and an actual shaft");
-		if (p.second.back() > shafts) throw std::invalid_argument("threading uses shaft number greater than shaft count");
+	for (size_t i = 0; i < warp.shafts.size(); i++) {
+		if (0 == *warp.shafts.begin(i) && 1 != warp.shafts.count(i)) throw std::invalid_argument("warp cannot be threaded through null shaft 0 and an actual shaft");
+		if (warp.shafts.end(i)[-1] > shafts) throw std::invalid_argument("threading uses shaft number greater than shaft count");
 	}
 
-	for (auto const& p : tieUp) {
-		if (0 == p.second.front() && 1 != p.second.size()) throw std::invalid_argument("treadle cannot be tied up to null shaft 0 and an actual shaft");
-		if (p.second.back() > shafts) throw std::invalid_argument("tie up uses shaft number greater than shaft count");
+	// the tie up is packed into shaft masks so it is checked as it goes
+	const size_t words = shaftWords();
+	packList(lists.tieUp, treadles, words, tieUpMasks, [&](Integer const* b, Integer const* e) {
+		if (b == e) return; // same as 0
+		if (0 == *b && 1 != e - b) throw std::invalid_argument("treadle cannot be tied up to null shaft 0 and an actual shaft");
+		if (e[-1] > shafts) throw std::invalid_argument("tie up uses shaft number greater than shaft count");
+	}, "tie up", "treadles");
+
+	for (size_t i = 0; i < weft.treadles.size(); i++) {
+		if (0 == *weft.treadles.begin(i) && 1 != weft.treadles.count(i)) throw std::invalid_argument("treadling cannot press null and treadle 0 and an actual treadle");
+		if (weft.treadles.end(i)[-1] > treadles) throw std::invalid_argument("treadling uses treadle number greater than treadle count");
 	}
 
-	for (auto const& p : treadling) {
-		if (0 == p.second.front() && 1 != p.second.size()) throw std::invalid_argument("treadling cannot press null and treadle 0 and an actual treadle");
-		if (p.second.back() > treadles) throw std::invalid_argument("treadling uses treadle number greater than treadle count");
+	// finally build / check liftplan, each weft is just the OR of the tie up of the treadles it presses
+	CORVUS_STATS_NEXT(timer, LiftPlan);
+	std::vector<uint64_t> reconLift(size_t(weftThreads) * words, 0);
+	for (size_t j = 0; j < weft.treadles.size(); j++) {
+		uint64_t* l = reconLift.data() + j * words;
+		for (Integer const* t = weft.treadles.begin(j); t != weft.treadles.end(j); ++t) {
+			if (0 != *t) bits::orRow(l, tieUpMasks.data() + (*t - 1) * words, words);
+		}
 	}
 
-	// finally build / check liftplan
-	std::vector< std::pair<Integer, VecInt> > reconLift;
-	reconLift.reserve(warpThreads);
-	for (auto const& p : treadling) {
-		if (0 == p.second.front()) {
-			reconLift.push_back(p); // nothing is lifted
-		} else {
-			// we could do a bunch of merge sorts here but it just isn't worth the trouble
-			VecInt shaftsUp;
-			for (Integer const& t : p.second) { // loop over treadles pressed down
-				VecInt const& s = tieUp[t-1].second; // the shafts lifted by this treadle
-				if (0 == s.front()) {
-					// for some reason we are pressing down a treadle that doesn't do anything
-				} else {
-					shaftsUp.insert(shaftsUp.end(), s.cbegin(), s.cend());
-				}
-			}
-			if (shaftsUp.empty()) shaftsUp.push_back(0);
+	if (!lists.liftPlan.empty() || !liftMasks.empty()) {
+		const std::string mismatch = "lift plan doesn't match plan generated from treadling and tie up";
+		packList(lists.liftPlan, weftThreads, words, liftMasks, [&](Integer const* b, Integer const* e) {
+			// anything that wouldn't be written back the same way can't match (e.g. 0 with other shafts or a repeated shaft)
+			if (1 == e - b && 0 == *b) return;
+			if (b == e || 0 == *b || e[-1] > shafts || e != std::adjacent_find(b, e)) throw std::invalid_argument(mismatch);
+		}, "lift plan", "weft threads");
+		if (liftMasks != reconLift) throw std::invalid_argument(mismatch);
+	} else {
+		liftMasks.swap(reconLift);
+	}
 
-			// instead just sort when we're done and remove duplicates
-			std::sort(shaftsUp.begin(), shaftsUp.end());
-			shaftsUp.erase( std::unique(shaftsUp.begin(), shaftsUp.end()), shaftsUp.end());
+	// the remaining per thread lists just need the defaults filled in
+	CORVUS_STATS_NEXT(timer, DenseValues);
+	denseValues(warpColorList        , warpThreads, warpColorIndex   , warp.colors       );
+	denseValues(warpSymbolList       , warpThreads, warpSymbolNum    , warp.symbols      );
+	denseValues(warpThicknessList    , warpThreads, warpThickness    , warp.thickness    );
+	denseValues(warpThicknessZoomList, warpThreads, warpThicknessZoom, warp.thicknessZoom);
+	denseValues(warpSpacingList      , warpThreads, warpSpacing      , warp.spacing      );
+	denseValues(warpSpacingZoomList  , warpThreads, warpSpacingZoom  , warp.spacingZoom  );
+	denseValues(weftColorList        , weftThreads, weftColorIndex   , weft.colors       );
+	denseValues(weftSymbolList       , weftThreads, weftSymbolNum    , weft.symbols      );
+	denseValues(weftThicknessList    , weftThreads, weftThickness    , weft.thickness    );
+	denseValues(weftThicknessZoomList, weftThreads, weftThicknessZoom, weft.thicknessZoom);
+	denseValues(weftSpacingList      , weftThreads, weftSpacing      , weft.spacing      );
+	denseValues(weftSpacingZoomList  , weftThreads, weftSpacingZoom  , weft.spacingZoom  );
+}
 
-			reconLift.emplace_back(p.first, shaftsUp);
-		}
+namespace corvus { namespace wif_io {
+
+	//! copy a string converting to upper case (section names are reported in upper case)
+	std::string toUpper(std::string_view str) {
+		std::string cpy(str);
+		for (char& c : cpy) c = toupper(c);
+		return cpy;
 	}
 
-	if (!liftPlan.empty()) {
-		densifyList(liftPlan , weftThreads);
-		if (liftPlan != reconLift) throw std::invalid_argument("lift plan doesn't match plan generated from treadling and tie up");
-	} else {
-		liftPlan.swap(reconLift);
+	//! copy a string converting to lower case (key names are reported in lower case)
+	std::string toLower(std::string_view str) {
+		std::string cpy(str);
+		for (char& c : cpy) c = tolower(c);
+		return cpy;
 	}
 
-}
+	//! every section name in the 1.1 standard (including the ones it reserves or suspends)
+	enum class SectionId : uint8_t {
+		Wif              , Contents         , Translations     , BitmapImage      , BitmapFile       ,
+		ColorPalette     , WarpSymbolPalette, WeftSymbolPalette,
+		Text             , Weaving          , Warp             , Weft             ,
+		Notes            , TieUp            , ColorTable       , WarpSymbolTable  , WeftSymbolTable  ,
+		Threading        , WarpThickness    , WarpThicknessZoom, WarpSpacing      , WarpSpacingZoom  , WarpColors       , WarpSymbols      ,
+		Treadling        , LiftPlan         , WeftThickness    , WeftThicknessZoom, WeftSpacing      , WeftSpacingZoom  , WeftColors       , WeftSymbols      ,
+		Unknown          , //!< not in the standard
+		Private            //!< PRIVATE ___ sections
+	};
 
-namespace wif_io {
-	typename Wif::VecInt  parse_vint(std::string const& str);
+	constexpr NameTable<SectionId> sectionNames(
+		"WIF"              , "CONTENTS"           , "TRANSLATIONS"       , "BITMAP IMAGE"       , "BITMAP FILE"        ,
+		"COLOR PALETTE"    , "WARP SYMBOL PALETTE", "WEFT SYMBOL PALETTE",
+		"TEXT"             , "WEAVING"            , "WARP"               , "WEFT"               ,
+		"NOTES"            , "TIEUP"              , "COLOR TABLE"        , "WARP SYMBOL TABLE"  , "WEFT SYMBOL TABLE"  ,
+		"THREADING"        , "WARP THICKNESS"     , "WARP THICKNESS ZOOM", "WARP SPACING"       , "WARP SPACING ZOOM"  , "WARP COLORS"        , "WARP SYMBOLS"       ,
+		"TREADLING"        , "LIFTPLAN"           , "WEFT THICKNESS"     , "WEFT THICKNESS ZOOM", "WEFT SPACING"       , "WEFT SPACING ZOOM"  , "WEFT COLORS"        , "WEFT SYMBOLS"
+	);
+
+	//! keys of [WIF]
+	enum class WifKey     : uint8_t {Version, Date, Developers, SourceProgram, SourceVersion, Unknown};
+	constexpr NameTable<WifKey    > wifKeys    ("version", "date", "developers", "source program", "source version");
+
+	//! keys of the ___ PALETTE sections
+	enum class PaletteKey : uint8_t {Entries, Form, Range, Unknown};
+	constexpr NameTable<PaletteKey> paletteKeys("entries", "form", "range");
+
+	//! keys of [TEXT]
+	enum class TextKey    : uint8_t {Title, Author, Address, Email, Telephone, Fax, Unknown};
+	constexpr NameTable<TextKey   > textKeys   ("title", "author", "address", "email", "telephone", "fax");
+
+	//! keys of [WEAVING]
+	enum class WeavingKey : uint8_t {Shafts, Treadles, RisingShed, Unknown};
+	constexpr NameTable<WeavingKey> weavingKeys("shafts", "treadles", "rising shed");
+
+	//! keys of [WARP] and [WEFT]
+	enum class ThreadKey  : uint8_t {Threads, Color, Symbol, SymbolNumber, Units, Spacing, Thickness, SpacingZoom, ThicknessZoom, Unknown};
+	constexpr NameTable<ThreadKey > threadKeys ("threads", "color", "symbol", "symbol number", "units", "spacing", "thickness", "spacing zoom", "thickness zoom");
+
+	static_assert(SectionId::WarpSymbols == sectionNames.find("Warp Symbols") && SectionId::Unknown == sectionNames.find("WARP SYMBOL"), "section name lookup is broken");
+
+	//! identify a section from its name
+	//! \param name section name (any case)
+	//! \return section id
+	SectionId sectionId(std::string_view name) {
+		if (name.size() > 8 && iequals("PRIVATE ", name.substr(0, 8))) return SectionId::Private;
+		return sectionNames.find(name);
+	}
+
+	//! a [SECTION] and its key=value pairs, everything points into the raw wif text
+	//! the list of keys is scratch memory from whatever resource the parse is using
+	struct Section {
+		std::string_view                                                   name;
+		SectionId                                                          id  ; //!< looked up once when the header is read
+		std::pmr::vector< std::pair<std::string_view, std::string_view> > keys;
+	};
 
-	std::string trimWs(std::string const& str) {
+	//! find a section by id
+	//! \param sections list of sections to search
+	//! \param id id of section to find
+	//! \return pointer to section or nullptr if not found
+	Section const* findSection(std::pmr::vector<Section> const& sections, SectionId id) {
+		for (Section const& s : sections) if (id == s.id) return &s;
+		return nullptr;
+	}
+
+	//! the [CONTENTS] table, standard sections are indexed by id and anything else (e.g. private sections) is looked up by name
+	struct Contents {
+		std::array<std::optional<bool>, static_cast<size_t>(SectionId::Unknown)> known; //!< value listed for each standard section (if any)
+		std::pmr::unordered_map<std::string_view, bool, CaseHash, CaseEqual>     other; //!< value listed for everything else
+
+		//! \param mr resource for the map of nonstandard sections
+		explicit Contents(std::pmr::memory_resource* mr) : other(mr) {}
+
+		//! add an entry
+		//! \param name section name
+		//! \param value listed value
+		void list(std::string_view name, bool value) {
+			const SectionId id = sectionId(name);
+			if (id < SectionId::Unknown) known[static_cast<size_t>(id)] = value;
+			else other[name] = value;
+		}
+
+		//! find the entry for a section
+		//! \param sect section to find
+		//! \return pointer to listed value or nullptr if the section isn't listed
+		bool* find(Section const& sect) {
+			if (sect.id < SectionId::Unknown) {
+				std::optional<bool>& v = known[static_cast<size_t>(sect.id)];
+				return v ? &*v : nullptr;
+			}
+			auto iter = other.find(sect.name);
+			return other.end() == iter ? nullptr : &iter->second;
+		}
+	};
+
+	std::string_view trimWs(std::string_view str) {
 		size_t idx = str.find_first_not_of(" \t");
-		if (std::string::npos == idx) throw std::invalid_argument("empty string cannot be parsed into WIF value");
-		std::string cpy = str.substr(idx);
-		while (isspace(cpy.back())) cpy.pop_back();
-		return cpy;
+		if (std::string_view::npos == idx) throw std::invalid_argument("empty string cannot be parsed into WIF value");
+		str.remove_prefix(idx);
+		while (isspace(static_cast<unsigned char>(str.back()))) str.remove_suffix(1);
+		return str;
 	}
 
-	typename Wif::Real    parse_real(std::string const& str) {
+	typename Wif::Real    parse_real(std::string_view str) {
 		static_assert(std::is_same<double, Wif::Real>::value, "wif parser assumes real is double");
-		return atof(trimWs(str).c_str());
+		return atof(std::string(trimWs(str)).c_str());
 	}
 
-	typename Wif::String  parse_str (std::string const& str) {
+	typename Wif::String  parse_str (std::string_view str) {
 		std::string cpy(str);
 		size_t idx = 0;
 		while( std::string::npos != ( idx = cpy.find("//", idx) ) ) cpy.replace(idx, 2, "\n");
 		return cpy;
 	}
 
-	void put_str(std::ostream& os, Wif::String const& str) {
+	template <typename Os> void put_str(Os& os, Wif::String const& str) {
 		for (char const& c : str) {
 			if ('\n' == c) os << "//";
 			else os << c;
 		}
 	}
 
-	typename Wif::Integer parse_int (std::string const& str) {
-		int i = atoi(trimWs(str).c_str());
-		if (i < 0 || unsigned int(i) > std::numeric_limits<Wif::Integer>::max()) throw std::invalid_argument(std::to_string(i) + " is outside representable range for WIF integer");
-		return static_cast<Wif::Integer>(i);
+	typename Wif::Integer parse_int (std::string_view str) {
+		str = trimWs(str);
+		Wif::Integer i = 0;
+		const std::from_chars_result r = std::from_chars(str.data(), str.data() + str.size(), i);
+		if (std::errc::result_out_of_range == r.ec) throw std::invalid_argument(std::string(str) + " is outside representable range for WIF integer");
+		if (std::errc() != r.ec || str.data() + str.size() != r.ptr) throw std::invalid_argument("\"" + std::string(str) + "\" is not a valid WIF integer"); // e.g. "12abc" or "-1"
+		return i;
 	}
 
-	typename Wif::Boolean parse_bool(std::string const& str) {
-		std::string cpy = trimWs(str);
+	typename Wif::Boolean parse_bool(std::string_view str) {
+		std::string_view cpy = trimWs(str);
 		if      ("true"  == cpy || "on"  == cpy || "yes" == cpy || "1" == cpy) return true;
 		else if ("false" == cpy || "off" == cpy || "no"  == cpy || "0" == cpy) return false;
-		else throw std::invalid_argument("string \"" + str + "\" cannot be parsed into WIF boolean");
+		else throw std::invalid_argument("string \"" + std::string(str) + "\" cannot be parsed into WIF boolean");
 	}
 
-	void put_bool(std::ostream& os, Wif::Boolean const& b) {
+	template <typename Os> void put_bool(Os& os, Wif::Boolean const& b) {
 		os << (b ? "true" : "false");
 	}
 
-	typename Wif::Color     parse_rgb (std::string const& str) {
-		Wif::VecInt v = parse_vint(str);
-		if (3 != v.size()) throw std::invalid_argument("\"" + str + "\" is invalid WIF color, expected 3 values but got " + std::to_string(v.size()));
-		return {v[0], v[1], v[2]};
-	}
-
-	void put_rgb(std::ostream& os, Wif::Color const& c) {
+	template <typename Os> void put_rgb(Os& os, Wif::Color const& c) {
 		os << c[0] << ',' << c[1] << ',' << c[2];
 	}
 
-	typename Wif::Symbol  parse_symb(std::string const& str) {
+	typename Wif::Symbol  parse_symb(std::string_view str) {
 		char c = 0;
-		std::string cpy = trimWs(str);
+		std::string_view cpy = trimWs(str);
 		if ('#' == cpy.front()) {
 			// we have a number
-			if (1 == cpy.size()) throw std::invalid_argument("\"" + str + "\" is invaled WIF symbol (should be '#' or #___)");
+			if (1 == cpy.size()) throw std::invalid_argument("\"" + std::string(str) + "\" is invaled WIF symbol (should be '#' or #___)");
 			cpy = cpy.substr(1);
-			for (char const& c : cpy) if (!isdigit(c)) throw std::invalid_argument("\"" + str + "\" is invaled WIF symbol (# must be followed by numbers)");
-			int i = atoi(cpy.c_str());
-			if (i > 255) throw std::invalid_argument("\"" + str + "\" is invaled WIF symbol (number following # must be [0,255])");
+			for (char const& c : cpy) if (!isdigit(c)) throw std::invalid_argument("\"" + std::string(str) + "\" is invaled WIF symbol (# must be followed by numbers)");
+			unsigned int i = 0;
+			if (std::errc() != std::from_chars(cpy.data(), cpy.data() + cpy.size(), i).ec || i > 255) throw std::invalid_argument("\"" + std::string(str) + "\" is invaled WIF symbol (number following # must be [0,255])");
 			c = static_cast<char>(i); // signed vs unsigned shouldn't matter much here since 
 			// just to be safe lets throw an error the first time we encounter something and look at the file by hand
-			if (i > 127) throw std::invalid_argument("\"" + str + "\" is invalid WIF symbol, extended ascii codes (greater than 127) are not currently supported, please contact the developers");
+			if (i > 127) throw std::invalid_argument("\"" + std::string(str) + "\" is invalid WIF symbol, extended ascii codes (greater than 127) are not currently supported, please contact the developers");
 		} else if (1 == cpy.size()) {
 			c = cpy.front();
 		} else if (3 == cpy.size() && '\'' == cpy.front() && '\'' == cpy.back()) {
 			c = cpy[1];
 		}
-		if (iscntrl(c)) throw std::invalid_argument("\"" + str + "\" is invaled WIF symbol");
+		if (iscntrl(c)) throw std::invalid_argument("\"" + std::string(str) + "\" is invaled WIF symbol");
 		return c;
 	}
 
-	void put_symb(std::ostream& os, Wif::Symbol const& symb) {
+	template <typename Os> void put_symb(Os& os, Wif::Symbol const& symb) {
 		if (isprint(symb)) os << '\'' << symb << '\'';
 		else os << '#' << int(symb);
 	}
 
-	typename Wif::VecInt  parse_vint(std::string const& str) {
+	//! check if a string is made up entirely of digits and commas
+	//! this is done 8 bytes at a time with SWAR (SIMD within a register) tricks so it works on any 64 bit platform
+	//! \param str string to check
+	//! \return true if every character is in [0-9,]
+	bool digitsAndCommas(std::string_view str) {
+		constexpr uint64_t ones = 0x0101010101010101ull;
+		constexpr uint64_t high = 0x8080808080808080ull;
+		size_t i = 0;
+		for (; i + 8 <= str.size(); i += 8) {
+			uint64_t x;
+			std::memcpy(&x, str.data() + i, 8);
+			const uint64_t above = x + 0x46 * ones; // high bit set for bytes > '9' (carries out of non ascii bytes only add false negatives)
+			const uint64_t below = (x | high) - 0x30 * ones; // high bit cleared for bytes < '0'
+			const uint64_t notDigit = (above | ~below | x) & high; // x catches non ascii bytes
+			const uint64_t y = x ^ (',' * ones); // bytes that are commas are now 0
+			const uint64_t comma = ~(((y & ~high) + ~high) | y | ~high); // exact zero byte test
+			if (notDigit & ~comma) return false;
+		}
+		for (; i < str.size(); i++) if (!isdigit(static_cast<unsigned char>(str[i])) && ',' != str[i]) return false;
+		return true;
+	}
+
+	//! parse a comma separated list of integers appending to a vector
+	//! \param str string to parse
+	//! \param v vector to append values to (e.g. a VecInt or a scratch std::pmr::vector)
+	template <typename V> void append_vint(std::string_view str, V& v) {
+		// fast path for bare digit lists (almost every THREADING / TREADLING / TIEUP / LIFTPLAN value)
+		// anything with fewer than 10 digits can't overflow so we can accumulate without checks
+		// anything unusual (whitespace, empty values, long numbers, garbage) falls back to the general parser for error handling
+		if (digitsAndCommas(str)) {
+			const size_t n0 = v.size();
+			Wif::Integer val = 0;
+			size_t digits = 0;
+			bool ok = true;
+			for (char const& c : str) {
+				if (',' == c) {
+					if (0 == digits || digits > 9) {ok = false; break;}
+					v.push_back(val);
+					val = digits = 0;
+				} else {
+					val = val * 10 + static_cast<Wif::Integer>(c - '0');
+					++digits;
+				}
+			}
+			if (ok && digits > 9) ok = false;
+			if (ok) {
+				if (digits > 0) v.push_back(val); // a trailing comma doesn't start a new value
+				return;
+			}
+			v.resize(n0); // undo partial results
+		}
+
+		// split on commas without copying, a trailing comma doesn't start a new value
+		while (!str.empty()) {
+			const size_t idx = str.find(',');
+			v.push_back(parse_int(str.substr(0, idx)));
+			if (std::string_view::npos == idx) break;
+			str.remove_prefix(idx + 1);
+		}
+	}
+
+	typename Wif::VecInt  parse_vint(std::string_view str) {
+		// these can end up in the wif (e.g. readSections keeps one per thread for threading / treadling) so make exactly one allocation of the right size
 		Wif::VecInt v;
-		std::string tok;
-		std::istringstream ss(str);
-		while (std::getline(ss, tok, ',')) v.push_back(parse_int(tok));
+		v.reserve(1 + std::count(str.cbegin(), str.cend(), ','));
+		append_vint(str, v);
 		return v;
 	}
 
-	void put_vint(std::ostream& os, Wif::VecInt const& v) {
-		if (!v.empty()) {
-			os << v.front();
-			for (size_t i = 1; i < v.size(); i++) os << ',' << v[i];
+	typename Wif::Color     parse_rgb (std::string_view str) {
+		// colors are always 3 values so the scratch list lives on the stack (anything longer is an error anyway)
+		std::array<std::byte, 64> stack;
+		std::pmr::monotonic_buffer_resource mr(stack.data(), stack.size());
+		std::pmr::vector<Wif::Integer> v(&mr);
+		append_vint(str, v);
+		if (3 != v.size()) throw std::invalid_argument("\"" + std::string(str) + "\" is invalid WIF color, expected 3 values but got " + std::to_string(v.size()));
+		return {v[0], v[1], v[2]};
+	}
+
+	template <typename Os> void put_vint(Os& os, Wif::Integer const* b, Wif::Integer const* e) {
+		if (b != e) {
+			os << *b;
+			for (++b; b != e; ++b) os << ',' << *b;
 		}
 	}
 
-	typename Wif::Range   parse_rng (std::string const& str) {
+	template <typename Os> void put_vint(Os& os, Wif::VecInt const& v) {
+		put_vint(os, v.data(), v.data() + v.size());
+	}
+
+	typename Wif::Range   parse_rng (std::string_view str) {
 		Wif::VecInt v = parse_vint(str);
-		if (2 != v.size()) throw std::invalid_argument("\"" + str + "\" is invalid WIF range, expected 2 values but got " + std::to_string(v.size()));
-		if (v.back() <= v.front()) throw std::invalid_argument("\"" + str + "\" is invalid WIF range, second value must be >= first");
+		if (2 != v.size()) throw std::invalid_argument("\"" + std::string(str) + "\" is invalid WIF range, expected 2 values but got " + std::to_string(v.size()));
+		if (v.back() <= v.front()) throw std::invalid_argument("\"" + std::string(str) + "\" is invalid WIF range, second value must be >= first");
 		return {v.front(), v.back()};
 	}
 
-	void put_rng(std::ostream& os, Wif::Range const& r) {
+	template <typename Os> void put_rng(Os& os, Wif::Range const& r) {
 		os << r.first << ',' << r.second;
 	}
 
-	Wif::Unit    parse_unit(std::string const& str) {
-		std::string cpy = trimWs(str);
-		for (char& c : cpy) c = tolower(c);
-		if      ("decipoints"  == cpy) return Wif::Unit::Decipoints ;
-		else if ("inches"      == cpy) return Wif::Unit::Inches     ;
-		else if ("centimeters" == cpy) return Wif::Unit::Centimeters;
-		throw std::invalid_argument("WIF units must be 'decipoints', 'inches', or 'centimeters' (got '" + str + "')");
+	Wif::Unit    parse_unit(std::string_view str) {
+		std::string_view cpy = trimWs(str);
+		if      (iequals("decipoints" , cpy)) return Wif::Unit::Decipoints ;
+		else if (iequals("inches"     , cpy)) return Wif::Unit::Inches     ;
+		else if (iequals("centimeters", cpy)) return Wif::Unit::Centimeters;
+		throw std::invalid_argument("WIF units must be 'decipoints', 'inches', or 'centimeters' (got '" + std::string(str) + "')");
 	}
 
-	void put_unit(std::ostream& os, Wif::Unit const& u) {
+	template <typename Os> void put_unit(Os& os, Wif::Unit const& u) {
 		switch (u) {
 			case Wif::Unit::None       : throw std::invalid_argument("units not set");
-			case Wif::Unit::Decipoints : os << "decipoints" ;
-			case Wif::Unit::Inches     : os << "inches"     ;
-			case Wif::Unit::Centimeters: os << "centimeters";
+			case Wif::Unit::Decipoints : os << "decipoints" ; break;
+			case Wif::Unit::Inches     : os << "inches"     ; break;
+			case Wif::Unit::Centimeters: os << "centimeters"; break;
 		}
 	}
 
 	template <typename T>
-	void parse_vecSect(std::pair<std::string, std::unordered_map<std::string, std::string> > const& sectMap, std::vector< std::pair< Wif::Integer, T > >& vec, std::function<T(std::string)> parse) {
+	void parse_vecSect(Section const& sect, std::vector< std::pair< Wif::Integer, T > >& vec, std::function<T(std::string_view)> parse) {
 		// parse value
-		for (std::pair<std::string, std::string> const& p : sectMap.second) {
+		vec.reserve(sect.keys.size());
+		for (std::pair<std::string_view, std::string_view> const& p : sect.keys) {
 			try {
 				vec.emplace_back(parse_int(p.first), parse(p.second));
 			} catch (std::exception& e) {
-				throw std::invalid_argument("WIF section [" + sectMap.first + "] \"" + p.first + "=" + p.second + "\" contains invalid value or integer key that couldn't be parsed: " + e.what());
+				throw std::invalid_argument("WIF section [" + toUpper(sect.name) + "] \"" + toLower(p.first) + "=" + std::string(p.second) + "\" contains invalid value or integer key that couldn't be parsed: " + e.what());
 			}
 		}
 
 		// sort and check for duplicate keys (different strings that parse to the same value)
 		std::sort(vec.begin(), vec.end());
 		for (size_t i = 1; i < vec.size(); i++) { // we could use std::unique but it isn't worth the trouble
-			if (vec[i-1].first == vec[i].first) throw std::invalid_argument("WIF section [" + sectMap.first + "] contains duplicate key \"" + std::to_string(vec[i].first) + "\"");
+			if (vec[i-1].first == vec[i].first) throw std::invalid_argument("WIF section [" + toUpper(sect.name) + "] contains duplicate key \"" + std::to_string(vec[i].first) + "\"");
 		}
 	};
-}
 
-void Wif::read(std::istream& is) {
-	clear();
-
-	// first define a lambda for error generation
-	size_t lineNum = 0; // current line in file
-	std::string line; // contents of current line in file
-	size_t sectLineNum = 0; // line that has the header of the current section we are in
-	std::string curSection; // name of current section
-	std::function<std::string()> lineDescr = [&]() {
-		// most users probably won't have a text editor with line numbers so it is nice to give a little more context
-		// the longest standard section name is only 21 characters "[WARP SYMBOL PALETTE]"
-		// we should guard against generating a super long error string in case of "[some unterminated line that goes on for a really long time"
-		constexpr size_t maxSnip = 64; // what is the longest snippet to pull from the file
-		std::ostringstream ss;
-		ss << "line number " << lineNum << ' ';
-		if (!curSection.empty()) {
-			ss << (lineNum - sectLineNum) << " lines into [";
-			// don't let our error message get so long it isn't useful
-			// this cutoff is arbitrtary but should be longer than ever needed in practice
-			if (curSection.size() < maxSnip) {
-				ss << curSection << "] ";
-			} else {
-				ss << curSection.substr(0, maxSnip) << "...] ";
-			}
-		}
-		if (!line.empty()) {
-			if (line.size() < maxSnip) {
-				ss << '"' << line << "\" ";
-			} else {
-				ss << "starting with \"" << line.substr(0, maxSnip) << "\"";
+	//! parse a list of lists section (e.g. [THREADING]) into flat rows, this gives the same values and errors as parse_vecSect with parse_vint
+	//! \param sect section to parse
+	//! \param rows location to write lists (sorted by key)
+	void parse_rowSect(Section const& sect, KeyedRows& rows) {
+		// size everything up front so each array is a single allocation
+		size_t values = 0;
+		for (std::pair<std::string_view, std::string_view> const& p : sect.keys) values += 1 + std::count(p.second.cbegin(), p.second.cend(), ',');
+		rows.keys.reserve(sect.keys.size());
+		rows.rows.offsets.reserve(sect.keys.size() + 1);
+		rows.rows.values.reserve(values);
+
+		// parse values
+		for (std::pair<std::string_view, std::string_view> const& p : sect.keys) {
+			try {
+				append_vint(p.second, rows.rows.values);
+				rows.keys.push_back(parse_int(p.first));
+				rows.rows.offsets.push_back(rows.rows.values.size());
+			} catch (std::exception& e) {
+				throw std::invalid_argument("WIF section [" + toUpper(sect.name) + "] \"" + toLower(p.first) + "=" + std::string(p.second) + "\" contains invalid value or integer key that couldn't be parsed: " + e.what());
 			}
 		}
-		return ss.str();
-	};
-
-	// loop over the file line by line
-	std::unordered_map< std::string, std::unordered_map<std::string, std::string> > section_key_value;
-	std::unordered_map< std::string, std::unordered_map<std::string, std::string> >::iterator sectionIter = section_key_value.end();
-	while (std::getline(is, line)) {
-		// making substring is somewhat wasteful and wrapping with an istringstream is overkill
-		// as a compromise I'll just keep track of the current index we've made it to in the line
-		size_t idx = 0;
 
-		// skip comment and blank lines
-		++lineNum;
-		bool obsKey = false;
-		if (line.empty()) continue;
-		else if (';' == line.front()) {
-			if (line.size() > 2 && '-' == line[1]) {
-				// this is an obsolete keyline
-				idx = 2;
-				obsKey = true;
-			} else {
-				continue; // just a regular comment
-			}
+		// sort and check for duplicate keys (different strings that parse to the same value)
+		rows.sortKeys();
+		for (size_t i = 1; i < rows.size(); i++) {
+			if (rows.keys[i-1] == rows.keys[i]) throw std::invalid_argument("WIF section [" + toUpper(sect.name) + "] contains duplicate key \"" + std::to_string(rows.keys[i]) + "\"");
 		}
+	}
+} }
 
-		// skip any leading whitespace
-		idx = line.find_first_not_of(" \t", idx); // skip leading white space (skipping ;- if needed)
-		if (std::string::npos == idx) continue; // all whitespace
-
-		// now we'd better have a key/value pair or a section header
-		if ('[' == line.front()) { // section header
-			const size_t idxClose = line.find(']', idx);
-			if (std::string::npos == idxClose) throw std::invalid_argument(lineDescr() + "has [ without matching ]");
-
-			// we found our closing ']' grab the section
-			curSection = line.substr(idx+1, idxClose - idx - 1);
-			if (curSection.empty()) throw std::invalid_argument(lineDescr() + "has empty section name");
-			for (char& c : curSection) c = toupper(c);
-			auto p = section_key_value.insert({curSection, std::unordered_map<std::string,std::string>()});
-			if (!p.second) throw std::invalid_argument(lineDescr() + "is second instance of section");
-			sectionIter = p.first;
-			sectLineNum = lineNum;
-			idx = idxClose + 1;
-		} else { // keyline
-			// make sure we have made it to our first section
-			const size_t idxEq = line.find('=', idx);
-			if (curSection.empty()) {
-				// some ini formats support global keys but wif isn't one of them
-				throw std::invalid_argument(lineDescr() + "isn't a [SECTION] or \";comment\" but appears before first section");
-			}
-
-			// make sure we have an equals sign
-			if (std::string::npos == idxEq) throw std::invalid_argument(lineDescr() += "isn't a comment and doesn't contain a '='");
+void Wif::read(std::istream& is) {
+	// pull everything into memory and tokenize from there so there is only a single parser
+	const std::string buf( (std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>() );
+	read(buf.data(), buf.size());
+}
 
-			// pull out key
-			std::string key = line.substr(idx, idxEq - idx);
-			if (key.empty()) throw std::invalid_argument(lineDescr() + "has empty key (no text before '=')");
-			for (char& c : key) c = tolower(c);
-			idx = idxEq + 1;
-			if (idx >= line.size()) throw std::invalid_argument(lineDescr() + "has empty value (no text after '='");
+void Wif::readFile(std::string const& path, unsigned threads, std::pmr::memory_resource* scratch) {
+	MappedFile file(path);
+	read(file.data(), file.size(), threads, scratch);
+}
 
-			// save the value
-			auto p = sectionIter->second.insert({key,line.substr(idx)});
-			if (!p.second) throw std::invalid_argument(lineDescr() + "is second instance of key in section"); // you're supposed to allow this and just accept the ambiguity but that seems risky
-			idx = std::string::npos;
-		}
+namespace corvus { namespace wif_io {
+	//! number of entries listed in the palette sections (checked against the tables once everything is read)
+	struct PaletteEntries {
+		Wif::Integer color      = 0;
+		Wif::Integer warpSymbol = 0;
+		Wif::Integer weftSymbol = 0;
+	};
 
-		// make sure there is no data after section header or key=value
-		if (std::string::npos != idx) {
-			if (idx < line.size()) idx = line.find_first_not_of(" \t", idx); // skip trailing whitespace
-			if (idx < line.size()) { // we have something other than whitespace after the ']'
-				if (';' == line[idx]) {
-					// that something is an inline comment, ignore it
+	//! decode a single section into a wif
+	//! \param w wif to write values into
+	//! \param sectMap section to decode
+	//! \param entries location to write palette sizes
+	//! \param lists location to write the tie up, threading, treadling, and lift plan (nullptr to write them to the wif's lists)
+	//! \note [CONTENTS] and private sections are ignored, they only matter for validating a complete file
+	void decodeSection(Wif& w, Section const& sectMap, PaletteEntries& entries, LayoutLists* lists = nullptr) {
+		// the section was identified when it was tokenized so this is a single jump
+		switch (sectMap.id) {
+			// skip private sections and the table of contents
+			case SectionId::Private : return;
+			case SectionId::Contents: return;
+
+			case SectionId::Wif: {
+				std::string_view const* vals[static_cast<size_t>(WifKey::Unknown)] = {}; // other keys are ignored
+				for (std::pair<std::string_view, std::string_view> const& p : sectMap.keys) {
+					const WifKey k = wifKeys.find(p.first);
+					if (WifKey::Unknown != k) vals[static_cast<size_t>(k)] = &p.second;
+				}
+				std::string_view const* val;
+				val = vals[static_cast<size_t>(WifKey::Version      )]; if (nullptr == val) throw std::invalid_argument("no [WIF] version key found"       );
+				w.version = atof(std::string(*val).c_str()); if (1.1 != w.version) throw std::invalid_argument("only WIF version 1.1 is supported");
+				val = vals[static_cast<size_t>(WifKey::Date         )]; if (nullptr == val) throw std::invalid_argument("no [WIF] date key found"          ); w.date       = *val;
+				val = vals[static_cast<size_t>(WifKey::Developers   )]; if (nullptr == val) throw std::invalid_argument("no [WIF] developers key found"    ); w.developers = *val;
+				val = vals[static_cast<size_t>(WifKey::SourceProgram)]; if (nullptr == val) throw std::invalid_argument("no [WIF] source program key found"); w.sourceProg = *val;
+				val = vals[static_cast<size_t>(WifKey::SourceVersion)]; if (nullptr != val)                                                                    w.sourceVers = *val;
+			} return;
+
+			case SectionId::ColorPalette:
+				entries.color = -1;
+				w.range.first = -1;
+				for (std::pair<std::string_view, std::string_view> const& p : sectMap.keys) {
+					switch (paletteKeys.find(p.first)) {
+						case PaletteKey::Entries: entries.color = parse_int(p.second); break;
+						case PaletteKey::Form   :                                      break; // deprecated, always RGB
+						case PaletteKey::Range  : w.range       = parse_rng(p.second); break;
+						case PaletteKey::Unknown: throw std::invalid_argument("unexpected key '" + toLower(p.first) + "' in [COLOR PALETTE]");
+					}
+				}
+				if (-1 == entries.color) throw std::invalid_argument("[COLOR PALETTE] missing 'entries' key");
+				if (-1 == w.range.first) throw std::invalid_argument("[COLOR PALETTE] missing 'range' key");
+				return;
+
+			case SectionId::WarpSymbolPalette:
+				if (1 != sectMap.keys.size() || PaletteKey::Entries != paletteKeys.find(sectMap.keys.front().first)) throw std::invalid_argument("[WARP SYMBOL PALETTE] must have exactly 1 key 'entries'");
+				entries.warpSymbol = parse_int(sectMap.keys.front().second);
+				return;
+
+			case SectionId::WeftSymbolPalette:
+				if (1 != sectMap.keys.size() || PaletteKey::Entries != paletteKeys.find(sectMap.keys.front().first)) throw std::invalid_argument("[WEFT SYMBOL PALETTE] must have exactly 1 key 'entries'");
+				entries.weftSymbol = parse_int(sectMap.keys.front().second);
+				return;
+
+			case SectionId::Text:
+				for (std::pair<std::string_view, std::string_view> const& p : sectMap.keys) {
+					switch (textKeys.find(p.first)) {
+						case TextKey::Title    : w.title     = parse_str(p.second); break;
+						case TextKey::Author   : w.author    = parse_str(p.second); break;
+						case TextKey::Address  : w.address   = parse_str(p.second); break;
+						case TextKey::Email    : w.email     = parse_str(p.second); break;
+						case TextKey::Telephone: w.telephone = parse_str(p.second); break;
+						case TextKey::Fax      : w.fax       = parse_str(p.second); break;
+						case TextKey::Unknown  : throw std::invalid_argument("unexpected key '" + toLower(p.first) + "' in [TEXT]");
+					}
+				}
+				return;
+
+			case SectionId::Weaving:
+				w.shafts = w.treadles = -1;
+				for (std::pair<std::string_view, std::string_view> const& p : sectMap.keys) {
+					switch (weavingKeys.find(p.first)) {
+						case WeavingKey::Shafts    : w.shafts     = parse_int (p.second); break;
+						case WeavingKey::Treadles  : w.treadles   = parse_int (p.second); break;
+						case WeavingKey::RisingShed: w.risingShed = parse_bool(p.second); break;
+						case WeavingKey::Unknown   : throw std::invalid_argument("unexpected key '" + toLower(p.first) + "' in [WEAVING]");
+					}
+				}
+				if (-1 == w.shafts  ) throw std::invalid_argument("[WEAVING] missing 'shafts' key");
+				if (-1 == w.treadles) throw std::invalid_argument("[WEAVING] missing 'treadles' key");
+				return;
+
+			case SectionId::Warp: {
+				Wif::VecInt color;
+				for (std::pair<std::string_view, std::string_view> const& p : sectMap.keys) {
+					switch (threadKeys.find(p.first)) {
+						case ThreadKey::Threads      : w.warpThreads       = parse_int (p.second); break;
+						case ThreadKey::Color        : color               = parse_vint(p.second); break;
+						case ThreadKey::Symbol       : w.warpSymbol        = parse_symb(p.second); break;
+						case ThreadKey::SymbolNumber : w.warpSymbolNum     = parse_int (p.second); break;
+						case ThreadKey::Units        : w.warpUnit          = parse_unit(p.second); break;
+						case ThreadKey::Spacing      : w.warpSpacing       = parse_real(p.second); break;
+						case ThreadKey::Thickness    : w.warpThickness     = parse_real(p.second); break;
+						case ThreadKey::SpacingZoom  : w.warpSpacingZoom   = parse_int (p.second); break;
+						case ThreadKey::ThicknessZoom: w.warpThicknessZoom = parse_int (p.second); break;
+						case ThreadKey::Unknown      : throw std::invalid_argument("unexpected key '" + toLower(p.first) + "' in [WARP]");
+					}
+				}
+				if (color.empty()) {
+					// no big deal
+				} else if (1 == color.size()) {
+					w.warpColorIndex = color.front(); // we got an index only
+				} else if (4 == color.size()) {
+					w.warpColorIndex = color.front(); // we got an index + RGB
+					w.warpColorValue = {color[1], color[2], color[3]};
 				} else {
-					// that something is stray data
-					throw std::invalid_argument(lineDescr() + "has trailing text that doesn't start with comment symbol ';'");
+					throw std::invalid_argument("[WARP] color must be either 1 or 4 values (got " + std::to_string(color.size()) + ")");
 				}
-			}
+			} return;
+
+			case SectionId::Weft: {
+				Wif::VecInt color;
+				for (std::pair<std::string_view, std::string_view> const& p : sectMap.keys) {
+					switch (threadKeys.find(p.first)) {
+						case ThreadKey::Threads      : w.weftThreads       = parse_int (p.second); break;
+						case ThreadKey::Color        : color               = parse_vint(p.second); break;
+						case ThreadKey::Symbol       : w.weftSymbol        = parse_symb(p.second); break;
+						case ThreadKey::SymbolNumber : w.weftSymbolNum     = parse_int (p.second); break;
+						case ThreadKey::Units        : w.weftUnit          = parse_unit(p.second); break;
+						case ThreadKey::Spacing      : w.weftSpacing       = parse_real(p.second); break;
+						case ThreadKey::Thickness    : w.weftThickness     = parse_real(p.second); break;
+						case ThreadKey::SpacingZoom  : w.weftSpacingZoom   = parse_int (p.second); break;
+						case ThreadKey::ThicknessZoom: w.weftThicknessZoom = parse_int (p.second); break;
+						case ThreadKey::Unknown      : throw std::invalid_argument("unexpected key '" + toLower(p.first) + "' in [WEFT]");
+					}
+				}
+				if (color.empty()) {
+					// no big deal
+				} else if (1 == color.size()) {
+					w.weftColorIndex = color.front(); // we got an index only
+				} else if (4 == color.size()) {
+					w.weftColorIndex = color.front(); // we got an index + RGB
+					w.weftColorValue = {color[1], color[2], color[3]};
+				} else {
+					throw std::invalid_argument("[WARP] color must be either 1 or 4 values (got " + std::to_string(color.size()) + ")");
+				}
+			} return;
+
+			case SectionId::Notes            : parse_vecSect<Wif::String >(sectMap, w.notes                , parse_str ); return;
+			case SectionId::TieUp            : if (lists) parse_rowSect(sectMap, lists->tieUp    ); else parse_vecSect<Wif::VecInt >(sectMap, w.tieUp    , parse_vint); return;
+			case SectionId::ColorTable       : parse_vecSect<Wif::Color  >(sectMap, w.colorTable           , parse_rgb ); return;
+			case SectionId::WarpSymbolTable  : parse_vecSect<Wif::Symbol >(sectMap, w.warpSymbolTable      , parse_symb); return;
+			case SectionId::WeftSymbolTable  : parse_vecSect<Wif::Symbol >(sectMap, w.weftSymbolTable      , parse_symb); return;
+			case SectionId::Threading        : if (lists) parse_rowSect(sectMap, lists->threading); else parse_vecSect<Wif::VecInt >(sectMap, w.threading, parse_vint); return;
+			case SectionId::WarpThickness    : parse_vecSect<Wif::Real   >(sectMap, w.warpThicknessList    , parse_real); return;
+			case SectionId::WarpThicknessZoom: parse_vecSect<Wif::Integer>(sectMap, w.warpThicknessZoomList, parse_int ); return;
+			case SectionId::WarpSpacing      : parse_vecSect<Wif::Real   >(sectMap, w.warpSpacingList      , parse_real); return;
+			case SectionId::WarpSpacingZoom  : parse_vecSect<Wif::Integer>(sectMap, w.warpSpacingZoomList  , parse_int ); return;
+			case SectionId::WarpColors       : parse_vecSect<Wif::Integer>(sectMap, w.warpColorList        , parse_int ); return;
+			case SectionId::WarpSymbols      : parse_vecSect<Wif::Integer>(sectMap, w.warpSymbolList       , parse_int ); return;
+			case SectionId::Treadling        : if (lists) parse_rowSect(sectMap, lists->treadling); else parse_vecSect<Wif::VecInt >(sectMap, w.treadling, parse_vint); return;
+			case SectionId::LiftPlan         : if (lists) parse_rowSect(sectMap, lists->liftPlan ); else parse_vecSect<Wif::VecInt >(sectMap, w.liftPlan , parse_vint); return;
+			case SectionId::WeftThickness    : parse_vecSect<Wif::Real   >(sectMap, w.weftThicknessList    , parse_real); return;
+			case SectionId::WeftThicknessZoom: parse_vecSect<Wif::Integer>(sectMap, w.weftThicknessZoomList, parse_int ); return;
+			case SectionId::WeftSpacing      : parse_vecSect<Wif::Real   >(sectMap, w.weftSpacingList      , parse_real); return;
+			case SectionId::WeftSpacingZoom  : parse_vecSect<Wif::Integer>(sectMap, w.weftSpacingZoomList  , parse_int ); return;
+			case SectionId::WeftColors       : parse_vecSect<Wif::Integer>(sectMap, w.weftColorList        , parse_int ); return;
+			case SectionId::WeftSymbols      : parse_vecSect<Wif::Integer>(sectMap, w.weftSymbolList       , parse_int ); return;
+
+			// reserved / suspended sections aren't decoded (read rejects them before getting here)
+			case SectionId::Translations:
+			case SectionId::BitmapImage :
+			case SectionId::BitmapFile  :
+			case SectionId::Unknown     : break;
 		}
+		throw std::invalid_argument("WIF contains unknown section type [" + toUpper(sectMap.name) + "] that isn't marked as PRIVATE");
 	}
+} }
+
+void Wif::read(char const* buf, size_t len, unsigned threads, std::pmr::memory_resource* scratch) {
+	clear();
+
+	// everything that only lives as long as the parse (the key lists, table of contents, duplicate detection, ...) comes from a single arena
+	// nothing is freed until the arena is released at the end, so there is no per key bookkeeping and nothing left behind to fragment the heap
+	// only this thread allocates from the arena (the section decoders just read the key lists)
+	std::pmr::monotonic_buffer_resource arena(std::max<size_t>(len / 4, 4096), nullptr == scratch ? std::pmr::get_default_resource() : scratch);
+#ifdef CORVUS_STATS
+	detail::CountingResource counted(&arena);
+	std::pmr::memory_resource* const mr = &counted;
+#else
+	std::pmr::memory_resource* const mr = &arena;
+#endif
+
+	// we need everything so collect all the sections (as slices of the text) and decode once we've seen them all
+	CORVUS_STATS_PHASES(timer, Tokenize);
+	std::pmr::vector<wif_io::Section> sections(mr);
+	WifParser parser(mr);
+	parser.onOther({
+		[&](std::string_view name) {sections.push_back(wif_io::Section{name, wif_io::sectionId(name), decltype(wif_io::Section::keys)(mr)});},
+		[&](std::string_view key, std::string_view value) {sections.back().keys.emplace_back(key, value);},
+		nullptr
+	});
+	parser.parse(buf, len);
+	CORVUS_STATS_COUNT(Lines   , parser.lines());
+	CORVUS_STATS_COUNT(Sections, sections.size());
+	CORVUS_STATS_NEXT(timer, DecodeSections);
 
 	// now that we have all our key values we can do the parsing, start with the WIF section
-	std::string str;
-	sectionIter = section_key_value.find("WIF");
-	if (section_key_value.end() == sectionIter) throw std::invalid_argument("no [WIF] section found");
-	std::unordered_map<std::string, std::string>::iterator keyIter;
-	keyIter = sectionIter->second.find("version"       ); if (sectionIter->second.end() == keyIter) throw std::invalid_argument("no [WIF] version key found"          ); str        = keyIter->second;
-	version = atof(str.c_str()); if (1.1 != version) throw std::invalid_argument("only WIF version 1.1 is supported");
-	keyIter = sectionIter->second.find("date"          ); if (sectionIter->second.end() == keyIter) throw std::invalid_argument("no [WIF] date key found"             ); date       = keyIter->second;
-	keyIter = sectionIter->second.find("developers"    ); if (sectionIter->second.end() == keyIter) throw std::invalid_argument("no [WIF] developers key found"       ); developers = keyIter->second;
-	keyIter = sectionIter->second.find("source program"); if (sectionIter->second.end() == keyIter) throw std::invalid_argument("no [WIF] source program key found"   ); sourceProg = keyIter->second;
-	keyIter = sectionIter->second.find("source version");                                                                                                               sourceVers = keyIter->second;
+	wif_io::PaletteEntries entries;
+	wif_io::Section const* sect = wif_io::findSection(sections, wif_io::SectionId::Wif);
+	if (nullptr == sect) throw std::invalid_argument("no [WIF] section found");
+	wif_io::decodeSection(*this, *sect, entries);
 
 	// now the contents section
-	sectionIter = section_key_value.find("CONTENTS");
-	if (section_key_value.end() == sectionIter) throw std::invalid_argument("no [CONTENTS] section found");
-	std::unordered_map<std::string, bool> contents;
-	for (keyIter = sectionIter->second.begin(); keyIter != sectionIter->second.end(); ++keyIter) {
-		// we converted all of our key names to lower case but section names to upper case
-		// fix that now quick
-		std::string sectName = keyIter->first;
-		for (char& c : sectName) c = toupper(c);
-		contents[sectName] = wif_io::parse_bool(keyIter->second);
-	}
+	sect = wif_io::findSection(sections, wif_io::SectionId::Contents);
+	if (nullptr == sect) throw std::invalid_argument("no [CONTENTS] section found");
+	wif_io::Contents contents(mr);
+	for (std::pair<std::string_view, std::string_view> const& p : sect->keys) contents.list(p.first, wif_io::parse_bool(p.second));
 
 	// check for forbidden sections
-	if (contents.end() != contents.find("BITMAP IMAGE")) throw std::invalid_argument("WIF contents lists [BITMAP IMAGE] which isn't implemented in the 1.1 standard");
-	if (contents.end() != contents.find("BITMAP FILE" )) throw std::invalid_argument("WIF contents lists [BITMAP FILE] which isn't implemented in the 1.1 standard");
-	if (section_key_value.end() != section_key_value.find("TRANSLATIONS")) throw std::invalid_argument("WIF has [TRANSLATIONS] which is suspended in the 1.1 standard");
+	if (contents.known[static_cast<size_t>(wif_io::SectionId::BitmapImage)]) throw std::invalid_argument("WIF contents lists [BITMAP IMAGE] which isn't implemented in the 1.1 standard");
+	if (contents.known[static_cast<size_t>(wif_io::SectionId::BitmapFile )]) throw std::invalid_argument("WIF contents lists [BITMAP FILE] which isn't implemented in the 1.1 standard");
+	if (nullptr != wif_io::findSection(sections, wif_io::SectionId::Translations)) throw std::invalid_argument("WIF has [TRANSLATIONS] which is suspended in the 1.1 standard");
 
 	// finally loop over the actual data
 	// we can do this in any order we want since we have everything pulled in
@@ -579,150 +1104,130 @@ void Wif::read(std::istream& is) {
 	// 3. TEXT, WEAVING, WARP, WEFT
 	// 4. everything else
 	// the logic for splitting 3 and 4 is to give the user an opportunity to down select which values to read
-	// we've already read the whole thing so it doesn't matter
+	// readSections covers that case, here we've already read the whole thing so it doesn't matter
 	// theorhetically reading the remaining ___ PALETTE type sections first would help us speed things up
 	// we could call vector::reserve to pre allocate space
 	// in practice it doesn't matter on modern computers given how small wif files are
-	// I'm just going to loop in arbitrary order since ranged based for loops make the code more readable
-
-	Integer colorEntries = 0, warpSymbolEntries = 0, wefSymbolEntries = 0;
-	for (std::pair<std::string, std::unordered_map<std::string, std::string> > const& sectMap : section_key_value) {
+	// I'm just going to loop in file order since ranged based for loops make the code more readable
+	// each section is checked against the table of contents in file order and decoding stops at the first problem
+	std::pmr::vector<wif_io::Section const*> todo(mr);
+	std::exception_ptr contentsError;
+	for (wif_io::Section const& sectMap : sections) {
 		// check that our section is listed in the table of contents
-		std::string const& sectName = sectMap.first;
-		if ("WIF" == sectName || "CONTENTS" == sectName) continue; // we already took care of these
-		std::unordered_map<std::string, bool>::iterator iter = contents.find(sectName);
-		if (contents.end() == iter) throw std::invalid_argument("WIF contains section " + sectName + " that is not listed in contents");
-		else if (!iter->second) throw std::invalid_argument("WIF contains section " + sectName + " that is explicitly excluded in contents");
-		iter->second = false; // mark this section as visited
-
-		// skip private sections
-		if (sectName.size() > 8 && "PRIVATE " == sectName.substr(0, 8) ) continue;
-
-		// now we'd better have a section that is listed in the standard
-		if ("COLOR PALETTE"       == sectName) {
-			colorEntries = -1;
-			range.first = -1;
-			for (std::pair<std::string, std::string> const& p : sectMap.second) {
-				if      ("entries" == p.first) colorEntries = wif_io::parse_int(p.second);
-				else if ("form"    == p.first) {} // deprecated, always RGB
-				else if ("range"   == p.first) range        = wif_io::parse_rng(p.second);
-				else throw std::invalid_argument("unexpected key '" + p.first + "' in [COLOR PALETTE]");
-			}
-			if (-1 == colorEntries) throw std::invalid_argument("[COLOR PALETTE] missing 'entries' key");
-			if (-1 == range.first ) throw std::invalid_argument("[COLOR PALETTE] missing 'range' key");
-		} else if ("WARP SYMBOL PALETTE" == sectName) {
-			if (1 != sectMap.second.size() || "entries" != sectMap.second.begin()->first) throw std::invalid_argument("[WARP SYMBOL PALETTE] must have exactly 1 key 'entries'");
-			warpSymbolEntries = wif_io::parse_int(sectMap.second.begin()->second);
-		} else if ("WEFT SYMBOL PALETTE" == sectName) {
-			if (1 != sectMap.second.size() || "entries" != sectMap.second.begin()->first) throw std::invalid_argument("[WEFT SYMBOL PALETTE] must have exactly 1 key 'entries'");
-			wefSymbolEntries = wif_io::parse_int(sectMap.second.begin()->second);
-		} else if ("TEXT"                == sectName) {
-			for (std::pair<std::string, std::string> const& p : sectMap.second) {
-				if      ("title"     == p.first) title     = wif_io::parse_str(p.second);
-				else if ("author"    == p.first) author    = wif_io::parse_str(p.second);
-				else if ("address"   == p.first) address   = wif_io::parse_str(p.second);
-				else if ("email"     == p.first) email     = wif_io::parse_str(p.second);
-				else if ("telephone" == p.first) telephone = wif_io::parse_str(p.second);
-				else if ("fax"       == p.first) fax       = wif_io::parse_str(p.second);
-				else throw std::invalid_argument("unexpected key '" + p.first + "' in [TEXT]");
-			}
-		} else if ("WEAVING"             == sectName) {
-			shafts = treadles = -1;
-			for (std::pair<std::string, std::string> const& p : sectMap.second) {
-				if      ("shafts"      == p.first) shafts     = wif_io::parse_int (p.second);
-				else if ("treadles"    == p.first) treadles   = wif_io::parse_int (p.second);
-				else if ("rising shed" == p.first) risingShed = wif_io::parse_bool(p.second);
-				else throw std::invalid_argument("unexpected key '" + p.first + "' in [WEAVING]");
-			}
-			if (-1 == shafts  ) throw std::invalid_argument("[WEAVING] missing 'shafts' key");
-			if (-1 == treadles) throw std::invalid_argument("[WEAVING] missing 'treadles' key");
-		} else if ("WARP"                == sectName) {
-			VecInt color;
-			for (std::pair<std::string, std::string> const& p : sectMap.second) {
-				if      ("threads"        == p.first) warpThreads       = wif_io::parse_int (p.second);
-				else if ("color"          == p.first) color             = wif_io::parse_vint(p.second);
-				else if ("symbol"         == p.first) warpSymbol        = wif_io::parse_symb(p.second);
-				else if ("symbol number"  == p.first) warpSymbolNum     = wif_io::parse_int (p.second);
-				else if ("units"          == p.first) warpUnit          = wif_io::parse_unit(p.second);
-				else if ("spacing"        == p.first) warpSpacing       = wif_io::parse_real(p.second);
-				else if ("thickness"      == p.first) warpThickness     = wif_io::parse_real(p.second);
-				else if ("spacing zoom"   == p.first) warpSpacingZoom   = wif_io::parse_int (p.second);
-				else if ("thickness zoom" == p.first) warpThicknessZoom = wif_io::parse_int (p.second);
-				else throw std::invalid_argument("unexpected key '" + p.first + "' in [WARP]");
-			}
-			if (color.empty()) {
-				// no big deal
-			} else if (1 == color.size()) {
-				warpColorIndex = color.front(); // we got an index only
-			} else if (4 == color.size()) {
-				warpColorIndex = color.front(); // we got an index + RGB
-				warpColorValue = {color[1], color[2], color[3]};
-			} else {
-				throw std::invalid_argument("[WARP] color must be either 1 or 4 values (got " + std::to_string(color.size()) + ")");
-			}
-		} else if ("WEFT"                == sectName) {
-			VecInt color;
-			for (std::pair<std::string, std::string> const& p : sectMap.second) {
-				if      ("threads"        == p.first) weftThreads       = wif_io::parse_int (p.second);
-				else if ("color"          == p.first) color             = wif_io::parse_vint(p.second);
-				else if ("symbol"         == p.first) weftSymbol        = wif_io::parse_symb(p.second);
-				else if ("symbol number"  == p.first) weftSymbolNum     = wif_io::parse_int (p.second);
-				else if ("units"          == p.first) weftUnit          = wif_io::parse_unit(p.second);
-				else if ("spacing"        == p.first) weftSpacing       = wif_io::parse_real(p.second);
-				else if ("thickness"      == p.first) weftThickness     = wif_io::parse_real(p.second);
-				else if ("spacing zoom"   == p.first) weftSpacingZoom   = wif_io::parse_int (p.second);
-				else if ("thickness zoom" == p.first) weftThicknessZoom = wif_io::parse_int (p.second);
-				else throw std::invalid_argument("unexpected key '" + p.first + "' in [WEFT]");
-			}
-			if (color.empty()) {
-				// no big deal
-			} else if (1 == color.size()) {
-				weftColorIndex = color.front(); // we got an index only
-			} else if (4 == color.size()) {
-				weftColorIndex = color.front(); // we got an index + RGB
-				weftColorValue = {color[1], color[2], color[3]};
-			} else {
-				throw std::invalid_argument("[WARP] color must be either 1 or 4 values (got " + std::to_string(color.size()) + ")");
-			}
-		} else if ("NOTES"               == sectName) { wif_io::parse_vecSect<String >(sectMap, notes                , wif_io::parse_str );
-		} else if ("TIEUP"               == sectName) { wif_io::parse_vecSect<VecInt >(sectMap, tieUp                , wif_io::parse_vint);
-		} else if ("COLOR TABLE"         == sectName) { wif_io::parse_vecSect<Color  >(sectMap, colorTable           , wif_io::parse_rgb );
-		} else if ("WARP SYMBOL TABLE"   == sectName) { wif_io::parse_vecSect<Symbol >(sectMap, warpSymbolTable      , wif_io::parse_symb);
-		} else if ("WEFT SYMBOL TABLE"   == sectName) { wif_io::parse_vecSect<Symbol >(sectMap, weftSymbolTable      , wif_io::parse_symb);
-		} else if ("THREADING"           == sectName) { wif_io::parse_vecSect<VecInt >(sectMap, threading            , wif_io::parse_vint);
-		} else if ("WARP THICKNESS"      == sectName) { wif_io::parse_vecSect<Real   >(sectMap, warpThicknessList    , wif_io::parse_real);
-		} else if ("WARP THICKNESS ZOOM" == sectName) { wif_io::parse_vecSect<Integer>(sectMap, warpThicknessZoomList, wif_io::parse_int );
-		} else if ("WARP SPACING"        == sectName) { wif_io::parse_vecSect<Real   >(sectMap, warpSpacingList      , wif_io::parse_real);
-		} else if ("WARP SPACING ZOOM"   == sectName) { wif_io::parse_vecSect<Integer>(sectMap, warpSpacingZoomList  , wif_io::parse_int );
-		} else if ("WARP COLORS"         == sectName) { wif_io::parse_vecSect<Integer>(sectMap, warpColorList        , wif_io::parse_int );
-		} else if ("WARP SYMBOLS"        == sectName) { wif_io::parse_vecSect<Integer>(sectMap, warpSymbolList       , wif_io::parse_int );
-		} else if ("TREADLING"           == sectName) { wif_io::parse_vecSect<VecInt >(sectMap, treadling            , wif_io::parse_vint);
-		} else if ("LIFTPLAN"            == sectName) { wif_io::parse_vecSect<VecInt >(sectMap, liftPlan             , wif_io::parse_vint);
-		} else if ("WEFT THICKNESS"      == sectName) { wif_io::parse_vecSect<Real   >(sectMap, weftThicknessList    , wif_io::parse_real);
-		} else if ("WEFT THICKNESS ZOOM" == sectName) { wif_io::parse_vecSect<Integer>(sectMap, weftThicknessZoomList, wif_io::parse_int );
-		} else if ("WEFT SPACING"        == sectName) { wif_io::parse_vecSect<Real   >(sectMap, weftSpacingList      , wif_io::parse_real);
-		} else if ("WEFT SPACING ZOOM"   == sectName) { wif_io::parse_vecSect<Integer>(sectMap, weftSpacingZoomList  , wif_io::parse_int );
-		} else if ("WEFT COLORS"         == sectName) { wif_io::parse_vecSect<Integer>(sectMap, weftColorList        , wif_io::parse_int );
-		} else if ("WEFT SYMBOLS"        == sectName) { wif_io::parse_vecSect<Integer>(sectMap, weftSymbolList       , wif_io::parse_int );
-		} else {
-			throw std::invalid_argument("WIF contains unknown section type [" + sectName + "] that isn't marked as PRIVATE");
+		std::string_view const& sectName = sectMap.name;
+		if (wif_io::SectionId::Wif == sectMap.id || wif_io::SectionId::Contents == sectMap.id) continue; // we already took care of these
+		bool* const listed = contents.find(sectMap);
+		try {
+			if (nullptr == listed) throw std::invalid_argument("WIF contains section " + wif_io::toUpper(sectName) + " that is not listed in contents");
+			else if (!*listed) throw std::invalid_argument("WIF contains section " + wif_io::toUpper(sectName) + " that is explicitly excluded in contents");
+		} catch (...) {
+			contentsError = std::current_exception();
+			break;
 		}
+		*listed = false; // mark this section as visited
+		todo.push_back(&sectMap);
 	}
 
+	// every section writes to different members (and duplicate sections were rejected above) so they can be decoded at the same time
+	// the lists of lists go straight into flat rows instead of a vector per thread, sanityCheck moves them into the dense arrays
+	wif_io::LayoutLists lists;
+	// small files aren't worth starting threads for (here or in sanityCheck) and the biggest sections are handed out first since they set the wall time
+	size_t keys = 0;
+	for (wif_io::Section const* sect : todo) keys += sect->keys.size();
+	CORVUS_STATS_COUNT(Keys, keys);
+	if (keys < 4096) threads = 1;
+	std::pmr::vector<size_t> order(todo.size(), mr);
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {return todo[a]->keys.size() > todo[b]->keys.size();});
+	rethrowFirst(runTasks(todo.size(), threads, [&](size_t i) {return order[i];}, [&](size_t i) {wif_io::decodeSection(*this, *todo[i], entries, &lists);}));
+	if (contentsError) std::rethrow_exception(contentsError);
+
 	// check that tables sizes match what was specified
-	if (colorEntries      != colorTable     .size()) throw std::invalid_argument("[COLOR PALETTE] Entries="       + std::to_string(colorEntries) + " doesn't match number of [COLOR TABLE] keys:"       + std::to_string(colorTable     .size()));
-	if (warpSymbolEntries != warpSymbolTable.size()) throw std::invalid_argument("[WARP SYMBOL PALETTE] Entries=" + std::to_string(colorEntries) + " doesn't match number of [WARP SYMBOL TABLE] keys:" + std::to_string(warpSymbolTable.size()));
-	if (wefSymbolEntries  != warpSymbolTable.size()) throw std::invalid_argument("[WEFT SYMBOL PALETTE] Entries=" + std::to_string(colorEntries) + " doesn't match number of [WEFT SYMBOL TABLE] keys:" + std::to_string(warpSymbolTable.size()));
+	if (entries.color      != colorTable     .size()) throw std::invalid_argument("[COLOR PALETTE] Entries="       + std::to_string(entries.color) + " doesn't match number of [COLOR TABLE] keys:"       + std::to_string(colorTable     .size()));
+	if (entries.warpSymbol != warpSymbolTable.size()) throw std::invalid_argument("[WARP SYMBOL PALETTE] Entries=" + std::to_string(entries.warpSymbol) + " doesn't match number of [WARP SYMBOL TABLE] keys:" + std::to_string(warpSymbolTable.size()));
+	if (entries.weftSymbol != weftSymbolTable.size()) throw std::invalid_argument("[WEFT SYMBOL PALETTE] Entries=" + std::to_string(entries.weftSymbol) + " doesn't match number of [WEFT SYMBOL TABLE] keys:" + std::to_string(weftSymbolTable.size()));
 
 	// now that we have parsed everything look for any sections we didn't find
-	for (std::pair<std::string, bool> const& p : contents) {
-		if (p.second) throw std::invalid_argument("WIF [CONTENTS] lists " + p.first + " but it wasn't found");
+	for (size_t i = 0; i < contents.known.size(); i++) {
+		if (contents.known[i].value_or(false)) throw std::invalid_argument("WIF [CONTENTS] lists " + std::string(wif_io::sectionNames.name(static_cast<wif_io::SectionId>(i))) + " but it wasn't found");
+	}
+	for (std::pair<std::string_view const, bool> const& p : contents.other) {
+		if (p.second) throw std::invalid_argument("WIF [CONTENTS] lists " + wif_io::toUpper(p.first) + " but it wasn't found");
 	}
+	CORVUS_STATS_STOP(timer);
+#ifdef CORVUS_STATS
+	CORVUS_STATS_COUNT(ScratchAllocations, counted.allocations);
+#endif
 
-	sanityCheck();
+	sanityCheck(threads, lists);
 }
 
-void Wif::write(std::ostream& os) const {
+void Wif::readSections(char const* buf, size_t len, std::vector<std::string> const& names) {
+	clear();
+
+	// decode each requested section as soon as it ends, everything else is skipped without being tokenized
+	wif_io::Section sect;
+	wif_io::PaletteEntries entries; // there is no guarantee we have the tables to check against
+	WifParser parser;
+	for (std::string const& n : names) {
+		parser.on(n, {
+			[&](std::string_view name) {sect.name = name; sect.id = wif_io::sectionId(name); sect.keys.clear();},
+			[&](std::string_view key, std::string_view value) {sect.keys.emplace_back(key, value);},
+			[&](std::string_view) {wif_io::decodeSection(*this, sect, entries);}
+		});
+	}
+	parser.parse(buf, len);
+}
+
+void Wif::readFile(std::string const& path, std::vector<std::string> const& names) {
+	MappedFile file(path);
+	readSections(file.data(), file.size(), names);
+}
+
+//! write a list of lists section from whichever form it is currently stored in
+//! \param os ostream (or TextBuffer) to write to
+//! \param name section name
+//! \param list sparse 1 indexed list (used if it isn't empty, e.g. before sanityCheck)
+//! \param rows dense 0 indexed rows (used once the wif has been checked)
+template <typename Os> void putRows(Os& os, char const* name, std::vector< std::pair<Wif::Integer, Wif::VecInt> > const& list, Csr<Wif::Integer> const& rows) {
+	if (list.empty() && 0 == rows.size()) return;
+	os << '[' << name << "]\n";
+	if (!list.empty()) {
+		for (auto const& p : list) {os << p.first << '='; wif_io::put_vint(os, p.second); os << '\n';}
+	} else {
+		for (size_t k = 0; k < rows.size(); k++) {os << k + 1 << '='; wif_io::put_vint(os, rows.begin(k), rows.end(k)); os << '\n';}
+	}
+	os << '\n';
+}
+
+//! write a shaft mask section from whichever form it is currently stored in
+//! \param os ostream (or TextBuffer) to write to
+//! \param name section name
+//! \param list sparse 1 indexed list (used if it isn't empty, e.g. before sanityCheck)
+//! \param masks packed shaft masks (used once the wif has been checked)
+//! \param words 64 bit words per mask
+template <typename Os> void putMasks(Os& os, char const* name, std::vector< std::pair<Wif::Integer, Wif::VecInt> > const& list, std::vector<uint64_t> const& masks, size_t words) {
+	if (list.empty() && masks.empty()) return;
+	os << '[' << name << "]\n";
+	if (!list.empty()) {
+		for (auto const& p : list) {os << p.first << '='; wif_io::put_vint(os, p.second); os << '\n';}
+	} else {
+		for (size_t k = 0; k < masks.size() / words; k++) {
+			os << k + 1 << '=';
+			bool first = true;
+			bits::forEach(masks.data() + k * words, words, [&](size_t s) {
+				if (!first) os << ',';
+				os << s + 1;
+				first = false;
+			});
+			if (first) os << '0'; // nothing set
+			os << '\n';
+		}
+	}
+	os << '\n';
+}
+
+template <typename Os> void Wif::writeText(Os& os) const {
 	// start by printing the wif section
 	os << "[WIF]\n";
 	os << "Version="        << version    << '\n'; // TODO handle decimal (not clear why they didn't go with major/minor)
@@ -733,8 +1238,12 @@ void Wif::write(std::ostream& os) const {
 	os << '\n';
 
 	// determine which sections we have (that arent trivial to check)
-	const bool haveText = !title.empty() || !author.empty() || !address.empty() || !email.empty() || !telephone.empty();
+	const bool haveText = !title.empty() || !author.empty() || !address.empty() || !email.empty() || !telephone.empty() || !fax.empty();
 	const bool haveWeaving = shafts > 0 || treadles > 0 || !risingShed;
+	const bool haveTieUp     = !tieUp    .empty() || !tieUpMasks.empty();
+	const bool haveThreading = !threading.empty() || 0 != warp.shafts  .size();
+	const bool haveTreadling = !treadling.empty() || 0 != weft.treadles.size();
+	const bool haveLiftPlan  = !liftPlan .empty() || !liftMasks .empty();
 
 	// now the contents
 	os << "[CONTENTS]\n";
@@ -746,19 +1255,19 @@ void Wif::write(std::ostream& os) const {
 	if ( 0 != warpThreads             ) os << "WARP=true\n";
 	if ( 0 != weftThreads             ) os << "WEFT=true\n";
 	if (!notes                .empty()) os << "NOTES=true\n";
-	if (!tieUp                .empty()) os << "TIEUP=true\n";
+	if ( haveTieUp                    ) os << "TIEUP=true\n";
 	if (!colorTable           .empty()) os << "COLOR TABLE=true\n";
 	if (!warpSymbolTable      .empty()) os << "WARP SYMBOL TABLE=true\n";
 	if (!weftSymbolTable      .empty()) os << "WEFT SYMBOL TABLE=true\n";
-	if (!threading            .empty()) os << "THREADING=true\n";
+	if ( haveThreading                ) os << "THREADING=true\n";
 	if (!warpThicknessList    .empty()) os << "WARP THICKNESS=true\n";
 	if (!warpThicknessZoomList.empty()) os << "WARP THICKNESS ZOOM=true\n";
 	if (!warpSpacingList      .empty()) os << "WARP SPACING=true\n";
 	if (!warpSpacingZoomList  .empty()) os << "WARP SPACING ZOOM=true\n";
 	if (!warpColorList        .empty()) os << "WARP COLORS=true\n";
 	if (!warpSymbolList       .empty()) os << "WARP SYMBOLS=true\n";
-	if (!treadling            .empty()) os << "TREADLING=true\n";
-	if (!liftPlan             .empty()) os << "LIFTPLAN=true\n";
+	if ( haveTreadling                ) os << "TREADLING=true\n";
+	if ( haveLiftPlan                 ) os << "LIFTPLAN=true\n";
 	if (!weftThicknessList    .empty()) os << "WEFT THICKNESS=true\n";
 	if (!weftThicknessZoomList.empty()) os << "WEFT THICKNESS ZOOM=true\n";
 	if (!weftSpacingList      .empty()) os << "WEFT SPACING=true\n";
@@ -768,13 +1277,19 @@ void Wif::write(std::ostream& os) const {
 	os << '\n';
 
 	// sections that are more than just a list
+	// the palette sizes are implied by the tables but still need to be written for the file to be read back
+	if (!colorTable     .empty()) {os << "[COLOR PALETTE]\n"      ; os << "Entries=" << colorTable     .size() << '\n'; os << "Range="; wif_io::put_rng(os, range); os << "\n\n";}
+	if (!warpSymbolTable.empty()) {os << "[WARP SYMBOL PALETTE]\n"; os << "Entries=" << warpSymbolTable.size() << "\n\n";}
+	if (!weftSymbolTable.empty()) {os << "[WEFT SYMBOL PALETTE]\n"; os << "Entries=" << weftSymbolTable.size() << "\n\n";}
+
 	if (haveText) {
 		os << "[TEXT]\n";
-		if(!title    .empty()) os << "Title="     << title     << '\n';
-		if(!author   .empty()) os << "Author="    << author    << '\n';
-		if(!address  .empty()) os << "Address="   << address   << '\n';
-		if(!email    .empty()) os << "Email="     << email     << '\n';
-		if(!telephone.empty()) os << "Telephone=" << telephone << '\n';
+		if(!title    .empty()) {os << "Title="    ; wif_io::put_str(os, title    ); os << '\n';}
+		if(!author   .empty()) {os << "Author="   ; wif_io::put_str(os, author   ); os << '\n';}
+		if(!address  .empty()) {os << "Address="  ; wif_io::put_str(os, address  ); os << '\n';}
+		if(!email    .empty()) {os << "Email="    ; wif_io::put_str(os, email    ); os << '\n';}
+		if(!telephone.empty()) {os << "Telephone="; wif_io::put_str(os, telephone); os << '\n';}
+		if(!fax      .empty()) {os << "Fax="      ; wif_io::put_str(os, fax      ); os << '\n';}
 		os << '\n';
 	}
 
@@ -793,8 +1308,8 @@ void Wif::write(std::ostream& os) const {
 		if (0 != warpSymbol       ) {os << "Symbol="        ; wif_io::put_symb(os, warpSymbol); os << '\n';}
 		if (0 != warpSymbolNum    ) {os << "Symbol Number="  << warpSymbolNum                      << '\n';}
 		                             os << "Units="         ; wif_io::put_unit(os, warpUnit  ); os << '\n';
-		if (!isnan(warpSpacing  ) ) {os << "Spacing="        << warpSpacing                        << '\n';}
-		if (!isnan(warpThickness) ) {os << "Thickness="      << warpThickness                      << '\n';}
+		if (!std::isnan(warpSpacing  ) ) {os << "Spacing="        << warpSpacing                        << '\n';}
+		if (!std::isnan(warpThickness) ) {os << "Thickness="      << warpThickness                      << '\n';}
 		if (1 != warpSpacingZoom  ) {os << "Spacing Zoom="   << warpSpacingZoom                    << '\n';}
 		if (1 != warpThicknessZoom) {os << "Thickness Zoom=" << warpThicknessZoom                  << '\n';}
 		os << '\n';
@@ -807,27 +1322,27 @@ void Wif::write(std::ostream& os) const {
 		if (0 != weftSymbol       ) {os << "Symbol="        ; wif_io::put_symb(os, weftSymbol); os << '\n';}
 		if (0 != weftSymbolNum    ) {os << "Symbol Number="  << weftSymbolNum                      << '\n';}
 		                             os << "Units="         ; wif_io::put_unit(os, weftUnit  ); os << '\n';
-		if (!isnan(weftSpacing  ) ) {os << "Spacing="        << weftSpacing                        << '\n';}
-		if (!isnan(weftThickness) ) {os << "Thickness="      << weftThickness                      << '\n';}
+		if (!std::isnan(weftSpacing  ) ) {os << "Spacing="        << weftSpacing                        << '\n';}
+		if (!std::isnan(weftThickness) ) {os << "Thickness="      << weftThickness                      << '\n';}
 		if (1 != weftSpacingZoom  ) {os << "Spacing Zoom="   << weftSpacingZoom                    << '\n';}
 		if (1 != weftThicknessZoom) {os << "Thickness Zoom=" << weftThicknessZoom                  << '\n';}
 		os << '\n';
 	}
 
-	if (!notes                .empty()) {os << "[NOTES]\n"              ; for (auto const& p : notes                ) {os << p.first << '='                    << p.second      << '\n';} os << '\n';}
-	if (!tieUp                .empty()) {os << "[TIEUP]\n"              ; for (auto const& p : tieUp                ) {os << p.first << '='; wif_io::put_vint(os, p.second); os << '\n';} os << '\n';}
+	if (!notes                .empty()) {os << "[NOTES]\n"              ; for (auto const& p : notes                ) {os << p.first << '='; wif_io::put_str (os, p.second); os << '\n';} os << '\n';}
+	putMasks(os, "TIEUP"   , tieUp    , tieUpMasks   , shaftWords());
 	if (!colorTable           .empty()) {os << "[COLOR TABLE]\n"        ; for (auto const& p : colorTable           ) {os << p.first << '='; wif_io::put_rgb (os, p.second); os << '\n';} os << '\n';}
 	if (!warpSymbolTable      .empty()) {os << "[WARP SYMBOL TABLE]\n"  ; for (auto const& p : warpSymbolTable      ) {os << p.first << '='; wif_io::put_symb(os, p.second); os << '\n';} os << '\n';}
 	if (!weftSymbolTable      .empty()) {os << "[WEFT SYMBOL TABLE]\n"  ; for (auto const& p : weftSymbolTable      ) {os << p.first << '='; wif_io::put_symb(os, p.second); os << '\n';} os << '\n';}
-	if (!threading            .empty()) {os << "[THREADING]\n"          ; for (auto const& p : threading            ) {os << p.first << '='; wif_io::put_vint(os, p.second); os << '\n';} os << '\n';}
+	putRows (os, "THREADING", threading, warp.shafts  );
 	if (!warpThicknessList    .empty()) {os << "[WARP THICKNESS]\n"     ; for (auto const& p : warpThicknessList    ) {os << p.first << '='                    << p.second      << '\n';} os << '\n';}
 	if (!warpThicknessZoomList.empty()) {os << "[WARP THICKNESS ZOOM]\n"; for (auto const& p : warpThicknessZoomList) {os << p.first << '='                    << p.second      << '\n';} os << '\n';}
 	if (!warpSpacingList      .empty()) {os << "[WARP SPACING]\n"       ; for (auto const& p : warpSpacingList      ) {os << p.first << '='                    << p.second      << '\n';} os << '\n';}
 	if (!warpSpacingZoomList  .empty()) {os << "[WARP SPACING ZOOM]\n"  ; for (auto const& p : warpSpacingZoomList  ) {os << p.first << '='                    << p.second      << '\n';} os << '\n';}
 	if (!warpColorList        .empty()) {os << "[WARP COLORS]\n"        ; for (auto const& p : warpColorList        ) {os << p.first << '='                    << p.second      << '\n';} os << '\n';}
 	if (!warpSymbolList       .empty()) {os << "[WARP SYMBOLS]\n"       ; for (auto const& p : warpSymbolList       ) {os << p.first << '='                    << p.second      << '\n';} os << '\n';}
-	if (!treadling            .empty()) {os << "[TREADLING]\n"          ; for (auto const& p : treadling            ) {os << p.first << '='; wif_io::put_vint(os, p.second); os << '\n';} os << '\n';}
-	if (!liftPlan             .empty()) {os << "[LIFTPLAN]\n"           ; for (auto const& p : liftPlan             ) {os << p.first << '='; wif_io::put_vint(os, p.second); os << '\n';} os << '\n';}
+	putRows (os, "TREADLING", treadling, weft.treadles);
+	putMasks(os, "LIFTPLAN", liftPlan , liftMasks    , shaftWords());
 	if (!weftThicknessList    .empty()) {os << "[WEFT THICKNESS]\n"     ; for (auto const& p : weftThicknessList    ) {os << p.first << '='                    << p.second      << '\n';} os << '\n';}
 	if (!weftThicknessZoomList.empty()) {os << "[WEFT THICKNESS ZOOM]\n"; for (auto const& p : weftThicknessZoomList) {os << p.first << '='                    << p.second      << '\n';} os << '\n';}
 	if (!weftSpacingList      .empty()) {os << "[WEFT SPACING]\n"       ; for (auto const& p : weftSpacingList      ) {os << p.first << '='                    << p.second      << '\n';} os << '\n';}
@@ -836,3 +1351,74 @@ void Wif::write(std::ostream& os) const {
 	if (!weftSymbolList       .empty()) {os << "[WEFT SYMBOLS]\n"       ; for (auto const& p : weftSymbolList       ) {os << p.first << '='                    << p.second      << '\n';} os << '\n';}
 
 }
+
+//! formats text into a byte buffer with to_chars (no locale or sentry overhead per value)
+//! this has just enough of the ostream interface for writeText and produces identical text
+class TextBuffer {
+	public:
+		static const size_t BlockSize = 1 << 20; //!< size to flush at
+
+		//! start formatting
+		//! \param b buffer to append to
+		//! \param f function to hand full blocks to (the buffer is cleared after each call), empty to keep everything in the buffer
+		TextBuffer(std::string& b, std::function<void(std::string const&)> f = nullptr) : buf(b), flush(std::move(f)) {
+			if (flush) buf.reserve(BlockSize + 64);
+		}
+
+		TextBuffer& operator<<(char c) {buf.push_back(c); return check();}
+		TextBuffer& operator<<(char const* str) {buf.append(str); return check();}
+		TextBuffer& operator<<(std::string const& str) {buf.append(str); return check();}
+
+		//! format an integer
+		template <typename T> typename std::enable_if<std::is_integral<T>::value, TextBuffer&>::type operator<<(T v) {
+			char tmp[24];
+			buf.append(tmp, std::to_chars(tmp, tmp + sizeof(tmp), v).ptr);
+			return check();
+		}
+
+		//! format a real the same way as an ostream with the default flags (i.e. %g)
+		TextBuffer& operator<<(double v) {
+			char tmp[32];
+			buf.append(tmp, std::to_chars(tmp, tmp + sizeof(tmp), v, std::chars_format::general, 6).ptr);
+			return check();
+		}
+
+		//! hand anything left over to the flush function
+		void finish() {
+			if (flush && !buf.empty()) flush(buf);
+			if (flush) buf.clear();
+		}
+
+	private:
+		//! flush if a full block is ready
+		TextBuffer& check() {
+			if (buf.size() >= BlockSize && flush) {
+				flush(buf);
+				buf.clear();
+			}
+			return *this;
+		}
+
+		std::string&                             buf  ; //!< text formatted so far
+		std::function<void(std::string const&)> flush; //!< where to send full blocks
+};
+
+void Wif::write(std::ostream& os) const {
+	writeText(os);
+}
+
+void Wif::write(std::string& buf) const {
+	TextBuffer text(buf);
+	writeText(text);
+}
+
+void Wif::writeFile(std::string const& path) const {
+	std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+	if (!file) throw std::invalid_argument("couldn't open " + path + " for writing");
+	std::string block;
+	bool good = true;
+	TextBuffer text(block, [&](std::string const& b) {good = good && b.size() == std::fwrite(b.data(), 1, b.size(), file.get());});
+	writeText(text);
+	text.finish();
+	if (!good || 0 != std::fclose(file.release())) throw std::invalid_argument("couldn't write " + path);
+}
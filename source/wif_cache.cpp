@@ -0,0 +1,429 @@
+#include "wif.h"
+#include "mapped_file.h"
+
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include <type_traits>
+#include <random>
+#include <atomic>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+using namespace corvus;
+
+// binary cache layout (native byte order, every array starts on an 8 byte boundary)
+// header (40 bytes):
+//   char[8]  magic "WIFCACHE"
+//   uint32_t format version
+//   uint32_t byte order marker 0x01020304 (a cache from a machine with the other byte order is just stale)
+//   uint64_t hash of the wif text the cache was built from
+//   uint64_t payload size in bytes
+//   uint64_t hash of the payload (catches truncated / corrupt files)
+// payload: every field of the wif in declaration order (see transfer)
+//   scalars are stored raw, strings as a uint64_t length followed by the bytes
+//   n=value lists are a uint64_t count then flat arrays of keys and values
+//   lists of integer lists are stored as keys, n+1 uint64_t offsets, and the concatenated values (compressed sparse row)
+//   the dense thread arrays are stored as a uint64_t count then the values (compressed rows as offsets then values)
+// version history:
+//   1: initial layout
+//   2: dense thread arrays (the lists of lists are empty once checked)
+//   3: tie up / lift plan as packed shaft masks
+
+namespace {
+	constexpr char     cacheMagic[8] = {'W', 'I', 'F', 'C', 'A', 'C', 'H', 'E'};
+	constexpr uint32_t cacheVersion  = 3;
+	constexpr uint32_t cacheOrder    = 0x01020304;
+	constexpr size_t   headerSize    = 40;
+
+	//! pick a temporary file name next to a path that no other writer will use
+	//! \param path file that will be replaced
+	//! \return path with a process id, random, and per process counter suffix
+	std::string tempPath(std::string const& path) {
+		static std::atomic<uint32_t> counter(0); // other threads of this process
+#ifdef _WIN32
+		const unsigned long pid = GetCurrentProcessId();
+#else
+		const unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+		char suffix[64];
+		std::snprintf(suffix, sizeof(suffix), ".%lu.%08x%08x.tmp", pid, static_cast<unsigned>(std::random_device()()), static_cast<unsigned>(counter++));
+		return path + suffix;
+	}
+
+	//! move a file over another one in a single step (readers see either the old or the new file)
+	//! \param from file to move
+	//! \param to file to replace
+	//! \return true on success
+	bool replaceFile(std::string const& from, std::string const& to) {
+#ifdef _WIN32
+		return 0 != MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING); // std::rename fails if the destination exists on windows
+#else
+		return 0 == std::rename(from.c_str(), to.c_str()); // rename replaces atomically on posix
+#endif
+	}
+
+	//! hash a block of bytes 8 at a time
+	//! \param buf bytes to hash
+	//! \param len number of bytes
+	//! \return 64 bit hash
+	uint64_t hashBytes(char const* buf, size_t len) {
+		uint64_t h = 0x9e3779b97f4a7c15ull ^ len;
+		for (size_t i = 0; i < len; i += 8) {
+			uint64_t x = 0;
+			std::memcpy(&x, buf + i, std::min<size_t>(8, len - i));
+
+			// mix in each word (splitmix64 finalizer)
+			x += 0x9e3779b97f4a7c15ull * (i / 8 + 1);
+			x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+			x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+			h = (h ^ x ^ (x >> 31)) * 0x100000001b3ull;
+		}
+		return h;
+	}
+
+	//! serialize cache fields into a buffer
+	class CacheWriter {
+		public:
+			//! get the serialized bytes
+			std::string const& bytes() const {return buf;}
+
+			//! write a trivially copyable value
+			template <typename T> void value(T const& v) {
+				static_assert(std::is_trivially_copyable<T>::value, "only raw values can be written directly");
+				buf.append(reinterpret_cast<char const*>(&v), sizeof(T));
+			}
+
+			//! write a range (pair isn't trivially copyable)
+			void value(Wif::Range const& r) {
+				value(r.first );
+				value(r.second);
+			}
+
+			//! write a string
+			void string(std::string const& s) {
+				value(uint64_t(s.size()));
+				buf.append(s);
+			}
+
+			//! write an n=value list of raw values
+			template <typename T> void list(std::vector< std::pair<Wif::Integer, T> > const& v) {
+				keys(v);
+				align();
+				for (auto const& p : v) value(p.second);
+			}
+
+			//! write an n=value list of strings
+			void list(std::vector< std::pair<Wif::Integer, Wif::String> > const& v) {
+				keys(v);
+				for (auto const& p : v) string(p.second);
+			}
+
+			//! write an n=value list of integer lists as compressed sparse rows
+			void list(std::vector< std::pair<Wif::Integer, Wif::VecInt> > const& v) {
+				keys(v);
+				align();
+				uint64_t offset = 0;
+				value(offset);
+				for (auto const& p : v) value(offset += p.second.size());
+				align();
+				for (auto const& p : v) buf.append(reinterpret_cast<char const*>(p.second.data()), p.second.size() * sizeof(Wif::Integer));
+			}
+
+			//! write a dense array of raw values
+			template <typename T> void array(std::vector<T> const& v) {
+				static_assert(std::is_trivially_copyable<T>::value, "only raw values can be written directly");
+				align();
+				value(uint64_t(v.size()));
+				buf.append(reinterpret_cast<char const*>(v.data()), v.size() * sizeof(T));
+			}
+
+			//! write compressed rows
+			void rows(Csr<Wif::Integer> const& c) {
+				array(c.offsets);
+				array(c.values );
+			}
+
+		private:
+			//! pad to an 8 byte boundary
+			void align() {buf.resize((buf.size() + 7) / 8 * 8, 0);}
+
+			//! write the count and keys of a list
+			template <typename T> void keys(std::vector< std::pair<Wif::Integer, T> > const& v) {
+				align();
+				value(uint64_t(v.size()));
+				for (auto const& p : v) value(p.first);
+			}
+
+			std::string buf;
+	};
+
+	//! deserialize cache fields from a buffer, throws invalid_argument if the buffer is too short or inconsistent
+	class CacheReader {
+		public:
+			//! start reading a buffer
+			CacheReader(char const* b, size_t n) : buf(b), len(n), pos(0) {}
+
+			//! check if the whole buffer has been read
+			bool done() const {return pos == len;}
+
+			//! read a trivially copyable value
+			template <typename T> void value(T& v) {
+				static_assert(std::is_trivially_copyable<T>::value, "only raw values can be read directly");
+				std::memcpy(&v, take(sizeof(T)), sizeof(T));
+			}
+
+			//! read a range (pair isn't trivially copyable)
+			void value(Wif::Range& r) {
+				value(r.first );
+				value(r.second);
+			}
+
+			//! read a string
+			void string(std::string& s) {
+				uint64_t n;
+				value(n);
+				s.assign(take(n), n);
+			}
+
+			//! read an n=value list of raw values
+			template <typename T> void list(std::vector< std::pair<Wif::Integer, T> >& v) {
+				keys(v);
+				align();
+				for (auto& p : v) value(p.second);
+			}
+
+			//! read an n=value list of strings
+			void list(std::vector< std::pair<Wif::Integer, Wif::String> >& v) {
+				keys(v);
+				for (auto& p : v) string(p.second);
+			}
+
+			//! read an n=value list of integer lists from compressed sparse rows
+			void list(std::vector< std::pair<Wif::Integer, Wif::VecInt> >& v) {
+				keys(v);
+				align();
+				std::vector<uint64_t> offsets(v.size() + 1);
+				std::memcpy(offsets.data(), take(offsets.size() * sizeof(uint64_t)), offsets.size() * sizeof(uint64_t));
+				align();
+				if (0 != offsets.front()) throw std::invalid_argument("bad cache offsets");
+				for (size_t i = 0; i < v.size(); i++) if (offsets[i+1] < offsets[i]) throw std::invalid_argument("bad cache offsets");
+				Wif::Integer const* values = reinterpret_cast<Wif::Integer const*>(take(offsets.back() * sizeof(Wif::Integer)));
+				for (size_t i = 0; i < v.size(); i++) {
+					Wif::VecInt& vi = v[i].second;
+					vi.resize(offsets[i+1] - offsets[i]);
+					std::memcpy(vi.data(), values + offsets[i], vi.size() * sizeof(Wif::Integer));
+				}
+			}
+
+			//! read a dense array of raw values
+			template <typename T> void array(std::vector<T>& v) {
+				static_assert(std::is_trivially_copyable<T>::value, "only raw values can be read directly");
+				align();
+				uint64_t n;
+				value(n);
+				if (n > (len - pos) / sizeof(T)) throw std::invalid_argument("cache truncated");
+				v.resize(n);
+				std::memcpy(v.data(), take(n * sizeof(T)), n * sizeof(T));
+			}
+
+			//! read compressed rows
+			void rows(Csr<Wif::Integer>& c) {
+				array(c.offsets);
+				array(c.values );
+				if (c.offsets.empty() || 0 != c.offsets.front() || c.values.size() != c.offsets.back()) throw std::invalid_argument("bad cache offsets");
+				for (size_t i = 1; i < c.offsets.size(); i++) if (c.offsets[i] < c.offsets[i-1]) throw std::invalid_argument("bad cache offsets");
+			}
+
+		private:
+			//! skip to an 8 byte boundary
+			void align() {take((8 - pos % 8) % 8);}
+
+			//! read the count and keys of a list
+			template <typename T> void keys(std::vector< std::pair<Wif::Integer, T> >& v) {
+				align();
+				uint64_t n;
+				value(n);
+				if (n > (len - pos) / sizeof(Wif::Integer)) throw std::invalid_argument("cache truncated");
+				v.resize(n);
+				for (auto& p : v) value(p.first);
+			}
+
+			//! consume bytes
+			//! \param n number of bytes to consume
+			//! \return pointer to the first byte
+			char const* take(uint64_t n) {
+				if (n > len - pos) throw std::invalid_argument("cache truncated");
+				char const* p = buf + pos;
+				pos += n;
+				return p;
+			}
+
+			char const* buf; //!< start of payload
+			size_t      len; //!< payload size
+			size_t      pos; //!< read position
+	};
+
+	//! read or write the dense arrays for one direction
+	//! \param io CacheWriter or CacheReader
+	//! \param t arrays to read from / write to
+	template <typename Io, typename T> void threads(Io& io, T& t) {
+		io.rows (t.shafts       );
+		io.rows (t.treadles     );
+		io.array(t.colors       );
+		io.array(t.symbols      );
+		io.array(t.thickness    );
+		io.array(t.thicknessZoom);
+		io.array(t.spacing      );
+		io.array(t.spacingZoom  );
+	}
+
+	//! read or write every field of a wif in a fixed order
+	//! \param io CacheWriter or CacheReader
+	//! \param w wif to read from / write to
+	template <typename Io, typename W> void transfer(Io& io, W& w) {
+		io.value (w.version          );
+		io.string(w.date             );
+		io.string(w.developers       );
+		io.string(w.sourceProg       );
+		io.string(w.sourceVers       );
+		io.value (w.range            );
+		io.string(w.title            );
+		io.string(w.author           );
+		io.string(w.address          );
+		io.string(w.email            );
+		io.string(w.telephone        );
+		io.string(w.fax              );
+		io.value (w.shafts           );
+		io.value (w.treadles         );
+		io.value (w.risingShed       );
+
+		io.value (w.warpThreads      );
+		io.value (w.warpColorIndex   );
+		io.value (w.warpColorValue   );
+		io.value (w.warpSymbol       );
+		io.value (w.warpSymbolNum    );
+		io.value (w.warpUnit         );
+		io.value (w.warpSpacing      );
+		io.value (w.warpThickness    );
+		io.value (w.warpSpacingZoom  );
+		io.value (w.warpThicknessZoom);
+
+		io.value (w.weftThreads      );
+		io.value (w.weftColorIndex   );
+		io.value (w.weftColorValue   );
+		io.value (w.weftSymbol       );
+		io.value (w.weftSymbolNum    );
+		io.value (w.weftUnit         );
+		io.value (w.weftSpacing      );
+		io.value (w.weftThickness    );
+		io.value (w.weftSpacingZoom  );
+		io.value (w.weftThicknessZoom);
+
+		io.list(w.notes                );
+		io.list(w.tieUp                );
+		io.list(w.colorTable           );
+		io.list(w.warpSymbolTable      );
+		io.list(w.weftSymbolTable      );
+		io.list(w.threading            );
+		io.list(w.warpThicknessList    );
+		io.list(w.warpThicknessZoomList);
+		io.list(w.warpSpacingList      );
+		io.list(w.warpSpacingZoomList  );
+		io.list(w.warpColorList        );
+		io.list(w.warpSymbolList       );
+		io.list(w.treadling            );
+		io.list(w.liftPlan             );
+		io.list(w.weftThicknessList    );
+		io.list(w.weftThicknessZoomList);
+		io.list(w.weftSpacingList      );
+		io.list(w.weftSpacingZoomList  );
+		io.list(w.weftColorList        );
+		io.list(w.weftSymbolList       );
+
+		threads(io, w.warp);
+		threads(io, w.weft);
+		io.array(w.tieUpMasks);
+		io.array(w.liftMasks );
+	}
+}
+
+uint64_t Wif::hashSource(char const* buf, size_t len) {
+	return hashBytes(buf, len);
+}
+
+void Wif::writeCache(std::ostream& os, uint64_t sourceHash) const {
+	CacheWriter payload;
+	transfer(payload, *this);
+	std::string const& bytes = payload.bytes();
+
+	CacheWriter header;
+	for (char const& c : cacheMagic) header.value(c);
+	header.value(cacheVersion);
+	header.value(cacheOrder);
+	header.value(sourceHash);
+	header.value(uint64_t(bytes.size()));
+	header.value(hashBytes(bytes.data(), bytes.size()));
+	os.write(header.bytes().data(), header.bytes().size());
+	os.write(bytes.data(), bytes.size());
+}
+
+bool Wif::readCache(char const* buf, size_t len, uint64_t sourceHash) {
+	clear();
+
+	// anything wrong with the header just means the cache needs to be rebuilt
+	if (len < headerSize || 0 != std::memcmp(buf, cacheMagic, sizeof(cacheMagic))) return false;
+	uint32_t version, order;
+	uint64_t srcHash, size, hash;
+	std::memcpy(&version, buf +  8, sizeof(version));
+	std::memcpy(&order  , buf + 12, sizeof(order  ));
+	std::memcpy(&srcHash, buf + 16, sizeof(srcHash));
+	std::memcpy(&size   , buf + 24, sizeof(size   ));
+	std::memcpy(&hash   , buf + 32, sizeof(hash   ));
+	if (cacheVersion != version || cacheOrder != order || sourceHash != srcHash) return false;
+	if (len - headerSize != size || hashBytes(buf + headerSize, size) != hash) return false;
+
+	// the payload is from a validated wif so it only needs to be copied out
+	try {
+		CacheReader reader(buf + headerSize, size);
+		transfer(reader, *this);
+		if (!reader.done()) throw std::invalid_argument("cache has trailing bytes");
+	} catch (std::invalid_argument const&) {
+		clear();
+		return false;
+	}
+	return true;
+}
+
+void Wif::loadCached(std::string const& path) {
+	// the text has to be read to check for changes anyway, hashing it is still much cheaper than parsing it
+	MappedFile text(path);
+	const uint64_t h = hashSource(text.data(), text.size());
+	const std::string cachePath = path + ".cache";
+	try {
+		MappedFile cache(cachePath);
+		if (readCache(cache.data(), cache.size(), h)) return;
+	} catch (std::invalid_argument const&) {
+		// no cache yet
+	}
+
+	// parse the text then (re)write the cache
+	// this is best effort, e.g. a read only directory just means the text is parsed every time
+	// the cache is written to a temporary file and moved into place so other readers never see a partial cache
+	// every writer gets its own temporary file so processes filling the same cache at once can't mix their output (the last move wins)
+	read(text.data(), text.size());
+	const std::string tmpPath = tempPath(cachePath);
+	std::ofstream os(tmpPath, std::ios::out | std::ios::binary);
+	if (!os) return;
+	writeCache(os, h);
+	os.close();
+	if (!os || !replaceFile(tmpPath, cachePath)) std::remove(tmpPath.c_str());
+}
@@ -0,0 +1,155 @@
+#include "wif_parser.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+
+using namespace corvus;
+
+void WifParser::on(std::string_view section, Handler h) {
+	for (std::pair<std::string, Handler>& p : handlers) {
+		if (iequals(p.first, section)) {
+			p.second = h; // replace existing handler
+			return;
+		}
+	}
+	handlers.emplace_back(std::string(section), h);
+}
+
+WifParser::Handler const* WifParser::find(std::string_view name) const {
+	// there are only ever a handful of handlers so a linear search is fine
+	for (std::pair<std::string, Handler> const& p : handlers) if (iequals(p.first, name)) return &p.second;
+	if (other.begin || other.key || other.end) return &other;
+	return nullptr;
+}
+
+std::string WifParser::lineDescr() const {
+	// most users probably won't have a text editor with line numbers so it is nice to give a little more context
+	// the longest standard section name is only 21 characters "[WARP SYMBOL PALETTE]"
+	// we should guard against generating a super long error string in case of "[some unterminated line that goes on for a really long time"
+	constexpr size_t maxSnip = 64; // what is the longest snippet to pull from the file
+	std::ostringstream ss;
+	ss << "line number " << lineNum << ' ';
+	if (!curSection.empty()) {
+		ss << (lineNum - sectLineNum) << " lines into [";
+		// don't let our error message get so long it isn't useful
+		// this cutoff is arbitrtary but should be longer than ever needed in practice
+		std::string sect(curSection.substr(0, maxSnip));
+		for (char& c : sect) c = toupper(c);
+		if (curSection.size() < maxSnip) {
+			ss << sect << "] ";
+		} else {
+			ss << sect << "...] ";
+		}
+	}
+	if (!line.empty()) {
+		if (line.size() < maxSnip) {
+			ss << '"' << line << "\" ";
+		} else {
+			ss << "starting with \"" << line.substr(0, maxSnip) << "\"";
+		}
+	}
+	return ss.str();
+}
+
+void WifParser::parse(char const* buf, size_t len) {
+	lineNum = sectLineNum = 0;
+	line = curSection = std::string_view();
+	sectionNames.clear();
+	keyNames.clear();
+
+	// loop over the text line by line
+	Handler const* handler = nullptr; // handler for the current section
+	bool skip = false; // are we skipping the current section
+	char const* const end = buf + len;
+	char const* pos = buf;
+	while (pos < end) {
+		// split off the next line (same semantics as std::getline)
+		char const* nl = static_cast<char const*>(memchr(pos, '\n', end - pos));
+		char const* lineEnd = nullptr == nl ? end : nl;
+		line = std::string_view(pos, lineEnd - pos);
+		pos = nullptr == nl ? end : nl + 1;
+		++lineNum;
+
+		// when skipping a section the only thing we care about is the start of the next one
+		if (skip && (line.empty() || '[' != line.front())) continue;
+
+		// keep track of the current index we've made it to in the line
+		size_t idx = 0;
+
+		// skip comment and blank lines
+		if (line.empty()) continue;
+		else if (';' == line.front()) {
+			if (line.size() > 2 && '-' == line[1]) {
+				// this is an obsolete keyline
+				idx = 2;
+			} else {
+				continue; // just a regular comment
+			}
+		}
+
+		// skip any leading whitespace
+		idx = line.find_first_not_of(" \t", idx); // skip leading white space (skipping ;- if needed)
+		if (std::string_view::npos == idx) continue; // all whitespace
+
+		// now we'd better have a key/value pair or a section header
+		if ('[' == line.front()) { // section header
+			const size_t idxClose = line.find(']', idx);
+			if (std::string_view::npos == idxClose) throw std::invalid_argument(lineDescr() + "has [ without matching ]");
+
+			// we're done with the previous section
+			if (nullptr != handler && handler->end) handler->end(curSection);
+
+			// we found our closing ']' grab the section
+			curSection = line.substr(idx+1, idxClose - idx - 1);
+			if (curSection.empty()) throw std::invalid_argument(lineDescr() + "has empty section name");
+			if (!sectionNames.insert(curSection).second) throw std::invalid_argument(lineDescr() + "is second instance of section");
+			keyNames.clear();
+			sectLineNum = lineNum;
+			idx = idxClose + 1;
+
+			// figure out if anyone cares about this section
+			handler = find(curSection);
+			skip = nullptr == handler;
+			if (!skip && handler->begin) handler->begin(curSection);
+		} else { // keyline
+			// make sure we have made it to our first section
+			const size_t idxEq = line.find('=', idx);
+			if (curSection.empty()) {
+				// some ini formats support global keys but wif isn't one of them
+				throw std::invalid_argument(lineDescr() + "isn't a [SECTION] or \";comment\" but appears before first section");
+			}
+
+			// make sure we have an equals sign
+			if (std::string_view::npos == idxEq) throw std::invalid_argument(lineDescr() += "isn't a comment and doesn't contain a '='");
+
+			// pull out key
+			std::string_view key = line.substr(idx, idxEq - idx);
+			if (key.empty()) throw std::invalid_argument(lineDescr() + "has empty key (no text before '=')");
+			idx = idxEq + 1;
+			if (idx >= line.size()) throw std::invalid_argument(lineDescr() + "has empty value (no text after '='");
+
+			// pass along the value
+			if (!keyNames.insert(key).second) throw std::invalid_argument(lineDescr() + "is second instance of key in section"); // you're supposed to allow this and just accept the ambiguity but that seems risky
+			if (handler->key) handler->key(key, line.substr(idx));
+			idx = std::string_view::npos;
+		}
+
+		// make sure there is no data after section header or key=value
+		if (std::string_view::npos != idx) {
+			if (idx < line.size()) idx = line.find_first_not_of(" \t", idx); // skip trailing whitespace
+			if (idx < line.size()) { // we have something other than whitespace after the ']'
+				if (';' == line[idx]) {
+					// that something is an inline comment, ignore it
+				} else {
+					// that something is stray data
+					throw std::invalid_argument(lineDescr() + "has trailing text that doesn't start with comment symbol ';'");
+				}
+			}
+		}
+	}
+
+	// close out the last section
+	line = std::string_view();
+	if (nullptr != handler && handler->end) handler->end(curSection);
+}
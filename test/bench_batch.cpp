@@ -0,0 +1,76 @@
+#include "batch.h"
+#include "parallel.h"
+#include "random_draft.h"
+
+#include <iostream>
+#include <random>
+#include <chrono>
+
+using namespace corvus;
+
+int main() {
+	// a catalog of blocks with a wide spread of sizes so the work is uneven
+	std::mt19937_64 gen(0);
+	std::uniform_int_distribution<uint_fast32_t> size(32, 768), shafts(4, 32), sheds(4, 48);
+	std::vector<Cell> catalog;
+	for (size_t k = 0; k < 2000; k++) catalog.push_back(randomDraft(size(gen), size(gen), shafts(gen), sheds(gen), gen));
+
+	// the tie up search stops on a timer so use straight tie ups to get repeatable results to compare
+	LayoutOptions opts;
+	opts.timeLimit = 0;
+	opts.treadles = 64;
+
+	// one at a time on this thread for reference
+	auto t0 = std::chrono::steady_clock::now();
+	struct Serial {
+		uint_fast32_t                             shafts = 0;
+		bool                                      failed = false;
+		std::vector<uint_fast32_t>                threading;
+		std::vector< std::vector<uint_fast32_t> > tieup, treadling;
+	};
+	std::vector<Serial> serial(catalog.size());
+	for (size_t k = 0; k < catalog.size(); k++) {
+		Serial& r = serial[k];
+		try {
+			r.shafts = catalog[k].layout(r.threading, r.tieup, r.treadling, opts);
+		} catch (std::exception const&) {
+			r.failed = true;
+		}
+	}
+	const double msSerial = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+	std::cout << catalog.size() << " blocks, one at a time: " << msSerial << " ms\n";
+
+	bool ok = true;
+	for (unsigned threads = 1; threads <= threadCount(); threads *= 2) {
+		opts.threads = threads;
+		size_t calls = 0;
+		BatchCallbacks cb;
+		cb.progress = [&calls](size_t, size_t) {++calls;};
+		auto t1 = std::chrono::steady_clock::now();
+		const std::vector<LayoutResult> batch = layoutBatch(catalog, opts, cb);
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t1).count();
+
+		bool match = calls == catalog.size();
+		for (size_t k = 0; k < catalog.size(); k++) {
+			Serial const& a = serial[k];
+			LayoutResult const& b = batch[k];
+			std::vector< std::vector<uint_fast32_t> > tieup, treadling;
+			b.tieup    .toLists(tieup    );
+			b.treadling.toLists(treadling);
+			match &= b.done && a.failed == bool(b.error) && a.shafts == b.shafts && a.threading == b.threading && a.tieup == tieup && a.treadling == treadling;
+		}
+		std::cout << "batch with " << threads << " threads: " << ms << " ms (" << msSerial / ms << "x)" << (match ? "" : " OUTPUT MISMATCH") << '\n';
+		ok &= match;
+	}
+
+	// cancel part way through
+	size_t seen = 0;
+	BatchCallbacks cb;
+	cb.cancel = [&seen]() {return ++seen > 100;};
+	const std::vector<LayoutResult> part = layoutBatch(catalog, opts, cb);
+	size_t done = 0;
+	for (LayoutResult const& r : part) done += r.done ? 1 : 0;
+	std::cout << "cancelled after " << done << " blocks\n";
+	ok &= done < catalog.size();
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
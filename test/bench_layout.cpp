@@ -0,0 +1,141 @@
+#include "cell.h"
+#include "stats.h"
+#include "random_draft.h"
+
+#include <iostream>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <chrono>
+
+using namespace corvus;
+
+// the original partition refinement version of Cell::layout kept here for comparison
+namespace legacy {
+	uint_fast32_t layout(Cell const& cell, std::vector<uint_fast32_t>& threading, std::vector< std::vector<uint_fast32_t> >& tieup, std::vector< std::vector<uint_fast32_t> >& treadling) {
+		const uint_fast32_t warps = cell.warps, wefts = cell.wefts;
+		std::vector< std::vector<uint_fast32_t> > sheds;
+		std::vector<uint_fast32_t> weftSheds;
+		{
+			std::set< std::vector<uint_fast32_t> > uniqueSheds;
+			std::vector< std::set< std::vector<uint_fast32_t> >::iterator > weftTypes;
+			weftTypes.reserve(wefts);
+			for (uint_fast32_t j = 0; j < wefts; j++) {
+				std::vector<uint_fast32_t> s;
+				for (uint_fast32_t i = 0; i < warps; i++) if (cell.get(i, j)) s.push_back(i);
+				weftTypes.push_back( uniqueSheds.insert(s).first );
+			}
+			sheds.assign(uniqueSheds.cbegin(), uniqueSheds.cend());
+			std::unordered_map<std::vector<uint_fast32_t>const*, uint_fast32_t> shedMap;
+			uint_fast32_t n = 0;
+			for (std::set< std::vector<uint_fast32_t> >::iterator iter = uniqueSheds.cbegin(); iter != uniqueSheds.cend(); ++iter) shedMap[&(*iter)] = n++;
+			weftSheds.resize(wefts);
+			for (uint_fast32_t j = 0; j < wefts; j++) weftSheds[j] = shedMap[&(*weftTypes[j])];
+		}
+
+		std::vector< std::vector<uint_fast32_t> > shafts;
+		{
+			             std::vector< std::pair<uint_fast32_t, bool> >             shaftSets(warps);
+			std::vector< std::vector< std::pair<uint_fast32_t, bool> >::iterator > bounds = {shaftSets.begin(), shaftSets.end()};
+			for (uint_fast32_t i = 0; i < warps; i++) shaftSets[i] = std::pair<uint_fast32_t, bool>(i, false);
+			std::vector< std::pair<uint_fast32_t, bool > > setI, setD, curShed;
+			setI.reserve(warps); setD.reserve(warps); curShed.reserve(warps);
+			for (std::vector<uint_fast32_t> const& x : sheds) {
+				curShed.clear();
+				for (uint_fast32_t const& i : x) curShed.emplace_back(i, false);
+				for (size_t i = 1; i < bounds.size(); i++) {
+					std::vector< std::pair<uint_fast32_t, bool> >::iterator start = bounds[i-1];
+					std::vector< std::pair<uint_fast32_t, bool> >::iterator end   = bounds[i  ];
+					setI.clear(); std::set_intersection(start, end, curShed.begin(), curShed.end(), std::back_inserter(setI));
+					setD.clear(); std::set_difference  (start, end, curShed.begin(), curShed.end(), std::back_inserter(setD));
+					if (setI.empty() || setD.empty()) continue;
+					for (auto iter = start; iter != end; ++iter) {
+						if (std::binary_search(setI.begin(), setI.end(), *iter)) iter->second = true;
+					}
+					std::vector< std::pair<uint_fast32_t, bool> >::iterator mid = std::partition(start, end, [](std::pair<uint_fast32_t, bool> const& p){return p.second;});
+					std::sort(start, mid);
+					std::sort(mid  , end);
+					for (auto iter = start; iter != mid; ++iter) iter->second = false;
+					bounds.insert(bounds.begin() + i, mid);
+					i++;
+				}
+			}
+			auto shaftSort = [](std::vector<uint_fast32_t>const& lhs, std::vector<uint_fast32_t>const& rhs) {
+				return lhs.size() == rhs.size() ? std::lexicographical_compare(lhs.cbegin(), lhs.cend(), rhs.cbegin(), rhs.cend()) : lhs.size() > rhs.size();
+			};
+			shafts.resize(bounds.size() - 1);
+			for (size_t i = 1; i < bounds.size(); i++) {
+				for (auto iter = bounds[i-1]; iter != bounds[i]; ++iter) shafts[i-1].push_back(iter->first);
+			}
+			std::sort(shafts.begin(), shafts.end(), shaftSort);
+		}
+
+		threading.resize(warps);
+		for (size_t i = 1; i < shafts.size(); i++) {
+			for (uint_fast32_t const& w : shafts[i]) threading[w] = static_cast<uint_fast32_t>(i);
+		}
+
+		std::vector< std::vector<uint_fast32_t> > shedShafts(sheds.size());
+		for (size_t j = 0; j < sheds.size(); j++) {
+			for (size_t i = 0; i < shafts.size(); i++) {
+				if (std::includes(sheds[j].cbegin(), sheds[j].cend(), shafts[i].cbegin(), shafts[i].cend())) shedShafts[j].push_back(static_cast<uint_fast32_t>(i));
+			}
+		}
+
+		if (sheds.size() <= shafts.size()) {
+			tieup.resize(shedShafts.size());
+			for (size_t i = 0; i < shedShafts.size(); i++) tieup[i] = shedShafts[i];
+			treadling.resize(wefts);
+			for (uint_fast32_t j = 0; j < wefts; j++) treadling[j] = std::vector<uint_fast32_t>(1, weftSheds[j]);
+		}
+		if (tieup.empty()) {
+			tieup.resize(shafts.size());
+			for (size_t i = 0; i < shafts.size(); i++) tieup[i] = std::vector<uint_fast32_t>(1, static_cast<uint_fast32_t>(i));
+			treadling.resize(wefts);
+			for (uint_fast32_t j = 0; j < wefts; j++) treadling[j] = shedShafts[weftSheds[j]];
+		}
+		return static_cast<uint_fast32_t>(shafts.size());
+	}
+}
+
+//! time both layout algorithms on a cell and make sure they agree
+//! \param name description of the cell
+//! \param cell cell to lay out
+//! \return true if the results match
+bool compare(char const* name, Cell const& cell) {
+	std::vector<uint_fast32_t> thrOld, thrNew;
+	std::vector< std::vector<uint_fast32_t> > tieOld, tieNew, trdOld, trdNew;
+	LayoutOptions straight;
+	straight.timeLimit = 0; // the legacy version always falls back to a straight tie up
+
+	auto t0 = std::chrono::steady_clock::now();
+	const uint_fast32_t sOld = legacy::layout(cell, thrOld, tieOld, trdOld);
+	auto t1 = std::chrono::steady_clock::now();
+	Stats stats;
+	uint_fast32_t sNew;
+	{
+		StatsScope scope(stats);
+		sNew = cell.layout(thrNew, tieNew, trdNew, straight);
+	}
+	auto t2 = std::chrono::steady_clock::now();
+
+	const double msOld = std::chrono::duration<double, std::milli>(t1 - t0).count();
+	const double msNew = std::chrono::duration<double, std::milli>(t2 - t1).count();
+	const bool match = sOld == sNew && thrOld == thrNew && tieOld == tieNew && trdOld == trdNew;
+	std::cout << name << " (" << cell.warps << " x " << cell.wefts << ", " << sNew << " shafts): ";
+	std::cout << "partition refinement " << msOld << " ms, column hashing " << msNew << " ms (" << msOld / msNew << "x)";
+	std::cout << (match ? "" : " OUTPUT MISMATCH") << '\n';
+	if (Stats::enabled) std::cout << "\t" << stats.json() << '\n';
+	return match;
+}
+
+int main() {
+	bool ok = true;
+	ok &= compare("dobby"         , randomDraft(12000, 4000,   24,   40, 1));
+	ok &= compare("wide dobby"    , randomDraft(20000, 2000,   32,  200, 2));
+	ok &= compare("jacquard block", randomDraft(10000,  400, 2000, 1000, 3));
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
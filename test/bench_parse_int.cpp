@@ -0,0 +1,91 @@
+#include "wif_io.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+using namespace corvus;
+
+// the original istringstream + atoi implementation kept here for comparison
+namespace legacy {
+	std::string trimWs(std::string const& str) {
+		size_t idx = str.find_first_not_of(" \t");
+		if (std::string::npos == idx) throw std::invalid_argument("empty string cannot be parsed into WIF value");
+		std::string cpy = str.substr(idx);
+		while (isspace(cpy.back())) cpy.pop_back();
+		return cpy;
+	}
+
+	Wif::Integer parse_int(std::string const& str) {
+		int i = atoi(trimWs(str).c_str());
+		if (i < 0 || static_cast<unsigned int>(i) > std::numeric_limits<Wif::Integer>::max()) throw std::invalid_argument(std::to_string(i) + " is outside representable range for WIF integer");
+		return static_cast<Wif::Integer>(i);
+	}
+
+	Wif::VecInt parse_vint(std::string const& str) {
+		Wif::VecInt v;
+		std::string tok;
+		std::istringstream ss(str);
+		while (std::getline(ss, tok, ',')) v.push_back(parse_int(tok));
+		return v;
+	}
+}
+
+//! time a parser over a list of values
+//! \param name name to print
+//! \param values strings to parse
+//! \param reps number of passes over values
+//! \param parse parser to time
+//! \return ns per parsed integer
+template <typename F>
+double timeParser(char const* name, std::vector<std::string> const& values, size_t reps, F parse) {
+	size_t count = 0;
+	uint64_t checksum = 0; // make sure nothing gets optimized away
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t r = 0; r < reps; r++) {
+		for (std::string const& s : values) {
+			Wif::VecInt v = parse(s);
+			count += v.size();
+			for (Wif::Integer const& i : v) checksum += i;
+		}
+	}
+	const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << ns / count << " ns/value (" << count << " values, checksum " << checksum << ")\n";
+	return ns / count;
+}
+
+int main() {
+	// build up a mix of values that looks like a big jacquard file
+	// mostly single shafts/treadles with some multi-valued entries
+	std::mt19937_64 gen(0);
+	std::uniform_int_distribution<int> shaft(1, 24), len(1, 8), kind(0, 9);
+	std::vector<std::string> values;
+	for (size_t i = 0; i < 200000; i++) {
+		const int n = kind(gen) < 7 ? 1 : len(gen); // 70% single values
+		std::string s;
+		for (int j = 0; j < n; j++) {
+			if (j > 0) s += ',';
+			s += std::to_string(shaft(gen));
+		}
+		values.push_back(s);
+	}
+
+	// check that both agree before timing anything
+	for (std::string const& s : values) {
+		if (legacy::parse_vint(s) != wif_io::parse_vint(s)) {
+			std::cout << "parsers disagree on \"" << s << "\"\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	const size_t reps = 10;
+	const double tOld = timeParser("istringstream + atoi", values, reps, [](std::string const& s) {return legacy::parse_vint(s);});
+	const double tNew = timeParser("from_chars + SWAR   ", values, reps, [](std::string const& s) {return wif_io::parse_vint(s);});
+	std::cout << "speedup: " << tOld / tNew << "x\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+#include "wif.h"
+#include "parallel.h"
+
+#include <iostream>
+#include <random>
+#include <chrono>
+
+using namespace corvus;
+
+//! build the text of a big draft with most of the per thread sections filled in
+//! \param warps number of warp threads
+//! \param wefts number of weft threads
+//! \param seed random seed
+//! \return wif text
+std::string randomText(Wif::Integer warps, Wif::Integer wefts, uint64_t seed) {
+	std::mt19937_64 gen(seed);
+	std::uniform_int_distribution<Wif::Integer> shaft(1, 32), treadle(1, 24), zoom(1, 4);
+	std::uniform_real_distribution<Wif::Real> size(0.01, 0.2);
+	std::bernoulli_distribution coin(0.5);
+
+	Wif w;
+	w.shafts = 32;
+	w.treadles = 24;
+	w.warpThreads = warps;
+	w.weftThreads = wefts;
+	w.title = "read benchmark";
+	w.warpUnit = w.weftUnit = Wif::Unit::Inches;
+	for (Wif::Integer t = 1; t <= 24; t++) {
+		Wif::VecInt shafts;
+		for (Wif::Integer s = 1; s <= 32; s++) if (coin(gen)) shafts.push_back(s);
+		if (shafts.empty()) shafts.push_back(t);
+		w.tieUp.emplace_back(t, shafts);
+	}
+	for (Wif::Integer i = 1; i <= warps; i++) {
+		w.threading.emplace_back(i, Wif::VecInt(1, shaft(gen)));
+		w.warpThicknessList.emplace_back(i, size(gen));
+		w.warpSpacingList.emplace_back(i, size(gen));
+		w.warpSpacingZoomList.emplace_back(i, zoom(gen));
+	}
+	for (Wif::Integer j = 1; j <= wefts; j++) {
+		Wif::VecInt pressed(1, treadle(gen));
+		if (coin(gen)) pressed.push_back(pressed.front() % 24 + 1);
+		w.treadling.emplace_back(j, pressed);
+		w.weftThicknessList.emplace_back(j, size(gen));
+		w.weftSpacingList.emplace_back(j, size(gen));
+		w.weftThicknessZoomList.emplace_back(j, zoom(gen));
+	}
+	w.sanityCheck(); // builds the lift plan so it is written too
+	std::string text;
+	w.write(text);
+	return text;
+}
+
+//! time reading a wif
+//! \param name name to print
+//! \param text wif text
+//! \param threads number of threads to read with
+//! \param reps number of times to read
+//! \return the wif written back out from the last rep
+std::string timeRead(char const* name, std::string const& text, unsigned threads, size_t reps) {
+	Wif w;
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t r = 0; r < reps; r++) w.read(text.data(), text.size(), threads);
+	const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / reps;
+	std::cout << name << ": " << s * 1e3 << " ms (" << text.size() / s / 1e6 << " MB/s)\n";
+	std::string out;
+	w.write(out);
+	return out;
+}
+
+int main() {
+	const std::string text = randomText(40000, 40000, 0);
+	const size_t reps = 5;
+	std::cout << text.size() / 1e6 << " MB of text, " << threadCount() << " hardware threads\n";
+
+	const std::string serial   = timeRead("1 thread   ", text, 1, reps);
+	const std::string parallel = timeRead("all threads", text, 0, reps);
+
+	// the threads only change how fast the wif is read
+	if (serial != parallel) {
+		std::cout << "RESULT MISMATCH\n";
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
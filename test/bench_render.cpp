@@ -0,0 +1,88 @@
+#include "wif.h"
+#include "render.h"
+#include "parallel.h"
+
+#include <iostream>
+#include <random>
+#include <chrono>
+
+using namespace corvus;
+
+//! build a striped 8 shaft wif
+//! \param warps number of warp threads
+//! \param wefts number of weft threads
+//! \param seed random seed
+//! \return wif with a random threading / tie up / treadling and striped colors
+Wif randomWif(Wif::Integer warps, Wif::Integer wefts, uint64_t seed) {
+	std::mt19937_64 gen(seed);
+	std::uniform_int_distribution<Wif::Integer> shaft(1, 8), color(1, 16), value(0, 255), stripe(1, 40);
+	std::bernoulli_distribution coin(0.5);
+
+	Wif w;
+	w.shafts = w.treadles = 8;
+	w.warpThreads = warps;
+	w.weftThreads = wefts;
+	w.range = Wif::Range(0, 255);
+	w.warpUnit = w.weftUnit = Wif::Unit::Inches;
+	for (Wif::Integer i = 1; i <= 16; i++) w.colorTable.emplace_back(i, Wif::Color{value(gen), value(gen), value(gen)});
+	for (Wif::Integer t = 1; t <= 8; t++) {
+		Wif::VecInt shafts;
+		for (Wif::Integer s = 1; s <= 8; s++) if (coin(gen)) shafts.push_back(s);
+		if (shafts.empty()) shafts.push_back(t);
+		w.tieUp.emplace_back(t, shafts);
+	}
+	for (Wif::Integer i = 1; i <= warps; i++) w.threading.emplace_back(i, Wif::VecInt(1, shaft(gen)));
+	for (Wif::Integer j = 1; j <= wefts; j++) w.treadling.emplace_back(j, Wif::VecInt(1, shaft(gen)));
+
+	// stripes of color in both directions
+	for (Wif::Integer i = 1, c = color(gen); i <= warps; i++) {
+		if (1 == stripe(gen)) c = color(gen);
+		w.warpColorList.emplace_back(i, c);
+	}
+	for (Wif::Integer j = 1, c = color(gen); j <= wefts; j++) {
+		if (1 == stripe(gen)) c = color(gen);
+		w.weftColorList.emplace_back(j, c);
+	}
+	w.sanityCheck(); // build the dense thread arrays
+	return w;
+}
+
+//! straightforward single threaded pixel by pixel renderer for comparison
+Image naiveRender(Cell const& cell, Palette const& pal) {
+	Image img(cell.warps, cell.wefts);
+	for (uint_fast32_t j = 0; j < cell.wefts; j++) {
+		for (uint_fast32_t i = 0; i < cell.warps; i++) {
+			Palette::Rgb const& c = cell.get(i, j) ? pal.warp[i] : pal.weft[j];
+			std::copy(c.cbegin(), c.cend(), img.pixel(i, cell.wefts - 1 - j));
+		}
+	}
+	return img;
+}
+
+int main() {
+	const Wif::Integer size = 10000;
+	const Wif w = randomWif(size, size, 0);
+	const double mp = double(size) * size / 1e6;
+
+	auto t0 = std::chrono::steady_clock::now();
+	const Cell cell = fromWif(w);
+	auto t1 = std::chrono::steady_clock::now();
+	const Palette pal = palette(w);
+	auto t2 = std::chrono::steady_clock::now();
+	const Image naive = naiveRender(cell, pal);
+	auto t3 = std::chrono::steady_clock::now();
+	const Image tiled = render(cell, pal);
+	auto t4 = std::chrono::steady_clock::now();
+
+	auto rate = [mp](std::chrono::steady_clock::duration d) {return mp / std::chrono::duration<double>(d).count();};
+	std::cout << size << " x " << size << " fabric (" << threadCount() << " threads)\n";
+	std::cout << "drawdown from wif : " << rate(t1 - t0) << " MP/s\n";
+	std::cout << "palette           : " << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms\n";
+	std::cout << "per pixel render  : " << rate(t3 - t2) << " MP/s\n";
+	std::cout << "tiled render      : " << rate(t4 - t3) << " MP/s (" << rate(t4 - t3) / rate(t3 - t2) << "x)\n";
+	if (naive.rgb != tiled.rgb) {
+		std::cout << "OUTPUT MISMATCH\n";
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+#include "cell.h"
+#include "repeat.h"
+#include "parallel.h"
+
+#include <iostream>
+#include <random>
+#include <chrono>
+
+using namespace corvus;
+
+//! build a random cell
+//! \param w number of warps
+//! \param h number of wefts
+//! \param seed random seed
+//! \return cell with random pixels
+Cell randomCell(uint_fast32_t w, uint_fast32_t h, uint64_t seed) {
+	std::mt19937_64 gen(seed);
+	Cell c(w, h);
+	for (uint_fast32_t j = 0; j < h; j++) {
+		uint64_t* r = c.row(j);
+		for (size_t k = 0; k < c.rowWords(); k++) r[k] = gen();
+		r[c.rowWords() - 1] &= bits::tailMask(w);
+	}
+	return c;
+}
+
+//! time a repeat search and check the result
+//! \param name description of the drawdown
+//! \param cell drawdown to search
+//! \param expected repeat that should be found
+//! \return true if the repeat matches
+bool check(char const* name, Cell const& cell, Repeat const& expected) {
+	auto t0 = std::chrono::steady_clock::now();
+	const Repeat r = cell.findRepeat();
+	auto t1 = std::chrono::steady_clock::now();
+	std::cout << name << ": " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, ";
+	std::cout << r.warps << " x " << r.wefts << " (band " << r.bandWefts << " shifted " << r.bandShift << ", drop " << r.dropWarps << " shifted " << r.dropShift << ")\n";
+	const bool ok = r.warps     == expected.warps     && r.wefts     == expected.wefts
+	             && r.bandWefts == expected.bandWefts && r.bandShift == expected.bandShift
+	             && r.dropWarps == expected.dropWarps && r.dropShift == expected.dropShift;
+	if (!ok) std::cout << "UNEXPECTED REPEAT\n";
+	return ok;
+}
+
+int main() {
+	const uint_fast32_t size = 20000;
+	std::cout << size << " x " << size << " drawdowns (" << threadCount() << " threads)\n";
+	bool ok = true;
+
+	// a half brick of a random 40 x 30 tile, every other band is shifted by half the tile (which is also a half drop)
+	{
+		const Cell tile = randomCell(40, 30, 0);
+		std::vector<RepeatView::Band> bands(2);
+		bands[1].shift = 20;
+		const Cell cell = RepeatView(std::vector<Cell>(1, tile), bands, size, size / 60 + 1).materialize().crop(0, 0, size, size);
+		ok &= check("half brick ", cell, Repeat{40, 60, 30, 20, 20, 30});
+	}
+
+	// bands of a random 211 x 97 tile each shifted 3 more than the last, the shift only comes back around after 211 bands (past the end of the drawdown)
+	// so there is no straight vertical repeat to find the band height from
+	{
+		std::vector<RepeatView::Band> bands(211);
+		for (size_t k = 0; k < bands.size(); k++) bands[k].shift = static_cast<uint_fast32_t>(3 * k % 211);
+		const Cell cell = RepeatView(std::vector<Cell>(1, randomCell(211, 97, 3)), bands, size, 1).materialize().crop(0, 0, size, size);
+		ok &= check("open brick ", cell, Repeat{211, size, 97, 3, 211, 0});
+	}
+
+	// a straight repeat of a random 48 x 48 tile
+	{
+		const Cell cell = RepeatView(randomCell(48, 48, 1), size / 48 + 1, size / 48 + 1).materialize().crop(0, 0, size, size);
+		ok &= check("straight   ", cell, Repeat{48, 48, 48, 0, 48, 0});
+	}
+
+	// nothing repeats
+	{
+		const Cell cell = randomCell(size, size, 2);
+		ok &= check("random     ", cell, Repeat{size, size, size, 0, size, 0});
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
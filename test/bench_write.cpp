@@ -0,0 +1,95 @@
+#include "wif.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+
+using namespace corvus;
+
+//! build a big draft with something in every kind of list section
+//! \param warps number of warp threads
+//! \param wefts number of weft threads
+//! \param seed random seed
+//! \return checked wif
+Wif randomWif(Wif::Integer warps, Wif::Integer wefts, uint64_t seed) {
+	std::mt19937_64 gen(seed);
+	std::uniform_int_distribution<Wif::Integer> shaft(1, 24), treadle(1, 16), color(1, 64), value(0, 255), zoom(1, 4);
+	std::uniform_real_distribution<Wif::Real> size(0.01, 0.2);
+	std::bernoulli_distribution coin(0.5), rare(0.05);
+
+	Wif w;
+	w.shafts = 24;
+	w.treadles = 16;
+	w.warpThreads = warps;
+	w.weftThreads = wefts;
+	w.range = Wif::Range(0, 255);
+	w.title = "write benchmark";
+	w.warpUnit = Wif::Unit::Centimeters;
+	w.weftUnit = Wif::Unit::Inches;
+	w.warpSpacing = w.weftSpacing = 0.05;
+	for (Wif::Integer i = 1; i <= 64; i++) w.colorTable.emplace_back(i, Wif::Color{value(gen), value(gen), value(gen)});
+	for (Wif::Integer t = 1; t <= 16; t++) {
+		Wif::VecInt shafts;
+		for (Wif::Integer s = 1; s <= 24; s++) if (coin(gen)) shafts.push_back(s);
+		if (shafts.empty()) shafts.push_back(t);
+		w.tieUp.emplace_back(t, shafts);
+	}
+	for (Wif::Integer i = 1; i <= warps; i++) {
+		w.threading.emplace_back(i, Wif::VecInt(1, shaft(gen)));
+		w.warpColorList.emplace_back(i, color(gen));
+		if (rare(gen)) w.warpThicknessList.emplace_back(i, size(gen));
+		if (rare(gen)) w.warpSpacingZoomList.emplace_back(i, zoom(gen));
+	}
+	for (Wif::Integer j = 1; j <= wefts; j++) {
+		Wif::VecInt pressed(1, treadle(gen));
+		if (coin(gen)) pressed.push_back(pressed.front() % 16 + 1);
+		w.treadling.emplace_back(j, pressed);
+		w.weftColorList.emplace_back(j, color(gen));
+		if (rare(gen)) w.weftSpacingList.emplace_back(j, size(gen));
+	}
+	w.sanityCheck();
+	return w;
+}
+
+//! time a writer
+//! \param name name to print
+//! \param reps number of times to write
+//! \param f writer to time, returns the text that was written
+//! \return text from the last rep
+template <typename F> std::string timeWriter(char const* name, size_t reps, F f) {
+	std::string text;
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t r = 0; r < reps; r++) text = f();
+	const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / reps;
+	std::cout << name << ": " << text.size() / s / 1e6 << " MB/s (" << s * 1e3 << " ms)\n";
+	return text;
+}
+
+int main() {
+	const Wif w = randomWif(200000, 200000, 0);
+	const size_t reps = 5;
+	const std::string path = "bench_write.wif";
+	auto readBack = [&]() {
+		std::ifstream is(path, std::ios::in | std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+	};
+
+	const std::string stream = timeWriter("ostringstream  ", reps, [&]() {std::ostringstream os; w.write(os); return os.str();});
+	const std::string buffer = timeWriter("string buffer  ", reps, [&]() {std::string buf; w.write(buf); return buf;});
+	timeWriter("ofstream       ", reps, [&]() {std::ofstream os(path, std::ios::out | std::ios::binary); w.write(os); return stream;});
+	const std::string ofs = readBack();
+	timeWriter("writeFile      ", reps, [&]() {w.writeFile(path); return stream;});
+	const std::string file = readBack();
+	std::remove(path.c_str());
+
+	// every path has to produce the same bytes
+	if (stream != buffer || stream != ofs || stream != file) {
+		std::cout << "OUTPUT MISMATCH\n";
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
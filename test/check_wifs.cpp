@@ -0,0 +1,269 @@
+#include "wif.h"
+#include "parallel.h"
+#include "stats.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <memory_resource>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cctype>
+
+using namespace corvus;
+namespace fs = std::filesystem;
+
+//! hands out wif files one at a time from a mix of files, directories, and lists of files
+//! directories and lists are walked lazily so memory doesn't grow with the size of the archive
+class FileSource {
+	public:
+		//! a file to check
+		struct Item {
+			fs::path    path ; //!< file to read
+			fs::path    rel  ; //!< where a normalized copy goes relative to the output directory
+			std::string error; //!< problem finding the file (e.g. unreadable directory), empty if path is good
+		};
+
+		//! an input argument
+		struct Input {
+			std::string name  ; //!< file, directory, or list file
+			bool        isList; //!< is name a file with one path per line ("-" for stdin)
+		};
+
+		//! construct a source
+		//! \param inputs files / directories / lists to walk in order
+		explicit FileSource(std::vector<Input> inputs) : inputs(std::move(inputs)), next_(0) {}
+
+		//! get the next file (thread safe)
+		//! \param item location to write the next file
+		//! \return false once every input has been used up
+		bool next(Item& item) {
+			std::lock_guard<std::mutex> guard(lock);
+			item.error.clear();
+			while (true) {
+				// keep walking the current directory
+				if (fs::recursive_directory_iterator() != dir) {
+					std::error_code ec;
+					fs::directory_entry const& e = *dir;
+					const bool take = e.is_regular_file(ec) && isWif(e.path());
+					if (take) {
+						item.path = e.path();
+						item.rel = e.path().lexically_relative(root);
+					}
+					dir.increment(ec);
+					if (ec) {
+						item.path = root;
+						item.error = "couldn't finish walking directory: " + ec.message();
+						dir = fs::recursive_directory_iterator();
+						return true;
+					}
+					if (take) return true;
+					continue;
+				}
+
+				// then the current list
+				if (nullptr != list) {
+					std::string line;
+					if (std::getline(*list, line)) {
+						if (!line.empty() && '\r' == line.back()) line.pop_back(); // lists made on windows
+						if (line.empty()) continue;
+						if (fromPath(line, false, item)) return true;
+						continue;
+					}
+					list = nullptr;
+					listFile.close();
+				}
+
+				// finally move on to the next input
+				if (next_ == inputs.size()) return false;
+				Input const& in = inputs[next_++];
+				if (in.isList) {
+					if ("-" == in.name) {
+						list = &std::cin;
+					} else {
+						listFile.open(in.name);
+						if (!listFile) {
+							item.path = in.name;
+							item.error = "couldn't open file list";
+							return true;
+						}
+						list = &listFile;
+					}
+				} else if (fromPath(in.name, true, item)) {
+					return true;
+				}
+			}
+		}
+
+	private:
+		//! check for a .wif extension (case insensitive)
+		//! \param p path to check
+		//! \return true if p looks like a wif
+		static bool isWif(fs::path const& p) {
+			std::string ext = p.extension().string();
+			for (char& c : ext) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+			return ".wif" == ext;
+		}
+
+		//! start on a path from the command line or a list
+		//! \param name path to a file or directory
+		//! \param walk should directories be walked (only for paths on the command line)
+		//! \param item location to write the file if there is one to hand out right away
+		//! \return true if item was written
+		bool fromPath(std::string const& name, bool walk, Item& item) {
+			std::error_code ec;
+			const fs::path p(name);
+			if (walk && fs::is_directory(p, ec)) {
+				root = p;
+				dir = fs::recursive_directory_iterator(p, fs::directory_options::skip_permission_denied, ec);
+				if (!ec) return false;
+				item.path = p;
+				item.error = "couldn't open directory: " + ec.message();
+				return true;
+			}
+
+			// single files keep their relative path under the output directory
+			// absolute paths and paths that climb out of the current directory (e.g. ../x.wif) would land outside of it so they just keep the name
+			item.path = p;
+			const fs::path rel = p.lexically_normal();
+			item.rel = (rel.empty() || rel.has_root_path() || ".." == *rel.begin()) ? p.filename() : rel;
+			return true;
+		}
+
+		std::vector<Input>               inputs  ; //!< everything to walk
+		size_t                           next_   ; //!< next input to start on
+		fs::path                         root    ; //!< directory being walked
+		fs::recursive_directory_iterator dir     ; //!< position in root
+		std::ifstream                    listFile; //!< list being read
+		std::istream*                    list = nullptr; //!< list being read (listFile or stdin)
+		std::mutex                       lock    ; //!< serializes next()
+};
+
+//! parse a count from the command line
+//! \param str text to parse
+//! \param max largest count allowed
+//! \param count location to write count
+//! \return true if str is a whole number from 1 to max
+bool parseCount(std::string const& str, unsigned max, unsigned& count) {
+	if (str.empty() || !isdigit(static_cast<unsigned char>(str.front()))) return false; // stoul would skip whitespace and wrap negative numbers
+	size_t used = 0;
+	unsigned long val = 0;
+	try {
+		val = std::stoul(str, &used);
+	} catch (std::exception const&) { // invalid_argument or out_of_range
+		return false;
+	}
+	if (used != str.size() || 0 == val || val > max) return false;
+	count = static_cast<unsigned>(val);
+	return true;
+}
+
+//! most files to work on at once, each one is a thread so this keeps a typo from trying to start millions of them
+//! \return limit for -j
+unsigned maxJobs() {
+	return 16 * threadCount();
+}
+
+//! print usage
+//! \param name program name
+void usage(char const* name) {
+	std::cout << "usage: " << name << " [options] [files / directories]\n";
+	std::cout << "parses and checks every wif (directories are searched recursively for .wif files)\n";
+	std::cout << "options:\n";
+	std::cout << "\t-l list  : also check the files listed in list, one per line ('-' for stdin)\n";
+	std::cout << "\t-o dir   : write a normalized copy of each good file under dir (keeping paths relative to the directory searched)\n";
+	std::cout << "\t-j count : number of files to work on at once, from 1 to " << maxJobs() << " (default every hardware thread)\n";
+	std::cout << "\t-q       : only print the summary\n";
+	std::cout << "\t-s       : print phase timing / counters as json after the summary (needs a build with CORVUS_STATS)\n";
+}
+
+int main(int argc, char** argv) {
+	// parse arguments
+	std::vector<FileSource::Input> inputs;
+	fs::path outDir;
+	unsigned jobs = 0; // 0 until -j is given for every hardware thread
+	bool quiet = false, stats = false;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg(argv[i]);
+		if (("-l" == arg || "-o" == arg || "-j" == arg) && i + 1 == argc) {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+		if      ("-l" == arg) inputs.push_back(FileSource::Input{argv[++i], true});
+		else if ("-o" == arg) outDir = argv[++i];
+		else if ("-j" == arg) {
+			if (!parseCount(argv[++i], maxJobs(), jobs)) {
+				std::cout << "invalid job count '" << argv[i] << "'\n";
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+		}
+		else if ("-q" == arg) quiet = true;
+		else if ("-s" == arg) stats = true;
+		else if ("-h" == arg || "--help" == arg) {usage(argv[0]); return EXIT_SUCCESS;}
+		else inputs.push_back(FileSource::Input{arg, false});
+	}
+	if (inputs.empty()) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// each worker has a single file in flight at a time, read through a memory mapping and written in blocks
+	// so memory use is set by the number of workers and the biggest draft instead of the size of the archive
+	FileSource source(std::move(inputs));
+	const unsigned workers = 0 == jobs ? threadCount() : jobs;
+	std::atomic<size_t> files(0), failed(0), bytes(0);
+	std::mutex print;
+	Stats total; // merged from every worker
+	const auto start = std::chrono::steady_clock::now();
+	parallelForEach(workers, workers, [&](size_t, size_t) {
+		Wif w;
+		std::pmr::unsynchronized_pool_resource scratch; // reused by every parse on this worker
+		Stats workerStats;
+		StatsScope scope(workerStats);
+		FileSource::Item item;
+		while (source.next(item)) {
+			++files;
+			std::string error = item.error;
+			if (error.empty()) {
+				try {
+					std::error_code ec;
+					const uintmax_t size = fs::file_size(item.path, ec);
+					if (!ec) bytes += size;
+					w.readFile(item.path.string(), 1, &scratch); // this also runs sanityCheck
+					if (!outDir.empty()) {
+						const fs::path out = outDir / item.rel;
+						fs::create_directories(out.parent_path(), ec);
+						w.writeFile(out.string());
+					}
+				} catch (std::exception& e) {
+					error = e.what();
+				}
+			}
+			if (!error.empty()) {
+				++failed;
+				if (!quiet) {
+					std::lock_guard<std::mutex> guard(print);
+					std::cout << item.path.string() << ": " << error << '\n';
+				}
+			}
+		}
+		std::lock_guard<std::mutex> guard(print);
+		total += workerStats;
+		return true;
+	});
+	const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// summarize
+	const size_t good = files - failed;
+	std::cout << files << " files checked, " << good << " good, " << failed << " failed\n";
+	std::cout << s << " s with " << workers << " workers: " << files / s << " files/s, " << bytes / s / 1e6 << " MB/s\n";
+	if (stats) {
+		total.writeJson(std::cout);
+		std::cout << '\n';
+	}
+	return 0 == failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
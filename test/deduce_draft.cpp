@@ -9,7 +9,7 @@ using namespace corvus;
 int main() {
 	std::array<Cell,4> cells;
 
-	cells[0].mask = {
+	cells[0] = Cell(15, 30, {
 		1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 
 		1, 1, 0, 1, 1, 1, 0, 1, 0, 1, 1, 1, 0, 1, 1, 
 		1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 
@@ -40,11 +40,9 @@ int main() {
 		1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 
 		1, 1, 0, 1, 1, 1, 0, 1, 0, 1, 1, 1, 0, 1, 1, 
 		1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 
-	};
-	cells[0].warps = 15;
-	cells[0].wefts = 30;
+	});
 
-	cells[1].mask = {
+	cells[1] = Cell(4, 16, {
 		1, 1, 0, 0,
 		1, 1, 1, 0,
 		0, 1, 1, 0,
@@ -61,20 +59,16 @@ int main() {
 		1, 0, 1, 1,
 		1, 0, 0, 1,
 		1, 1, 0, 1,
-	};
-	cells[1].warps = 4;
-	cells[1].wefts = 16;
+	});
 
-	cells[2].mask = {
+	cells[2] = Cell(8, 4, {
 		1, 0, 0, 1, 0, 1, 1, 1,
 		1, 1, 0, 0, 1, 0, 1, 1,
 		0, 1, 1, 0, 1, 1, 0, 1,
 		0, 0, 1, 1, 1, 1, 1, 0,
-	};
-	cells[2].warps = 8;
-	cells[2].wefts = 4;
+	});
 
-	cells[3].mask = {
+	cells[3] = Cell(16, 8, {
 		0, 0, 1, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 0, 1, 1,
 		0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0,
 		1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0,
@@ -83,9 +77,7 @@ int main() {
 		1, 1, 1, 0, 1, 1, 1, 1, 1, 0, 1, 1, 1, 1, 1, 0,
 		1, 1, 0, 1, 0, 1, 1, 1, 0, 1, 0, 1, 1, 1, 0, 1,
 		1, 0, 1, 1, 1, 0, 1, 0, 1, 1, 1, 0, 1, 0, 1, 1,
-	};
-	cells[3].warps = 16;
-	cells[3].wefts = 8;
+	});
 
 	for (Cell const& cell : cells) {
 		std::vector<uint_fast32_t> threading;
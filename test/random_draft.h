@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) William Lenthe
+ * all rights reserved
+ * please see the license file for more details
+ */
+
+#ifndef _CORVUS_RANDOM_DRAFT_H_
+#define _CORVUS_RANDOM_DRAFT_H_
+#pragma once
+
+#include "cell.h"
+
+#include <random>
+#include <vector>
+
+namespace corvus {
+	//! build a drawdown from a random threading / tie up / treadling (shared by the tests and benchmarks)
+	//! \param warps number of warps
+	//! \param wefts number of wefts
+	//! \param shafts number of shafts to thread on
+	//! \param sheds number of distinct sheds (treadles)
+	//! \param gen random generator
+	//! \return drawdown
+	inline Cell randomDraft(uint_fast32_t warps, uint_fast32_t wefts, uint_fast32_t shafts, uint_fast32_t sheds, std::mt19937_64& gen) {
+		std::uniform_int_distribution<uint_fast32_t> shaft(0, shafts - 1), shed(0, sheds - 1);
+		std::bernoulli_distribution coin(0.5);
+		std::vector<uint_fast32_t> threading(warps);
+		for (uint_fast32_t& t : threading) t = shaft(gen);
+		std::vector< std::vector<bool> > tieup(sheds, std::vector<bool>(shafts));
+		for (std::vector<bool>& t : tieup) for (size_t i = 0; i < t.size(); i++) t[i] = coin(gen);
+
+		Cell cell(warps, wefts);
+		for (uint_fast32_t j = 0; j < wefts; j++) {
+			std::vector<bool> const& lift = tieup[shed(gen)];
+			for (uint_fast32_t i = 0; i < warps; i++) if (lift[threading[i]]) cell.set(i, j, true);
+		}
+		return cell;
+	}
+
+	//! build a drawdown from a random threading / tie up / treadling with its own generator
+	//! \param warps number of warps
+	//! \param wefts number of wefts
+	//! \param shafts number of shafts to thread on
+	//! \param sheds number of distinct sheds (treadles)
+	//! \param seed random seed
+	//! \return drawdown
+	inline Cell randomDraft(uint_fast32_t warps, uint_fast32_t wefts, uint_fast32_t shafts, uint_fast32_t sheds, uint64_t seed) {
+		std::mt19937_64 gen(seed);
+		return randomDraft(warps, wefts, shafts, sheds, gen);
+	}
+}
+
+#endif//_CORVUS_RANDOM_DRAFT_H_
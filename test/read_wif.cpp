@@ -1,6 +1,5 @@
 #include "wif.h"
 #include <iostream>
-#include <fstream>
 
 using namespace corvus;
 
@@ -15,13 +14,9 @@ int main(int argc, char** argv) {
 			fname = argv[1];
 		}
 
-		// make sure file exists
-		std::ifstream is(fname);
-		if (!is.good()) throw std::invalid_argument("file doesn't exist");
-
-		// do the parsing
+		// do the parsing (this throws if the file doesn't exist)
 		Wif w;
-		is >> w;
+		w.readFile(fname);
 		std::cout << w;
 	} catch (std::exception& e) {
 		std::cout << e.what() << '\n';
@@ -0,0 +1,33 @@
+#include "wif.h"
+#include "render.h"
+#include "simulate.h"
+#include <iostream>
+
+using namespace corvus;
+
+int main(int argc, char** argv) {
+	try {
+		// get file to render
+		if (3 != argc && 4 != argc) {
+			std::cout << "usage: " << argv[0] << " [wif to render] [output ppm] (dpi)\n";
+			std::cout << "\twithout a dpi the drawdown is rendered with a pixel per crossing\n";
+			std::cout << "\twith a dpi the fabric is simulated using the thread spacing / thickness\n";
+			return EXIT_FAILURE;
+		}
+
+		// parse and render
+		Wif w;
+		w.readFile(argv[1]);
+		if (3 == argc) {
+			render(w).writePpm(std::string(argv[2]));
+		} else {
+			SimulateOptions opts;
+			opts.dpi = std::stod(argv[3]);
+			simulate(w, opts).writePpm(std::string(argv[2]));
+		}
+	} catch (std::exception& e) {
+		std::cout << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#include "incremental.h"
+
+#include <iostream>
+#include <random>
+#include <algorithm>
+
+using namespace corvus;
+
+//! check an incremental layout against a full Cell::layout of the same wefts
+//! the numbering of shafts / treadles is allowed to differ, the partition of the warps and the drawdown it weaves are not
+//! \param inc incremental layout
+//! \param rows packed wefts added to inc so far (after edits)
+//! \return true if the layouts agree
+bool matches(IncrementalLayout const& inc, std::vector< std::vector<uint64_t> > const& rows) {
+	const uint_fast32_t warps = inc.warps();
+	Cell cell(warps, static_cast<uint_fast32_t>(rows.size()));
+	for (uint_fast32_t j = 0; j < cell.wefts; j++) std::copy(rows[j].cbegin(), rows[j].cend(), cell.row(j));
+	std::vector<uint_fast32_t> threading;
+	std::vector< std::vector<uint_fast32_t> > tieup, treadling;
+	const uint_fast32_t shafts = cell.layout(threading, tieup, treadling);
+	if (shafts != inc.shafts() || cell.wefts != inc.wefts()) return false;
+
+	// the shafts must be the same sets of warps, i.e. a 1:1 relabeling
+	std::vector<uint_fast32_t> fwd(shafts, ~uint_fast32_t(0)), bwd(shafts, ~uint_fast32_t(0));
+	for (uint_fast32_t i = 0; i < warps; i++) {
+		const uint_fast32_t a = threading[i], b = inc.threading()[i];
+		if (b >= shafts) return false;
+		if (fwd[a] == ~uint_fast32_t(0)) fwd[a] = b;
+		if (bwd[b] == ~uint_fast32_t(0)) bwd[b] = a;
+		if (fwd[a] != b || bwd[b] != a) return false;
+	}
+	for (uint_fast32_t s = 0; s < inc.shafts(); s++) {
+		for (uint_fast32_t const& i : inc.shaft(s)) if (inc.threading()[i] != s) return false;
+	}
+
+	// every weft is woven by the shafts tied to its treadle
+	std::vector<uint64_t> r(cell.rowWords());
+	for (uint_fast32_t j = 0; j < cell.wefts; j++) {
+		std::fill(r.begin(), r.end(), 0);
+		for (uint_fast32_t const& s : inc.tieup(inc.treadling()[j])) {
+			for (uint_fast32_t const& i : inc.shaft(s)) bits::set(r.data(), i, true);
+		}
+		if (r != rows[j]) return false;
+	}
+
+	// unused treadles are empty and tied shafts are sorted
+	for (size_t t = 0; t < inc.treadles(); t++) {
+		if (!std::is_sorted(inc.tieup(t).cbegin(), inc.tieup(t).cend())) return false;
+		if (0 == inc.uses(t) && !inc.tieup(t).empty()) return false;
+	}
+	return true;
+}
+
+int main() {
+	std::mt19937_64 gen(3);
+	size_t bad = 0;
+	for (size_t trial = 0; trial < 2000; trial++) {
+		// a random threading and a pool of sheds it can weave
+		const uint_fast32_t warps = static_cast<uint_fast32_t>(gen() % 150);
+		const uint_fast32_t shafts = static_cast<uint_fast32_t>(1 + gen() % 10);
+		const size_t sheds = 1 + gen() % 12;
+		std::vector<uint_fast32_t> threading(warps);
+		for (uint_fast32_t& t : threading) t = static_cast<uint_fast32_t>(gen() % shafts);
+		std::vector< std::vector<uint64_t> > pool(sheds, std::vector<uint64_t>(bits::words(warps), 0));
+		for (std::vector<uint64_t>& r : pool) {
+			const uint64_t lift = gen();
+			for (uint_fast32_t i = 0; i < warps; i++) if ((lift >> threading[i]) & 1) bits::set(r.data(), i, true);
+		}
+
+		// randomly append and change wefts checking after every edit
+		IncrementalLayout inc(warps);
+		std::vector< std::vector<uint64_t> > rows;
+		const size_t steps = gen() % 60;
+		for (size_t s = 0; s < steps; s++) {
+			std::vector<uint64_t> const& r = pool[gen() % sheds];
+			if (rows.empty() || 0 == gen() % 2) {
+				inc.appendWeft(r.data());
+				rows.push_back(r);
+			} else {
+				const size_t j = gen() % rows.size();
+				inc.setWeft(static_cast<uint_fast32_t>(j), r.data());
+				rows[j] = r;
+			}
+			if (!matches(inc, rows)) {
+				if (bad++ < 5) std::cout << "mismatch in trial " << trial << " after " << s + 1 << " edits (" << warps << " warps)\n";
+				break;
+			}
+		}
+	}
+	std::cout << bad << " mismatched trials\n";
+	return 0 == bad ? EXIT_SUCCESS : EXIT_FAILURE;
+}
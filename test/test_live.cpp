@@ -0,0 +1,137 @@
+#include "live.h"
+#include "wif.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace corvus;
+
+//! a treadled draft kept as plain lists to check LiveDraft against (0 indexed)
+struct Draft {
+	uint_fast32_t                       shafts, treadles;
+	std::vector<uint_fast32_t>          threading; //!< shaft of each warp
+	std::vector< std::vector<bool> >    tieup    ; //!< is each shaft tied to each treadle
+	std::vector<uint_fast32_t>          treadling; //!< treadle pressed for each weft
+
+	//! build the drawdown the slow way
+	//! \return drawdown (rising shed)
+	Cell drawdown() const {
+		Cell cell(static_cast<uint_fast32_t>(threading.size()), static_cast<uint_fast32_t>(treadling.size()));
+		for (uint_fast32_t j = 0; j < cell.wefts; j++) {
+			for (uint_fast32_t i = 0; i < cell.warps; i++) cell.set(i, j, tieup[treadling[j]][threading[i]]);
+		}
+		return cell;
+	}
+
+	//! get the shafts tied to a treadle
+	//! \param t treadle
+	//! \return tied shafts
+	std::vector<uint_fast32_t> tied(uint_fast32_t t) const {
+		std::vector<uint_fast32_t> s;
+		for (uint_fast32_t k = 0; k < shafts; k++) if (tieup[t][k]) s.push_back(k);
+		return s;
+	}
+};
+
+//! open a draft the same way a file would be (write it to wif text and read it back)
+//! \param d draft to convert
+//! \return checked wif
+Wif toWif(Draft const& d) {
+	Wif w;
+	w.shafts = d.shafts;
+	w.treadles = d.treadles;
+	w.warpThreads = static_cast<Wif::Integer>(d.threading.size());
+	w.weftThreads = static_cast<Wif::Integer>(d.treadling.size());
+	w.warpUnit = w.weftUnit = Wif::Unit::Inches;
+	for (uint_fast32_t t = 0; t < d.treadles; t++) {
+		Wif::VecInt s;
+		for (uint_fast32_t const& k : d.tied(t)) s.push_back(k + 1);
+		if (!s.empty()) w.tieUp.emplace_back(t + 1, s);
+	}
+	for (size_t i = 0; i < d.threading.size(); i++) w.threading.emplace_back(static_cast<Wif::Integer>(i + 1), Wif::VecInt(1, d.threading[i] + 1));
+	for (size_t j = 0; j < d.treadling.size(); j++) w.treadling.emplace_back(static_cast<Wif::Integer>(j + 1), Wif::VecInt(1, d.treadling[j] + 1));
+	w.sanityCheck();
+
+	std::string text;
+	w.write(text);
+	Wif read;
+	read.read(text.data(), text.size()); // this also runs sanityCheck
+	return read;
+}
+
+//! compare 2 lists of rectangles
+bool sameRects(std::vector<Rect> const& a, std::vector<Rect> const& b) {
+	if (a.size() != b.size()) return false;
+	for (size_t k = 0; k < a.size(); k++) {
+		if (a[k].x != b[k].x || a[k].y != b[k].y || a[k].width != b[k].width || a[k].height != b[k].height) return false;
+	}
+	return true;
+}
+
+//! report a failed check
+//! \param ok result of check
+//! \param what description of check
+//! \return ok
+bool expect(bool ok, char const* what) {
+	if (!ok) std::cout << "FAILED: " << what << '\n';
+	return ok;
+}
+
+int main() {
+	// a random 8 shaft 10 treadle draft
+	std::mt19937_64 gen(7);
+	Draft d;
+	d.shafts = 8;
+	d.treadles = 10;
+	d.threading.resize(200);
+	d.treadling.resize(120);
+	d.tieup.assign(d.treadles, std::vector<bool>(d.shafts, false));
+	for (uint_fast32_t& s : d.threading) s = static_cast<uint_fast32_t>(gen() % d.shafts);
+	for (uint_fast32_t& t : d.treadling) t = static_cast<uint_fast32_t>(gen() % d.treadles);
+	for (std::vector<bool>& t : d.tieup) for (size_t k = 0; k < t.size(); k++) t[k] = 0 == gen() % 2;
+	d.treadling[50] = d.treadling[51] = d.treadling[52] = 3; // a run of wefts on the treadle that is edited below
+
+	bool ok = true;
+	LiveDraft live(toWif(d));
+	ok &= expect(d.treadles == live.treadles(), "treadled wif opens as a tie up and treadling");
+	ok &= expect(live.takeDirty().empty(), "nothing is dirty after opening");
+	ok &= expect(d.drawdown().mask == live.drawdown().mask, "initial drawdown");
+
+	// change the tie up of treadle 3, every weft pressing it is dirty (consecutive wefts as 1 rectangle)
+	d.tieup[3].flip();
+	live.setTieup(3, d.tied(3));
+	std::vector<Rect> expected;
+	for (uint_fast32_t j = 0; j < d.treadling.size(); j++) {
+		if (3 != d.treadling[j]) continue;
+		if (!expected.empty() && expected.back().y + expected.back().height == j) ++expected.back().height;
+		else expected.push_back(Rect{0, j, live.warps(), 1});
+	}
+	ok &= expect(sameRects(expected, live.takeDirty()), "tie up edit dirties the wefts pressing the treadle");
+	ok &= expect(d.drawdown().mask == live.drawdown().mask, "drawdown after tie up edit");
+
+	// change the treadling of a single weft
+	d.treadling[10] = (d.treadling[10] + 1) % d.treadles;
+	live.setTreadling(10, {d.treadling[10]});
+	ok &= expect(sameRects({Rect{0, 10, live.warps(), 1}}, live.takeDirty()), "treadling edit dirties 1 weft");
+	ok &= expect(d.drawdown().mask == live.drawdown().mask, "drawdown after treadling edit");
+
+	// moving a weft onto the edited treadle means it is dirtied by the next tie up edit too
+	d.treadling[11] = 3;
+	live.setTreadling(11, {3});
+	live.takeDirty();
+	d.tieup[3][0] = !d.tieup[3][0];
+	live.setTieup(3, d.tied(3));
+	bool has11 = false;
+	for (Rect const& r : live.takeDirty()) has11 |= r.y <= 11 && 11 < r.y + r.height;
+	ok &= expect(has11, "tie up edit follows treadling edits");
+	ok &= expect(d.drawdown().mask == live.drawdown().mask, "drawdown after both edits");
+
+	// a treadled draft has no lift plan to edit
+	bool threw = false;
+	try {live.setLiftPlan(0, {0});} catch (std::invalid_argument const&) {threw = true;}
+	ok &= expect(threw, "lift plan edits are rejected for treadled drafts");
+
+	std::cout << (ok ? "all checks passed" : "some checks failed") << '\n';
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,75 @@
+#include "wif.h"
+
+#include <iostream>
+#include <atomic>
+#include <random>
+#include <new>
+#include <cstdlib>
+
+using namespace corvus;
+
+// count every heap allocation made by the program
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+	++allocations;
+	if (void* p = std::malloc(0 == size ? 1 : size)) return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) {return operator new(size);}
+void operator delete  (void* p) noexcept {std::free(p);}
+void operator delete[](void* p) noexcept {std::free(p);}
+void operator delete  (void* p, size_t) noexcept {std::free(p);}
+void operator delete[](void* p, size_t) noexcept {std::free(p);}
+
+//! build the text of a random treadled draft (with the lift plan it implies)
+//! \param warps number of warps
+//! \param wefts number of wefts
+//! \param seed random seed
+//! \return wif text
+std::string randomWif(Wif::Integer warps, Wif::Integer wefts, uint64_t seed) {
+	std::mt19937_64 gen(seed);
+	Wif w;
+	w.shafts = 8;
+	w.treadles = 10;
+	w.warpThreads = warps;
+	w.weftThreads = wefts;
+	w.warpUnit = w.weftUnit = Wif::Unit::Inches;
+	for (Wif::Integer t = 1; t <= w.treadles; t++) w.tieUp.emplace_back(t, Wif::VecInt{1 + t % w.shafts, 1 + (t * 3) % w.shafts});
+	for (Wif::Integer i = 1; i <= warps; i++) w.threading.emplace_back(i, Wif::VecInt(1, static_cast<Wif::Integer>(1 + gen() % w.shafts)));
+	for (Wif::Integer j = 1; j <= wefts; j++) w.treadling.emplace_back(j, Wif::VecInt(1, static_cast<Wif::Integer>(1 + gen() % w.treadles)));
+	w.sanityCheck(); // this builds the lift plan so it is written too
+
+	std::string text;
+	w.write(text);
+	return text;
+}
+
+//! read wif text counting allocations
+//! \param text wif text
+//! \param threads number of threads to read with
+//! \return number of allocations made by the read (including the result)
+size_t countRead(std::string const& text, unsigned threads) {
+	const size_t before = allocations;
+	{
+		Wif w;
+		w.read(text.data(), text.size(), threads);
+	}
+	return allocations - before;
+}
+
+int main() {
+	// the per thread lists are parsed into flat arrays so the number of allocations shouldn't grow with the number of threads
+	// both drafts are big enough to be decoded in parallel (starting threads allocates) and the arena grows geometrically so a few more blocks are allowed
+	const std::string small = randomWif( 5000,  4000, 1);
+	const std::string big   = randomWif(50000, 40000, 2);
+	bool ok = true;
+	for (unsigned threads : {1u, 4u}) {
+		const size_t a = countRead(small, threads);
+		const size_t b = countRead(big  , threads);
+		const bool pass = b <= a + 8;
+		std::cout << threads << " thread(s): " << a << " allocations for " << small.size() << " bytes, " << b << " for " << big.size() << " bytes" << (pass ? "" : ", TOO MANY") << '\n';
+		ok &= pass;
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,82 @@
+#include "cell.h"
+#include "random_draft.h"
+
+#include <iostream>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+using namespace corvus;
+
+// count every heap allocation made by the program
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+	++allocations;
+	if (void* p = std::malloc(0 == size ? 1 : size)) return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) {return operator new(size);}
+void operator delete  (void* p) noexcept {std::free(p);}
+void operator delete[](void* p) noexcept {std::free(p);}
+void operator delete  (void* p, size_t) noexcept {std::free(p);}
+void operator delete[](void* p, size_t) noexcept {std::free(p);}
+
+//! lay out a cell with a workspace and check that it matches Cell::layout without allocating
+//! \param name description of the cell
+//! \param ws workspace that has already seen a cell at least this big
+//! \param cell cell to lay out
+//! \param opts layout options
+//! \return true if nothing was allocated and the layout matches
+bool check(char const* name, LayoutWorkspace& ws, Cell const& cell, LayoutOptions const& opts) {
+	std::vector<uint_fast32_t> threading;
+	std::vector< std::vector<uint_fast32_t> > tieup, treadling;
+	const uint_fast32_t shafts = cell.layout(threading, tieup, treadling, opts);
+
+	const size_t before = allocations;
+	const uint_fast32_t wsShafts = ws.layout(cell, opts);
+	const size_t count = allocations - before;
+
+	std::vector< std::vector<uint_fast32_t> > wsTieup, wsTreadling;
+	ws.tieup    ().toLists(wsTieup    );
+	ws.treadling().toLists(wsTreadling);
+	const bool match = shafts == wsShafts && threading == ws.threading() && tieup == wsTieup && treadling == wsTreadling;
+	std::cout << name << ": " << count << " allocations" << (match ? "" : ", OUTPUT MISMATCH") << '\n';
+	return match && 0 == count;
+}
+
+int main() {
+	// designs up to 1024 warps are transposed on the calling thread, wider ones start threads (which allocate) unless opts.threads is 1
+	const Cell big   = randomDraft(1000, 600, 24, 40, 1);
+	const Cell small = randomDraft( 300, 200,  8, 12, 2);
+	const Cell few   = randomDraft( 500, 300, 16,  6, 3); // fewer sheds than shafts
+
+	LayoutOptions straight;
+	LayoutOptions treadles;
+	treadles.treadles = 64; // every shed gets its own treadle
+
+	bool ok = true;
+	for (LayoutOptions const& opts : {straight, treadles}) {
+		// the first layout sizes the buffers, after that the same or smaller designs shouldn't allocate
+		LayoutWorkspace ws;
+		ws.layout(big, opts);
+		ok &= check("same design  ", ws, big  , opts);
+		ok &= check("smaller      ", ws, small, opts);
+		ok &= check("fewer sheds  ", ws, few  , opts);
+		ok &= check("same again   ", ws, big  , opts);
+	}
+
+	// wide designs stay on the calling thread with threads = 1 so they don't allocate either
+	const Cell wide     = randomDraft(5000, 400, 24, 40, 4);
+	const Cell narrower = randomDraft(3000, 300, 16, 30, 5);
+	LayoutOptions serial;
+	serial.threads = 1;
+	{
+		LayoutWorkspace ws;
+		ws.layout(wide, serial);
+		ok &= check("wide         ", ws, wide    , serial);
+		ok &= check("narrower     ", ws, narrower, serial);
+		ok &= check("wide again   ", ws, wide    , serial);
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}